@@ -0,0 +1,63 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <array>
+#include <span>
+
+#define ADAPTIVE_RATE_CHANNELS   2
+#define ADAPTIVE_RATE_LOG_SIZE   32
+// Consecutive stable samples needed before backing off
+#define ADAPTIVE_RATE_STABLE_RUN 3
+// Samples the rate of change is fitted over
+#define ADAPTIVE_RATE_HISTORY    4
+
+// Chooses a sensor's sampling interval from how fast its readings change.
+// The rate of change is the least squares slope over the last few samples,
+// so sensor noise does not flip the decision from one sample to the next.
+// The interval halves whenever any channel changes faster than its
+// threshold, and grows by half after a run of samples changing at less
+// than half the threshold, always staying within the configured bounds.
+// Has no hardware dependencies.
+class adaptive_rate {
+public:
+    enum class reason : uint8_t {
+        first,
+        fast,
+        stable,
+        hold,
+    };
+    struct decision {
+        uint32_t time_ms;
+        // Largest rate of change relative to its threshold, 1.0 is on the threshold
+        float ratio;
+        uint32_t interval_ms;
+        reason why;
+    };
+
+    // Thresholds are per channel, in units per minute
+    adaptive_rate(std::span<const float> thresholds_per_min, uint32_t min_interval_ms, uint32_t max_interval_ms);
+
+    // Feeds one sample per channel and returns the interval until the next one
+    uint32_t update(std::span<const float> values, uint32_t now_ms);
+    void reset();
+
+    uint32_t interval_ms() const;
+    // Decisions from oldest to newest
+    size_t log_size() const;
+    const decision& log(size_t index) const;
+
+private:
+    std::array<float, ADAPTIVE_RATE_CHANNELS> m_thresholds;
+    std::array<std::array<float, ADAPTIVE_RATE_HISTORY>, ADAPTIVE_RATE_CHANNELS> m_values;
+    std::array<uint32_t, ADAPTIVE_RATE_HISTORY> m_times;
+    size_t m_channels, m_history_head, m_history_size;
+    uint32_t m_min_ms, m_max_ms, m_interval_ms;
+    uint8_t m_stable_run;
+    std::array<decision, ADAPTIVE_RATE_LOG_SIZE> m_log;
+    size_t m_log_head, m_log_size;
+
+    float slope_per_min(size_t channel) const;
+    void record(uint32_t now_ms, float ratio, reason why);
+};
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <span>
+
+#include "units.h"
+
+#define ADC_REFERENCE_VOLTS 3.3f
+#define ADC_MAX_COUNTS      4095
+
+// Mean of every stride'th sample starting at offset, in ADC counts
+float adc_mean(std::span<const uint16_t> samples, size_t offset = 0, size_t stride = 1);
+
+// Converts ADC counts to the voltage before a resistor divider of the given ratio
+volt_t adc_to_volts(float counts, float divider = 1.0f);
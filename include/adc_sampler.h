@@ -0,0 +1,48 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <atomic>
+#include <span>
+
+#define ADC_SAMPLER_MAX_CHANNELS        5
+#define ADC_SAMPLER_SAMPLES_PER_CHANNEL 128
+
+// Free running round robin ADC acquisition. Samples are streamed by DMA into
+// a pair of buffers, alternating between them, so the most recently
+// completed buffer can be read at any time without waiting on a conversion.
+// Buffers are interleaved: sample i belongs to the i % channels()th enabled input.
+class adc_sampler {
+public:
+    adc_sampler(uint8_t channel_mask, uint32_t sample_rate_hz = 1000);
+    ~adc_sampler();
+
+    bool valid() const;
+    size_t channels() const;
+
+    // Calls process with the most recently completed buffer. Returns false if
+    // no buffer has completed yet, or if DMA started overwriting the buffer
+    // before process returned.
+    template<typename F>
+    bool with_latest(F process) const {
+        uint32_t sequence = m_sequence;
+        if(sequence == 0) {
+            return false;
+        }
+        // The buffer is not volatile, keep its reads between the two sequence reads
+        std::atomic_signal_fence(std::memory_order_seq_cst);
+        process(std::span<const uint16_t>(m_buffers[(sequence - 1) % 2], m_length));
+        std::atomic_signal_fence(std::memory_order_seq_cst);
+        return sequence == m_sequence;
+    }
+
+private:
+    uint16_t m_buffers[2][ADC_SAMPLER_MAX_CHANNELS * ADC_SAMPLER_SAMPLES_PER_CHANNEL];
+    size_t m_length, m_channels;
+    int m_dma[2];
+    volatile uint32_t m_sequence;
+
+    void configure_dma(int index);
+    static void dma_irq_handler();
+};
@@ -31,13 +31,15 @@ public:
 
     uint32_t raw_humidity() const;
     uint32_t raw_temperature() const;
+    // When the current data was read from the sensor
+    absolute_time_t sampled_at() const;
 private:
     i2c_inst_t *m_i2c;
     uint8_t m_rbuffer[7];
     uint8_t m_wbuffer[3];
     uint8_t m_wlen;
     alarm_id_t m_alarm;
-    absolute_time_t m_busy_until;
+    absolute_time_t m_busy_until, m_sampled_at;
 
     int read(uint8_t);
     int write(uint8_t);
@@ -6,6 +6,7 @@
 
 #include <span>
 
+#include "bmp280_compensation.h"
 #include "units.h"
 
 class bmp280 {
@@ -53,6 +54,7 @@ public:
         forced = 0b01,
         normal = 0b11
     };
+    typedef bmp280_calibration calibration;
     bmp280(bool default_addr = true, i2c_inst_t *instance = PICO_DEFAULT_I2C_INSTANCE, uint32_t baud = 100000, uint8_t sda_pin = PICO_DEFAULT_I2C_SDA_PIN, uint8_t scl_pin = PICO_DEFAULT_I2C_SCL_PIN);
 
     void init();
@@ -60,6 +62,7 @@ public:
     bool busy();
     bool has_data() const;
     uint8_t chip_id() const;
+    const calibration& trim() const;
 
     celsius_t temperature();
     mbar_t pressure();
@@ -74,7 +77,7 @@ private:
     i2c_inst_t *m_i2c;
     uint8_t m_addr, m_id;
     alarm_id_t m_alarm;
-    uint8_t m_trim_params[26];
+    calibration m_calib;
     int32_t m_tfine, m_temperature;
     uint32_t m_pressure, m_raw_temperature, m_raw_pressure;
     bool m_needs_conversion, m_has_data;
@@ -84,6 +87,8 @@ private:
     int read(uint8_t addr, std::span<uint8_t> buffer);
     int write(uint8_t addr, std::span<uint8_t> data);
 
+    int read_calibration();
+
     int32_t calc_temp();
     uint32_t calc_pressure();
     void convert();
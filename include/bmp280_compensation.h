@@ -0,0 +1,23 @@
+#pragma once
+
+#include <stdint.h>
+
+// Trim parameters decoded from registers 0x88..0x9F
+struct bmp280_calibration {
+    uint16_t T1;
+    int16_t T2, T3;
+    uint16_t P1;
+    int16_t P2, P3, P4, P5, P6, P7, P8, P9;
+};
+
+#define BMP280_CALIB_LEN 24
+
+// Decodes the little endian trim block read from register 0x88
+bmp280_calibration bmp280_decode_calibration(const uint8_t (&data)[BMP280_CALIB_LEN]);
+
+// 32 bit compensation from the bosch bmp280 datasheet. Temperature is in
+// hundredths of a degree, t_fine receives the fine temperature the pressure
+// compensation needs.
+int32_t bmp280_compensate_temperature(const bmp280_calibration &calib, int32_t raw, int32_t &t_fine);
+// Pressure in Pa, 0 when the calibration would divide by zero
+uint32_t bmp280_compensate_pressure(const bmp280_calibration &calib, int32_t raw, int32_t t_fine);
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <stdint.h>
+
+// Clamp on the estimated oscillator error, well beyond the crystal spec
+#define CLOCK_SYNC_MAX_DRIFT_PPB 500000
+// Syncs closer together than this are too noisy to estimate drift from
+#define CLOCK_SYNC_MIN_SPAN_US   (60ll * 1000 * 1000)
+
+// Maps the monotonic microsecond clock onto UTC. Each sync re-anchors the
+// mapping and refines an estimate of the local oscillator's drift, which is
+// applied to extrapolate between syncs. Has no hardware dependencies.
+class clock_sync {
+public:
+    clock_sync();
+
+    // At monotonic time local_us, UTC was utc_us (microseconds since the epoch)
+    void update(uint64_t local_us, int64_t utc_us);
+    void reset();
+
+    bool synced() const;
+    int64_t to_utc_us(uint64_t local_us) const;
+    int32_t drift_ppb() const;
+
+private:
+    uint64_t m_local_us;
+    int64_t m_utc_us;
+    int32_t m_drift_ppb;
+    bool m_synced, m_has_drift;
+};
@@ -0,0 +1,8 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Standard CRC-32 (IEEE 802.3, as used by zlib). Pass the previous result
+// as crc to continue a running checksum.
+uint32_t crc32(const void *mem, size_t len, uint32_t crc = 0);
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <span>
+
+#include "flash_device.h"
+
+// Binary delta format. A patch is a 24 byte little endian header
+//   "WNDP", version (u8), 3 reserved bytes,
+//   old size (u32), old crc32 (u32), new size (u32), new crc32 (u32)
+// followed by operations that rebuild the new image front to back:
+//   0x01 copy: source offset (unsigned LEB128), length (unsigned LEB128)
+//   0x02 data: length (unsigned LEB128), then length literal bytes
+//   0x00 end
+#define DELTA_PATCH_VERSION     1
+#define DELTA_PATCH_HEADER_SIZE 24
+
+#define DELTA_OP_END  0x00
+#define DELTA_OP_COPY 0x01
+#define DELTA_OP_DATA 0x02
+
+// Applies a patch as it streams in, copying from the running image and
+// writing the result a page at a time, so RAM use is one flash page no
+// matter how large the image is.
+class delta_patch {
+public:
+    enum class status {
+        more,
+        done,
+        failed
+    };
+
+    delta_patch(flash_device &flash, uint32_t source_offset, size_t source_size,
+                uint32_t target_offset, size_t target_capacity);
+
+    // Consumes all of data. Once done or failed, further input is ignored.
+    status feed(std::span<const uint8_t> data);
+    status state() const { return m_status; }
+
+    // Valid once the header has been received
+    size_t image_size() const { return m_new_size; }
+    uint32_t image_crc() const { return m_new_crc; }
+    size_t written() const { return m_written; }
+
+private:
+    enum class stage {
+        header,
+        op,
+        copy_offset,
+        copy_length,
+        data_length,
+        data
+    };
+
+    bool check_header();
+    bool varint(uint8_t byte, uint32_t &value);
+    bool copy(uint32_t offset, uint32_t length);
+    bool emit(std::span<const uint8_t> data);
+    bool flush_page();
+    bool finish();
+    status fail(const char *reason);
+
+    flash_device &m_flash;
+    uint32_t m_source_offset;
+    size_t m_source_size;
+    uint32_t m_target_offset;
+    size_t m_target_capacity;
+
+    status m_status = status::more;
+    stage m_stage = stage::header;
+    uint8_t m_header[DELTA_PATCH_HEADER_SIZE];
+    size_t m_header_fill = 0;
+    size_t m_old_size = 0;
+    size_t m_new_size = 0;
+    uint32_t m_new_crc = 0;
+
+    uint32_t m_varint = 0;
+    uint8_t m_varint_shift = 0;
+    uint32_t m_copy_offset = 0;
+    uint32_t m_remaining = 0;
+
+    uint8_t m_page[FLASH_DEVICE_PAGE_SIZE];
+    size_t m_page_fill = 0;
+    size_t m_written = 0;
+};
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <optional>
+
+#include "loop_packet.h"
+#include "units.h"
+
+// The formulas weewx uses on the server, evaluated with polynomial
+// approximations in place of logf/expf/sqrtf so no soft-float library
+// calls are made. Each is within 0.01 degrees or 0.01 mbar of the exact
+// formula over the ranges a weather station sees.
+
+// Magnus dew point, as weewx's dewpointC. Empty for 0% humidity, and for
+// temperatures that are not finite or are at or below the Magnus pole.
+std::optional<celsius_t> dewpoint(celsius_t temperature, percentage_t humidity);
+// NWS heat index (Rothfusz regression with the low and high humidity
+// adjustments), as weewx's heatindexC. Below 40F it is the temperature.
+celsius_t heat_index(celsius_t temperature, percentage_t humidity);
+// Station pressure reduced to sea level with the hypsometric equation,
+// using the mean temperature of the air column below the station. Empty
+// when that column is not above absolute zero or an input is not finite.
+std::optional<mbar_t> sea_level_pressure(mbar_t pressure, celsius_t temperature, float altitude_m);
+
+// Works out derived quantities only when asked for them and caches each
+// until the inputs it depends on change, so a packet that is rendered for
+// http and then sent only computes them once. Has no hardware dependencies.
+class derived_weather {
+public:
+    // Without an altitude station pressure cannot be reduced, and there is no barometer
+    derived_weather(std::optional<float> altitude_m = {});
+
+    // Takes outTemp, outHumidity and pressure from args when present
+    void update(const packet_args &args);
+
+    std::optional<celsius_t> dewpoint();
+    std::optional<celsius_t> heat_index();
+    std::optional<mbar_t> barometer();
+
+    // Updates from args, then adds whatever can be derived from its own values
+    void fill(packet_args &args);
+
+    // Computations done since construction, cache hits are not counted
+    uint32_t evaluations() const { return m_evaluations; }
+
+private:
+    template<typename T>
+    struct cached {
+        std::optional<T> value;
+        bool valid = false;
+    };
+
+    std::optional<float> m_altitude;
+    std::optional<celsius_t> m_temperature;
+    std::optional<percentage_t> m_humidity;
+    std::optional<mbar_t> m_pressure;
+    cached<celsius_t> m_dewpoint, m_heat_index;
+    cached<mbar_t> m_barometer;
+    uint32_t m_evaluations;
+};
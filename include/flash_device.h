@@ -0,0 +1,39 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <span>
+
+// Geometry of the RP2040's QSPI flash, which the update logic is written
+// for. Kept here rather than taken from hardware/flash.h so that logic
+// builds on the host too.
+#define FLASH_DEVICE_SECTOR_SIZE 4096
+#define FLASH_DEVICE_PAGE_SIZE   256
+
+// Erase/program/read access to a NOR flash, so update logic can run
+// against the real chip or a memory-backed image on the host. Offsets and
+// lengths follow the RP2040 rules: erases are sector aligned, programs
+// are page aligned.
+class flash_device {
+public:
+    virtual ~flash_device() = default;
+
+    virtual size_t size() const = 0;
+    virtual bool erase(uint32_t offset, size_t length) = 0;
+    virtual bool program(uint32_t offset, std::span<const uint8_t> data) = 0;
+    // The returned view stays valid until the range is erased or programmed
+    virtual std::span<const uint8_t> read(uint32_t offset, size_t length) const = 0;
+};
+
+// The on-board QSPI flash, read through XIP
+class rp2040_flash : public flash_device {
+public:
+    // Bytes of flash taken by the running image
+    static size_t binary_size();
+
+    size_t size() const override;
+    bool erase(uint32_t offset, size_t length) override;
+    bool program(uint32_t offset, std::span<const uint8_t> data) override;
+    std::span<const uint8_t> read(uint32_t offset, size_t length) const override;
+};
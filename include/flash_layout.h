@@ -0,0 +1,18 @@
+#pragma once
+
+// Flash starts with the loader, followed by two equal image slots and the
+// sectors reserved for updates:
+//
+//   | loader | active slot | staging slot | ota scratch | ota state A | ota state B |
+//
+// The loader finishes, counts and rolls back updates before starting the
+// image in the active slot; the swap never touches it. Updates are written
+// to the staging slot and swapped in sector by sector, leaving the previous
+// image in the staging slot for rollback. The state sectors take turns
+// holding the newest record, see ota_slots.
+#ifndef FLASH_LOADER_SIZE
+#define FLASH_LOADER_SIZE (32 * 1024)
+#endif
+// Images keep the 256 byte boot2 they are linked with, unused, so their
+// vector table starts this far into the slot
+#define FLASH_IMAGE_VECTORS 0x100
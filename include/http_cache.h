@@ -0,0 +1,73 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#include <string_view>
+
+#define HTTP_CACHE_SIZE        1024
+#define HTTP_CACHE_HEADER_SIZE 160
+#define HTTP_CACHE_ETAG_SIZE   20
+
+// Holds the latest reading as a complete, pre-rendered HTTP response so
+// requests can be answered straight from memory without formatting. Two
+// buffers are kept so a new sample can be rendered while a previous
+// response is still waiting to be acknowledged. Has no network dependencies.
+class http_cache {
+public:
+    struct response {
+        const char *data;
+        size_t length;
+        // Buffer to release once the data has been sent, -1 for static responses
+        int buffer;
+    };
+
+    // nonce is mixed into every ETag and must differ on each boot, otherwise
+    // a client could get a 304 for an older body with the same sequence
+    http_cache(uint32_t nonce, std::string_view path = "/latest");
+
+    // Renders a new JSON body. Returns false if it does not fit or both
+    // buffers are still referenced by in-flight responses.
+    bool render(std::string_view body);
+    // Same, but body(write) produces the body in place through
+    // write(std::string_view), e.g. with write_packet(), and the headers are
+    // added in front of it afterwards.
+    template<typename Body>
+    bool render_with(Body &&body) {
+        int next = begin_render();
+        if(next < 0) {
+            return false;
+        }
+        char *out = m_buffers[next] + HTTP_CACHE_HEADER_SIZE;
+        size_t length = 0;
+        auto write = [out, &length](std::string_view data) {
+            if(data.size() > HTTP_CACHE_SIZE - HTTP_CACHE_HEADER_SIZE - length) {
+                return false;
+            }
+            memcpy(out + length, data.data(), data.size());
+            length += data.size();
+            return true;
+        };
+        return body(write) && finish_render(next, length);
+    }
+    // Picks the response for a complete request head
+    response handle(std::string_view request);
+    void release(int buffer);
+
+    uint32_t sequence() const;
+
+private:
+    int begin_render();
+    bool finish_render(int next, size_t body_length);
+
+    char m_buffers[2][HTTP_CACHE_SIZE];
+    char m_not_modified[2][HTTP_CACHE_HEADER_SIZE];
+    char m_etag[2][HTTP_CACHE_ETAG_SIZE];
+    // Responses start part way into their buffer, wherever the headers ended up
+    size_t m_start[2], m_header_length[2], m_length[2], m_not_modified_length[2];
+    uint8_t m_references[2];
+    int m_current;
+    uint32_t m_nonce, m_sequence;
+    std::string_view m_path;
+};
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <array>
+
+#include <lwip/tcp.h>
+
+#include "http_cache.h"
+
+#define HTTP_SERVER_MAX_CONNECTIONS 4
+#define HTTP_SERVER_REQUEST_SIZE    512
+
+// Minimal lwIP raw API server that answers every request from an
+// http_cache. Responses are handed to tcp_write without copying, so the
+// cache buffer stays referenced until the client acknowledges it, even
+// after a graceful close. Only an abort or a pcb error unpins it early.
+// All calls must be made with the lwIP lock held.
+class http_server {
+public:
+    http_server(http_cache &cache, uint16_t port = 80);
+    ~http_server();
+
+    bool listen();
+    bool listening() const;
+    void close();
+
+private:
+    struct connection {
+        http_server *server;
+        tcp_pcb *pcb;
+        char request[HTTP_SERVER_REQUEST_SIZE];
+        size_t length, unacked;
+        int buffer;
+        bool responded;
+        // Closed by us, the pcb lives on until the response is acknowledged
+        bool closing;
+    };
+
+    http_cache &m_cache;
+    tcp_pcb *m_listener;
+    uint16_t m_port;
+    std::array<connection, HTTP_SERVER_MAX_CONNECTIONS> m_connections;
+
+    connection *allocate(tcp_pcb *pcb);
+    void respond(connection *conn);
+    err_t finish(connection *conn, bool abort);
+    void detach(connection *conn);
+
+    static err_t accept_callback(void *arg, tcp_pcb *pcb, err_t err);
+    static err_t recv_callback(void *arg, tcp_pcb *pcb, pbuf *p, err_t err);
+    static err_t sent_callback(void *arg, tcp_pcb *pcb, u16_t len);
+    static void err_callback(void *arg, err_t err);
+};
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <hardware/i2c.h>
+
+#include <span>
+
+// Wrappers around the blocking SDK I2C calls used by the sensor drivers.
+// Built with I2C_TRACE, every transaction is captured with timestamps into
+// a RAM buffer in the i2c_trace_format encoding while capture is running.
+// Built with I2C_TRACE_REPLAY, transactions are served from a previously
+// captured trace instead of the bus. Otherwise they compile down to the
+// plain SDK calls.
+#define I2C_TRACE_BUFFER_SIZE (16 * 1024)
+// Distinct bus/address pairs a replay can serve
+#define I2C_TRACE_REPLAY_DEVICES 4
+
+#if I2C_TRACE || I2C_TRACE_REPLAY
+
+int i2c_trace_write_blocking(i2c_inst_t *i2c, uint8_t addr, const uint8_t *src, size_t len, bool nostop);
+int i2c_trace_read_blocking(i2c_inst_t *i2c, uint8_t addr, uint8_t *dst, size_t len, bool nostop);
+
+#else
+
+static inline int i2c_trace_write_blocking(i2c_inst_t *i2c, uint8_t addr, const uint8_t *src, size_t len, bool nostop) {
+    return i2c_write_blocking(i2c, addr, src, len, nostop);
+}
+
+static inline int i2c_trace_read_blocking(i2c_inst_t *i2c, uint8_t addr, uint8_t *dst, size_t len, bool nostop) {
+    return i2c_read_blocking(i2c, addr, dst, len, nostop);
+}
+
+#endif
+
+#if I2C_TRACE
+
+// Capture stops by itself when the buffer fills, so a trace always holds
+// the start of a session. Transactions after that are only counted.
+void i2c_trace_start();
+void i2c_trace_stop();
+bool i2c_trace_capturing();
+uint32_t i2c_trace_overflows();
+// Warns once after the buffer has filled. Call from the main loop, never
+// from an alarm callback.
+void i2c_trace_report();
+std::span<const uint8_t> i2c_trace_buffer();
+// Prints the trace to stdio as hex lines prefixed with I2CTRACE, see
+// scripts/i2c_trace.py
+void i2c_trace_dump();
+
+#endif
+
+#if I2C_TRACE_REPLAY
+
+struct i2c_replay_stats {
+    uint32_t transactions;
+    // Transactions whose direction, length or written bytes differ from the trace
+    uint32_t mismatches;
+    // Transactions requested after the device's records ran out
+    uint32_t exhausted;
+    // Bus time of the replayed transactions as recorded. Each replayed
+    // transaction busy waits for its recorded duration.
+    uint64_t recorded_us;
+};
+
+// Each bus/address pair is served from its own records in trace order.
+// The trace must stay valid while it is being replayed. Host side timing
+// is done by test/replay_i2c_trace.cpp.
+bool i2c_trace_replay(std::span<const uint8_t> trace);
+i2c_replay_stats i2c_trace_replay_stats();
+
+#endif
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <span>
+
+// Binary I2C trace format. A trace is the header "I2CT" + version, followed
+// by records:
+//   flags (u8): bit 0 read, bit 1 nostop, bit 2 bus 1, bit 3 failed
+//   address (u8)
+//   microseconds since the previous record (unsigned LEB128)
+//   microseconds the transaction took (unsigned LEB128)
+//   length (u8)
+//   rc (i8), only when failed
+//   data, length bytes, omitted for failed reads
+#define I2C_TRACE_VERSION     1
+#define I2C_TRACE_HEADER_SIZE 5
+// Largest possible encoding of a single record
+#define I2C_TRACE_RECORD_MAX  (2 + 5 + 5 + 1 + 1 + 255)
+
+#define I2C_TRACE_FLAG_READ   0x01
+#define I2C_TRACE_FLAG_NOSTOP 0x02
+#define I2C_TRACE_FLAG_BUS1   0x04
+#define I2C_TRACE_FLAG_FAILED 0x08
+
+struct i2c_trace_record {
+    uint8_t flags;
+    uint8_t address;
+    uint32_t delta_us;
+    uint32_t duration_us;
+    int rc;
+    std::span<const uint8_t> data;
+
+    bool read() const { return flags & I2C_TRACE_FLAG_READ; }
+    bool nostop() const { return flags & I2C_TRACE_FLAG_NOSTOP; }
+    uint8_t bus() const { return (flags & I2C_TRACE_FLAG_BUS1) ? 1 : 0; }
+    bool failed() const { return flags & I2C_TRACE_FLAG_FAILED; }
+};
+
+size_t i2c_trace_write_header(std::span<uint8_t> out);
+bool i2c_trace_check_header(std::span<const uint8_t> data);
+
+// Returns the encoded length, or 0 if out is too small
+size_t i2c_trace_encode(const i2c_trace_record &record, std::span<uint8_t> out);
+// Returns the number of bytes consumed, or 0 if data holds no complete record.
+// record.data points into data.
+size_t i2c_trace_decode(std::span<const uint8_t> data, i2c_trace_record &record);
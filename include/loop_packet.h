@@ -5,6 +5,8 @@
 #include "units.h"
 
 struct packet_args {
+    // Seconds since the unix epoch at which the sample was taken
+    std::optional<double> dateTime = {};
     std::optional<celsius_t> outTemp = {};
     std::optional<celsius_t> inTemp = {};
     std::optional<mbar_t> barometer = {};
@@ -15,6 +17,9 @@ struct packet_args {
     std::optional<degree_compass_t> windGustDir = {};
     std::optional<percentage_t> outHumidity = {};
     std::optional<percentage_t> inHumidity = {};
+    // Derived on the node, see derived_weather
+    std::optional<celsius_t> dewpoint = {};
+    std::optional<celsius_t> heatindex = {};
     std::optional<watt_m2_t> radiation = {};
     std::optional<uv_index_t> UV = {};
     std::optional<cm_t> rain = {};
@@ -30,7 +35,7 @@ struct packet_args {
     std::optional<percentage_t> rxCheckPercent = {};
 };
 
-nlohmann::json create_packet(packet_args args) {
+inline nlohmann::json create_packet(packet_args args) {
     nlohmann::json packet = {};
 
     // packet["outTemp"] = nullptr;
@@ -57,6 +62,8 @@ nlohmann::json create_packet(packet_args args) {
     // packet["referenceVoltage"] = nullptr;
     // packet["rxCheckPercent"] = nullptr;
 
+    if(args.dateTime.has_value())
+        packet["dateTime"] = *(args.dateTime);
     if(args.outTemp.has_value())
         packet["outTemp"] = *(args.outTemp);
     if(args.inTemp.has_value())
@@ -77,6 +84,10 @@ nlohmann::json create_packet(packet_args args) {
         packet["outHumidity"] = *(args.outHumidity);
     if(args.inHumidity.has_value())
         packet["inHumidity"] = *(args.inHumidity);
+    if(args.dewpoint.has_value())
+        packet["dewpoint"] = *(args.dewpoint);
+    if(args.heatindex.has_value())
+        packet["heatindex"] = *(args.heatindex);
     if(args.radiation.has_value())
         packet["radiation"] = *(args.radiation);
     if(args.UV.has_value())
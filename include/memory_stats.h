@@ -0,0 +1,37 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+struct stack_usage {
+    size_t size;
+    // Deepest use seen since boot, from the painted stack
+    size_t high_water;
+};
+
+struct heap_usage {
+    // Bytes between the start of the heap and the stack limit
+    size_t size;
+    // Highest break the allocator has requested, which it never gives back
+    size_t high_water;
+    size_t in_use, free;
+    // Peak of in_use across memory_stats_sample() calls
+    size_t peak_in_use;
+    // Top chunk plus unclaimed heap: an allocation of this size is
+    // guaranteed to succeed. Fragmented free chunks below the top may be larger.
+    size_t largest_free;
+};
+
+// Fills the unused parts of both core stacks with a known pattern. Call as
+// early as possible in main, and before core 1 is launched. Interrupt
+// handlers run on the stack of the core they fire on, so their depth is
+// included in that core's high water mark.
+void memory_stats_paint();
+
+stack_usage memory_stats_core0();
+stack_usage memory_stats_core1();
+heap_usage memory_stats_heap();
+
+// Updates the heap peak, cheap enough to call every loop
+void memory_stats_sample();
+void memory_stats_print();
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <optional>
+
+#include <pico/time.h>
+#include <lwip/ip_addr.h>
+#include <lwip/tcp.h>
+
+#include "flash_device.h"
+#include "ota_download.h"
+#include "ota_slots.h"
+
+#define OTA_CHECK_INTERVAL_MS (6 * 60 * 60 * 1000)
+#define OTA_RETRY_INTERVAL_MS (10 * 60 * 1000)
+// A download that stalls this long is abandoned
+#define OTA_TIMEOUT_MS        (60 * 1000)
+
+// Periodically asks an HTTP server for a delta from the running image,
+// GET <url>?from=<crc32 of the running image>, and hands the response to
+// an ota_download that writes it to the staging slot. Received data
+// is only acknowledged to TCP once it has been written to flash, so the
+// receive window rather than RAM bounds what is in flight.
+// All calls must be made with the lwIP lock held.
+class ota_client {
+public:
+    ota_client(ota_slots &slots, flash_device &flash, const char *url);
+    ~ota_client();
+
+    // Starts a check when one is due and applies received data. Returns
+    // true once an update is staged and the device should reset.
+    bool poll();
+
+private:
+    enum class phase {
+        idle,
+        resolving,
+        connecting,
+        receiving
+    };
+
+    ota_slots &m_slots;
+    flash_device &m_flash;
+    char m_host[64];
+    char m_path[128];
+    uint16_t m_port;
+    uint32_t m_running_crc;
+
+    phase m_phase;
+    tcp_pcb *m_pcb;
+    ip_addr_t m_addr;
+    pbuf *m_queue;
+    bool m_closed;
+    absolute_time_t m_next_check, m_deadline;
+    std::optional<ota_download> m_download;
+
+    void start();
+    void connect();
+    void finish(bool retry);
+
+    static void dns_callback(const char *name, const ip_addr_t *addr, void *arg);
+    static err_t connected_callback(void *arg, tcp_pcb *pcb, err_t err);
+    static err_t recv_callback(void *arg, tcp_pcb *pcb, pbuf *p, err_t err);
+    static void err_callback(void *arg, err_t err);
+};
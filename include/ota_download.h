@@ -0,0 +1,51 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <optional>
+#include <span>
+
+#include "delta_patch.h"
+#include "flash_device.h"
+#include "ota_slots.h"
+
+#define OTA_HEADER_SIZE 512
+
+// The update server's side of an update check: parses the HTTP response as
+// it arrives and streams a 200 body through a delta_patch into the staging
+// slot. 204 or 404 mean there is no update. Knows nothing of the transport,
+// ota_client feeds it from lwIP.
+class ota_download {
+public:
+    enum class status {
+        more,
+        no_update,
+        done,
+        failed
+    };
+
+    // rejected_crc is an image that was rolled back, which is not downloaded again
+    ota_download(flash_device &flash, const ota_layout &layout, size_t running_size, uint32_t rejected_crc);
+
+    // Consumes all of data. Once finished, further input is ignored.
+    status feed(std::span<const uint8_t> data);
+    status state() const { return m_status; }
+
+    // Valid once done
+    size_t image_size() const { return m_patch ? m_patch->image_size() : 0; }
+    uint32_t image_crc() const { return m_patch ? m_patch->image_crc() : 0; }
+
+private:
+    flash_device &m_flash;
+    ota_layout m_layout;
+    size_t m_running_size;
+    uint32_t m_rejected_crc;
+
+    status m_status;
+    char m_header[OTA_HEADER_SIZE];
+    size_t m_header_length;
+    std::optional<delta_patch> m_patch;
+
+    bool headers(std::span<const uint8_t> data, size_t &used);
+};
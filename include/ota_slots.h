@@ -0,0 +1,109 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "flash_device.h"
+
+// Boot attempts a new image gets before it is rolled back
+#define OTA_MAX_ATTEMPTS 3
+// The loader starts a trial image with the watchdog running, so one that
+// crashes or hangs anywhere, even before main, is reset and uses up an
+// attempt. This is as long as the RP2040 watchdog can count.
+#define OTA_TRIAL_WATCHDOG_MS 8000
+// A trial image keeps feeding the watchdog for this long at most without
+// confirming, so one that never gets through to weewx is reset as well.
+// Generous enough to ride out a slow access point or server.
+#define OTA_TRIAL_DEADLINE_MS (10 * 60 * 1000)
+
+struct ota_layout {
+    uint32_t active;
+    uint32_t staging;
+    // One sector, holds a sector of the active slot while it is swapped
+    uint32_t scratch;
+    // Two sectors, each with a record in page 0, the progress of the swap
+    // it started in page 1 and boot attempts in page 2
+    uint32_t state;
+    size_t slot_size;
+};
+
+// The layout from flash_layout.h for a flash of flash_size bytes
+ota_layout ota_layout_for(size_t flash_size);
+
+enum class ota_state : uint32_t {
+    confirmed,
+    // The staging slot holds a verified image waiting to be swapped in
+    staged,
+    // A swap is in progress and resumes on the next boot
+    swapping,
+    // A new image is running but has not yet confirmed it works
+    trial,
+    // The new image never confirmed and the previous one was restored
+    rolled_back
+};
+
+const char *ota_state_name(ota_state state);
+
+struct ota_record {
+    uint32_t magic;
+    // The state sector with the higher sequence holds the current record
+    uint32_t sequence;
+    ota_state state;
+    uint32_t image_size;
+    uint32_t image_crc;
+    uint32_t previous_size;
+    uint32_t previous_crc;
+    // Sectors a swap between the two images covers, and the state it ends in
+    uint32_t sectors;
+    ota_state next_state;
+    // Image that was rolled back, so it is not installed again
+    uint32_t rejected_crc;
+    uint32_t crc;
+};
+
+// A/B slot bookkeeping. Images always run from the active slot; an update
+// is staged in the other slot and the two are exchanged sector by sector,
+// so the previous image stays in the staging slot for rollback. All state
+// lives in flash and every step is resumable after a reset. A new record
+// goes to the state sector not holding the current one, which stays valid
+// until the new record is completely written.
+class ota_slots {
+public:
+    // running_size is the size of the image in the active slot, 0 when
+    // not known, as in the loader
+    ota_slots(flash_device &flash, const ota_layout &layout, size_t running_size);
+
+    // Run by the loader on every boot. Finishes a pending swap, counts a
+    // trial boot or rolls back a trial image that used up its attempts.
+    // Returns true when it exchanged the images; call it again until it
+    // returns false, then start the image in the active slot.
+    bool boot();
+
+    // Marks the staging slot, already written and verified, as the next image
+    bool stage(size_t image_size, uint32_t image_crc);
+    // Called once the running image has proven itself
+    void confirm();
+
+    ota_state state() const { return m_record.state; }
+    const ota_record &record() const { return m_record; }
+    // Boots used by the running trial image, including this one
+    uint32_t attempts() const;
+    const ota_layout &layout() const { return m_layout; }
+    size_t running_size() const { return m_running_size; }
+
+private:
+    bool load();
+    bool read_record(uint32_t sector, ota_record &record) const;
+    bool store(const ota_record &record);
+    uint32_t count_cleared(uint32_t page) const;
+    bool mark(uint32_t page, uint32_t bit);
+    bool copy_sector(uint32_t to, uint32_t from);
+    bool swap(uint32_t first_step);
+
+    flash_device &m_flash;
+    ota_layout m_layout;
+    size_t m_running_size;
+    ota_record m_record;
+    // Offset of the state sector holding m_record
+    uint32_t m_current;
+};
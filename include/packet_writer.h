@@ -0,0 +1,62 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <string_view>
+
+#include "loop_packet.h"
+
+// Longest text a single packet value is written as
+#define PACKET_NUMBER_SIZE 32
+
+// Non finite values are written as null, like nlohmann::json does
+size_t format_packet_number(char (&out)[PACKET_NUMBER_SIZE], double value);
+size_t format_packet_number(char (&out)[PACKET_NUMBER_SIZE], float value);
+size_t format_packet_number(char (&out)[PACKET_NUMBER_SIZE], int value);
+
+// Serializes args as the JSON object create_packet() builds, without
+// building it: each piece is handed to write(std::string_view) as it is
+// produced, so the text goes straight into its destination. write returns
+// false to stop, e.g. when the destination is full, and so does this.
+template<typename Write>
+bool write_packet(const packet_args &args, Write &&write) {
+    char number[PACKET_NUMBER_SIZE];
+    bool first = true;
+    auto field = [&](std::string_view name, const auto &value) {
+        if(!value.has_value()) {
+            return true;
+        }
+        bool ok = write(first ? "{\"" : ",\"") && write(name) && write("\":")
+            && write({number, format_packet_number(number, *value)});
+        first = false;
+        return ok;
+    };
+    return field("dateTime", args.dateTime)
+        && field("outTemp", args.outTemp)
+        && field("inTemp", args.inTemp)
+        && field("barometer", args.barometer)
+        && field("pressure", args.pressure)
+        && field("windSpeed", args.windSpeed)
+        && field("windDir", args.windDir)
+        && field("windGust", args.windGust)
+        && field("windGustDir", args.windGustDir)
+        && field("outHumidity", args.outHumidity)
+        && field("inHumidity", args.inHumidity)
+        && field("dewpoint", args.dewpoint)
+        && field("heatindex", args.heatindex)
+        && field("radiation", args.radiation)
+        && field("UV", args.UV)
+        && field("rain", args.rain)
+        && field("txBatteryStatus", args.txBatteryStatus)
+        && field("windBatteryStatus", args.windBatteryStatus)
+        && field("rainBatteryStatus", args.rainBatteryStatus)
+        && field("outTempBatteryStatus", args.outTempBatteryStatus)
+        && field("inTempBatteryStatus", args.inTempBatteryStatus)
+        && field("consBatteryVoltage", args.consBatteryVoltage)
+        && field("heatingVoltage", args.heatingVoltage)
+        && field("supplyVoltage", args.supplyVoltage)
+        && field("referenceVoltage", args.referenceVoltage)
+        && field("rxCheckPercent", args.rxCheckPercent)
+        && write(first ? "{}" : "}");
+}
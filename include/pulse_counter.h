@@ -0,0 +1,23 @@
+#pragma once
+
+#include <stdint.h>
+#include <hardware/pio.h>
+
+// Counts debounced pulses on a pin using a PIO state machine. The count is
+// copied out of the RX FIFO by DMA, so no interrupts are taken per pulse.
+class pulse_counter {
+public:
+    pulse_counter(PIO pio, uint8_t pin, uint32_t debounce_us = 1000);
+    ~pulse_counter();
+
+    bool valid() const;
+    // Total pulses since construction, wraps at 2^32
+    uint32_t count();
+
+private:
+    PIO m_pio;
+    int m_sm, m_dma;
+    volatile uint32_t m_count;
+
+    void arm_dma();
+};
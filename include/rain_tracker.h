@@ -0,0 +1,25 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "units.h"
+
+// Accumulates tipping bucket pulses until they are reported in a packet.
+// Has no hardware dependencies.
+class rain_tracker {
+public:
+    // 0.2794mm (0.011") per tip is the most common bucket size
+    rain_tracker(cm_t cm_per_tip = 0.02794f);
+
+    void update(uint32_t count);
+    // Rain since the last call to take()
+    cm_t take();
+    // Rain since the last call to take(), without resetting it
+    cm_t peek() const;
+    uint32_t pending_tips() const;
+
+private:
+    cm_t m_cm_per_tip;
+    uint32_t m_last_count, m_pending;
+    bool m_primed;
+};
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <span>
+
+#define SNTP_PACKET_SIZE 48
+#define SNTP_PORT        123
+
+// Builds an SNTP client request. The nonce is sent as the transmit
+// timestamp and must be echoed back by the server as the originate timestamp.
+void sntp_build_request(std::span<uint8_t, SNTP_PACKET_SIZE> out, uint64_t nonce);
+
+// Parses a server response to the request sent with nonce at monotonic
+// time sent_us and received at received_us. On success, sets utc_us to the
+// UTC time at received_us, corrected for half the round trip delay.
+bool sntp_parse_response(std::span<const uint8_t> data, uint64_t nonce, uint64_t sent_us, uint64_t received_us, int64_t &utc_us);
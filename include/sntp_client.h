@@ -0,0 +1,40 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <pico/time.h>
+#include <lwip/ip_addr.h>
+#include <lwip/udp.h>
+
+#include "clock_sync.h"
+
+#ifndef SNTP_SERVER
+#define SNTP_SERVER "pool.ntp.org"
+#endif
+#define SNTP_INTERVAL_MS       (15 * 60 * 1000)
+#define SNTP_RETRY_INTERVAL_MS (15 * 1000)
+
+// Periodically queries an SNTP server and feeds the results into a
+// clock_sync. All calls must be made with the lwIP lock held.
+class sntp_client {
+public:
+    sntp_client(clock_sync &clock, const char *server = SNTP_SERVER);
+    ~sntp_client();
+
+    // Sends a request when one is due
+    void poll();
+
+private:
+    clock_sync &m_clock;
+    const char *m_server;
+    udp_pcb *m_pcb;
+    ip_addr_t m_addr;
+    absolute_time_t m_next_request;
+    uint64_t m_sent_us, m_nonce;
+    bool m_resolving, m_waiting;
+
+    void request();
+
+    static void dns_callback(const char *name, const ip_addr_t *addr, void *arg);
+    static void recv_callback(void *arg, udp_pcb *pcb, pbuf *p, const ip_addr_t *addr, u16_t port);
+};
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <span>
+
+#include "loop_packet.h"
+
+// Compact datagram encoding of a loop packet:
+//   magic "WN", version, flags, sequence (u32 LE), sample time in
+//   microseconds since the unix epoch (i64 LE, 0 if unknown), then for each
+//   present field a field id (u8) followed by its value as a float32 LE.
+// Acknowledgements are magic "WA", version, 0, sequence (u32 LE).
+// Field ids must match FIELDS in the weewx driver.
+#define UDP_PACKET_VERSION   2
+#define UDP_PACKET_HEADER    16
+#define UDP_PACKET_ACK_SIZE  8
+
+#define UDP_PACKET_FLAG_ACK  0x01
+
+enum class udp_field : uint8_t {
+    outTemp,
+    inTemp,
+    barometer,
+    pressure,
+    windSpeed,
+    windDir,
+    windGust,
+    windGustDir,
+    outHumidity,
+    inHumidity,
+    radiation,
+    UV,
+    rain,
+    txBatteryStatus,
+    windBatteryStatus,
+    rainBatteryStatus,
+    outTempBatteryStatus,
+    inTempBatteryStatus,
+    consBatteryVoltage,
+    heatingVoltage,
+    supplyVoltage,
+    referenceVoltage,
+    rxCheckPercent,
+    dewpoint,
+    heatindex,
+    // Number of fields, keep last
+    count
+};
+
+// Every field present, each an id byte and a float32
+#define UDP_PACKET_MAX_SIZE  (UDP_PACKET_HEADER + 5 * (size_t)udp_field::count)
+
+// Returns the encoded length, or 0 if out is too small
+size_t encode_udp_packet(const packet_args &args, uint32_t sequence, uint8_t flags, std::span<uint8_t> out);
+// Returns true and sets sequence if data is a valid acknowledgement
+bool decode_udp_ack(std::span<const uint8_t> data, uint32_t &sequence);
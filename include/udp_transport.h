@@ -0,0 +1,65 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <array>
+
+#include <pico/time.h>
+#include <lwip/ip_addr.h>
+#include <lwip/udp.h>
+
+#include "loop_packet.h"
+#include "udp_packet.h"
+
+#define UDP_TRANSPORT_PENDING     8
+#define UDP_TRANSPORT_RETRIES     3
+#define UDP_TRANSPORT_TIMEOUT_MS  1000
+
+// Connectionless alternative to the socket.io client. Each sample is sent
+// as a single sequence numbered datagram. When acknowledgements are
+// enabled, unacknowledged datagrams are kept in a fixed pool and resent
+// from poll() until they are acknowledged or run out of retries.
+// All calls must be made with the lwIP lock held.
+class udp_transport {
+public:
+    udp_transport(const char *host, uint16_t port, bool acknowledge = true);
+    ~udp_transport();
+
+    bool open();
+    bool ready() const;
+    // True once the datagram went out or, with acknowledgements, is queued
+    // for delivery by poll(); the caller must not send the sample again
+    bool send(const packet_args &args);
+    void poll();
+
+    // Datagrams udp_sendto accepted, including resends
+    uint32_t sent() const;
+    uint32_t dropped() const;
+    // Datagrams the server confirmed receiving, always 0 without acknowledgements
+    uint32_t acknowledged() const;
+
+private:
+    struct pending {
+        uint8_t data[UDP_PACKET_MAX_SIZE];
+        size_t length;
+        uint32_t sequence;
+        uint8_t retries;
+        absolute_time_t resend_at;
+        bool in_use;
+    };
+
+    const char *m_host;
+    uint16_t m_port;
+    bool m_acknowledge, m_resolved;
+    udp_pcb *m_pcb;
+    ip_addr_t m_addr;
+    uint32_t m_sequence, m_sent, m_dropped, m_acknowledged;
+    std::array<pending, UDP_TRANSPORT_PENDING> m_pending;
+
+    bool transmit(const uint8_t *data, size_t length);
+    pending *allocate();
+
+    static void dns_callback(const char *name, const ip_addr_t *addr, void *arg);
+    static void recv_callback(void *arg, udp_pcb *pcb, pbuf *p, const ip_addr_t *addr, u16_t port);
+};
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <array>
+#include <optional>
+
+#include "units.h"
+
+// Wind is averaged over fixed periods of the tracker's own clock, so the
+// reported speed does not depend on how often update() is called. 3 s is
+// the WMO averaging period for gusts.
+#define WIND_PERIOD_MS      3000
+#define WIND_GUST_WINDOW_MS (10 * 60 * 1000)
+#define WIND_GUST_SLOTS     (WIND_GUST_WINDOW_MS / WIND_PERIOD_MS)
+
+// Converts a cumulative anemometer pulse count into wind speed and tracks
+// the peak speed over a sliding window. Has no hardware dependencies.
+class wind_tracker {
+public:
+    // Cup anemometers are commonly rated at 2.4 km/h per pulse per second
+    wind_tracker(float kmph_per_hz = 2.4f);
+
+    // Pulses counted since the previous call are spread evenly over the
+    // time in between and credited to the periods that time covers
+    void update(uint32_t count, uint32_t now_ms, std::optional<degree_compass_t> direction = {});
+    void reset();
+
+    // Average over the last complete period
+    std::optional<kmph_t> speed() const;
+    // Highest period average within the gust window
+    std::optional<kmph_t> gust() const;
+    std::optional<degree_compass_t> gust_direction() const;
+
+private:
+    struct sample {
+        kmph_t speed;
+        std::optional<degree_compass_t> direction;
+    };
+
+    std::array<sample, WIND_GUST_SLOTS> m_ring;
+    size_t m_head, m_size, m_gust;
+    float m_kmph_per_hz, m_pulses;
+    uint32_t m_last_count, m_last_ms, m_period_start_ms;
+    bool m_primed;
+
+    void close_period(std::optional<degree_compass_t> direction);
+    const sample& newest() const;
+    void find_gust();
+};
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <optional>
+#include <span>
+
+#include "units.h"
+
+#define WIND_VANE_POSITIONS 16
+
+// Decodes the common 16 position reed switch/resistor ladder wind vane
+// (Argent Data/SparkFun style) read through a pull-up into a 12 bit ADC.
+// Has no hardware dependencies.
+class wind_vane {
+public:
+    wind_vane(float pullup_ohms = 10000.0f, uint16_t tolerance_counts = 40);
+
+    // Direction of a single sample, empty if it matches no ladder position
+    std::optional<degree_compass_t> lookup(uint16_t counts) const;
+    // Vector average of every stride'th sample starting at offset
+    std::optional<degree_compass_t> average(std::span<const uint16_t> samples, size_t offset = 0, size_t stride = 1) const;
+
+private:
+    struct position {
+        uint16_t counts;
+        uint8_t index;
+    };
+    // Sorted by counts
+    position m_table[WIND_VANE_POSITIONS];
+    uint16_t m_tolerance;
+
+    int find(uint16_t counts) const;
+};
@@ -0,0 +1,94 @@
+"""
+Extracts an I2C trace dumped by a node built with I2C_TRACE=1 from a serial
+log and decodes it. The binary format is described in include/i2c_trace_format.h.
+
+    python i2c_trace.py serial.log -o session.bin
+    python i2c_trace.py session.bin
+"""
+import argparse
+import sys
+
+MAGIC = b"I2CT"
+VERSION = 1
+FLAG_READ = 0x01
+FLAG_NOSTOP = 0x02
+FLAG_BUS1 = 0x04
+FLAG_FAILED = 0x08
+
+def extract(lines):
+    data = bytearray()
+    inside = False
+    for line in lines:
+        line = line.strip()
+        if not line.startswith("I2CTRACE"):
+            continue
+        payload = line[len("I2CTRACE"):].strip()
+        if payload.startswith("BEGIN"):
+            data = bytearray()
+            inside = True
+        elif payload.startswith("END"):
+            inside = False
+        elif inside:
+            data += bytes.fromhex(payload)
+    return bytes(data)
+
+def varint(data: bytes, offset: int):
+    value = 0
+    for i in range(5):
+        byte = data[offset + i]
+        value |= (byte & 0x7F) << (7 * i)
+        if not byte & 0x80:
+            return value, offset + i + 1
+    raise ValueError("Invalid varint")
+
+def decode(data: bytes):
+    if data[:4] != MAGIC or data[4] != VERSION:
+        raise ValueError("Not an I2C trace")
+    offset = 5
+    while offset < len(data):
+        flags, address = data[offset], data[offset + 1]
+        delta, offset = varint(data, offset + 2)
+        duration, offset = varint(data, offset)
+        length = data[offset]
+        offset += 1
+        rc = length
+        if flags & FLAG_FAILED:
+            rc = int.from_bytes(data[offset:offset + 1], "little", signed=True)
+            offset += 1
+        payload = b""
+        if not (flags & FLAG_FAILED and flags & FLAG_READ):
+            payload = data[offset:offset + length]
+            offset += length
+        yield {
+            "read": bool(flags & FLAG_READ),
+            "nostop": bool(flags & FLAG_NOSTOP),
+            "bus": 1 if flags & FLAG_BUS1 else 0,
+            "address": address,
+            "delta_us": delta,
+            "duration_us": duration,
+            "rc": rc,
+            "data": payload,
+        }
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("input", help="Serial log containing an I2CTRACE dump, or a binary trace")
+    parser.add_argument("-o", "--output", help="Write the binary trace here")
+    args = parser.parse_args()
+
+    with open(args.input, "rb") as f:
+        raw = f.read()
+    trace = raw if raw[:5] == MAGIC + bytes([VERSION]) else extract(raw.decode(errors="replace").splitlines())
+    if not trace:
+        sys.exit("No trace found")
+    if args.output:
+        with open(args.output, "wb") as f:
+            f.write(trace)
+
+    elapsed = 0
+    for record in decode(trace):
+        elapsed += record["delta_us"]
+        direction = "R" if record["read"] else "W"
+        status = "" if record["rc"] >= 0 else f" rc={record['rc']}"
+        print(f"{elapsed / 1e6:12.6f} i2c{record['bus']} 0x{record['address']:02x} {direction} "
+              f"{record['duration_us']:6d}us {record['data'].hex(' ')}{status}")
@@ -0,0 +1,147 @@
+"""
+Builds a delta patch that turns one firmware image into another, for the
+node's over-the-air updates. Images are the .bin files written by
+pico_add_extra_outputs. The patch format is described in include/delta_patch.h.
+
+    python make_delta.py old.bin new.bin -o update.wndp
+    python make_delta.py old.bin new.bin -o update.wndp --check
+"""
+import argparse
+import struct
+import sys
+import zlib
+
+MAGIC = b"WNDP"
+VERSION = 1
+OP_END = 0x00
+OP_COPY = 0x01
+OP_DATA = 0x02
+# Length of the blocks used to find matches, and the shortest copy worth encoding
+BLOCK = 16
+MIN_COPY = 12
+
+def put_varint(value: int) -> bytes:
+    out = bytearray()
+    while True:
+        byte = value & 0x7F
+        value >>= 7
+        out.append(byte | (0x80 if value else 0))
+        if not value:
+            return bytes(out)
+
+def get_varint(data: bytes, offset: int):
+    value = 0
+    shift = 0
+    while True:
+        byte = data[offset]
+        offset += 1
+        value |= (byte & 0x7F) << shift
+        shift += 7
+        if not byte & 0x80:
+            return value, offset
+
+def index(old: bytes):
+    # Thumb code is halfword aligned, so matches start on even offsets
+    blocks = {}
+    for offset in range(0, len(old) - BLOCK + 1, 2):
+        blocks.setdefault(old[offset:offset + BLOCK], offset)
+    return blocks
+
+def diff(old: bytes, new: bytes) -> bytes:
+    blocks = index(old)
+    ops = bytearray()
+    literal = bytearray()
+    expected = None
+
+    def flush():
+        if literal:
+            ops.append(OP_DATA)
+            ops.extend(put_varint(len(literal)))
+            ops.extend(literal)
+            literal.clear()
+
+    position = 0
+    while position < len(new):
+        source = None
+        # Code after a small edit usually continues where the last copy left off
+        if expected is not None and old[expected:expected + MIN_COPY] == new[position:position + MIN_COPY]:
+            source = expected
+        else:
+            source = blocks.get(new[position:position + BLOCK])
+        if source is None:
+            literal.append(new[position])
+            position += 1
+            continue
+        # Take back what the literal run already covers
+        while literal and source > 0 and old[source - 1] == literal[-1]:
+            literal.pop()
+            source -= 1
+            position -= 1
+        length = 0
+        while position + length < len(new) and source + length < len(old) \
+                and old[source + length] == new[position + length]:
+            length += 1
+        if length < MIN_COPY:
+            step = max(length, 1)
+            literal.extend(new[position:position + step])
+            position += step
+            expected = None
+            continue
+        flush()
+        ops.append(OP_COPY)
+        ops.extend(put_varint(source))
+        ops.extend(put_varint(length))
+        position += length
+        expected = source + length
+    flush()
+    ops.append(OP_END)
+
+    header = MAGIC + bytes([VERSION, 0, 0, 0]) + struct.pack(
+        "<IIII", len(old), zlib.crc32(old), len(new), zlib.crc32(new))
+    return header + bytes(ops)
+
+def apply(old: bytes, patch: bytes) -> bytes:
+    if patch[:5] != MAGIC + bytes([VERSION]):
+        raise ValueError("not a delta patch")
+    old_size, old_crc, new_size, new_crc = struct.unpack_from("<IIII", patch, 8)
+    if old_size != len(old) or old_crc != zlib.crc32(old):
+        raise ValueError("patch does not apply to this image")
+    out = bytearray()
+    offset = 24
+    while True:
+        op = patch[offset]
+        offset += 1
+        if op == OP_END:
+            break
+        if op == OP_COPY:
+            source, offset = get_varint(patch, offset)
+            length, offset = get_varint(patch, offset)
+            out += old[source:source + length]
+        elif op == OP_DATA:
+            length, offset = get_varint(patch, offset)
+            out += patch[offset:offset + length]
+            offset += length
+        else:
+            raise ValueError(f"unknown operation {op:#x}")
+    if len(out) != new_size or zlib.crc32(out) != new_crc:
+        raise ValueError("patched image does not verify")
+    return bytes(out)
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("old", help="image running on the node")
+    parser.add_argument("new", help="image to update to")
+    parser.add_argument("-o", "--output", required=True, help="patch to write")
+    parser.add_argument("--check", action="store_true", help="apply the patch again and verify the result")
+    args = parser.parse_args()
+
+    with open(args.old, "rb") as f:
+        old = f.read()
+    with open(args.new, "rb") as f:
+        new = f.read()
+    patch = diff(old, new)
+    if args.check and apply(old, patch) != new:
+        sys.exit("patch does not reproduce the new image")
+    with open(args.output, "wb") as f:
+        f.write(patch)
+    print(f"{len(old)} -> {len(new)} bytes, patch {len(patch)} bytes ({100 * len(patch) / max(len(new), 1):.1f}%)")
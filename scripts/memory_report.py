@@ -0,0 +1,115 @@
+"""
+Attributes the flash and RAM used by pico_weathernode to the modules that
+use it, from the GNU ld map file written during the link.
+
+    python memory_report.py build/pico_weathernode.memory.map -o report.txt
+"""
+import argparse
+import os
+import re
+import sys
+from collections import defaultdict
+
+FLASH = range(0x10000000, 0x20000000)
+RAM = range(0x20000000, 0x20042000)
+
+OUTPUT_SECTION = re.compile(r"^(\.\S+)\s+0x([0-9a-f]+)\s+0x([0-9a-f]+)(?:\s+load address 0x([0-9a-f]+))?")
+INPUT_SECTION = re.compile(r"^ (\.\S+|COMMON)(?:\s+0x([0-9a-f]+)\s+0x([0-9a-f]+)\s+(\S.*))?$")
+CONTINUATION = re.compile(r"^\s+0x([0-9a-f]+)\s+0x([0-9a-f]+)\s+(\S.*)$")
+
+def module_name(path: str) -> str:
+    path = path.replace("\\", "/")
+    archive = re.match(r"(.*?)([^/]+\.a)\((.*)\)$", path)
+    if archive:
+        path = archive.group(1) + archive.group(3)
+        library = archive.group(2)
+    else:
+        library = None
+    path = re.sub(r"^.*CMakeFiles/[^/]+\.dir/", "", path)
+    # SDK sources are compiled into the executable, group them by SDK library
+    sdk = re.search(r"pico-sdk/src/[^/]+/([^/]+)/", path)
+    if sdk:
+        return f"sdk:{sdk.group(1)}"
+    third_party = re.search(r"pico-sdk/lib/([^/]+)/", path)
+    if third_party:
+        return third_party.group(1)
+    if "pico-web-client/" in path:
+        nested = re.search(r"pico-web-client/lib/([^/]+)/", path)
+        return nested.group(1) if nested else "pico-web-client"
+    if library:
+        return library
+    return os.path.basename(path).replace(".obj", "").replace(".o", "")
+
+def parse(lines):
+    usage = defaultdict(lambda: {"flash": 0, "ram": 0})
+    in_map = False
+    loaded_from_flash = False
+    pending = None
+    for line in lines:
+        line = line.rstrip("\n")
+        if line.startswith("Linker script and memory map"):
+            in_map = True
+            continue
+        if not in_map:
+            continue
+        output = OUTPUT_SECTION.match(line)
+        if output:
+            load = output.group(4)
+            loaded_from_flash = load is not None and int(load, 16) in FLASH
+            pending = None
+            continue
+        if pending is not None:
+            continuation = CONTINUATION.match(line)
+            pending = None
+            if continuation:
+                add(usage, continuation.group(1), continuation.group(2), continuation.group(3), loaded_from_flash)
+                continue
+        section = INPUT_SECTION.match(line)
+        if not section:
+            continue
+        if section.group(2) is None:
+            # Long section names put the address, size and file on the next line
+            pending = section.group(1)
+            continue
+        add(usage, section.group(2), section.group(3), section.group(4), loaded_from_flash)
+    return usage
+
+def add(usage, address: str, size: str, path: str, loaded_from_flash: bool):
+    address, size = int(address, 16), int(size, 16)
+    if size == 0:
+        return
+    module = module_name(path.strip())
+    if address in FLASH:
+        usage[module]["flash"] += size
+    elif address in RAM:
+        usage[module]["ram"] += size
+        if loaded_from_flash:
+            usage[module]["flash"] += size
+
+def report(usage) -> str:
+    rows = sorted(usage.items(), key=lambda item: (item[1]["ram"] + item[1]["flash"]), reverse=True)
+    total_flash = sum(u["flash"] for u in usage.values())
+    total_ram = sum(u["ram"] for u in usage.values())
+    width = max([len(name) for name in usage] + [6])
+    lines = [f"{'Module':<{width}} {'Flash':>9} {'RAM':>9}"]
+    for name, u in rows:
+        lines.append(f"{name:<{width}} {u['flash']:>9} {u['ram']:>9}")
+    lines.append(f"{'Total':<{width}} {total_flash:>9} {total_ram:>9}")
+    return "\n".join(lines) + "\n"
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("map", help="Linker map file")
+    parser.add_argument("-o", "--output", help="Write the full report here")
+    parser.add_argument("-n", "--top", type=int, default=10, help="Modules to print to stdout")
+    args = parser.parse_args()
+
+    with open(args.map) as f:
+        text = report(parse(f))
+    if args.output:
+        with open(args.output, "w") as f:
+            f.write(text)
+    lines = text.splitlines()
+    if len(lines) > args.top + 2:
+        lines = lines[:args.top + 1] + lines[-1:]
+    print("\n".join(lines))
@@ -0,0 +1,60 @@
+"""
+Stand-in update server for nodes built with OTA_URL set. Serves a delta from
+whichever known image the node reports running to the latest image, 204 if
+the node is already up to date and 404 if its image is unknown.
+
+    python ota_server.py new.bin --base old.bin --base older.bin --port 8080
+
+then build the node with OTA_URL=http://<this host>:8080/ota
+"""
+import argparse
+import zlib
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+from urllib.parse import parse_qs, urlparse
+
+from make_delta import diff
+
+class UpdateHandler(BaseHTTPRequestHandler):
+    latest = b""
+    bases = {}
+    patches = {}
+
+    def do_GET(self):
+        query = parse_qs(urlparse(self.path).query)
+        try:
+            running = int(query.get("from", [""])[0], 16)
+        except ValueError:
+            self.send_error(400, "missing from")
+            return
+        if running == zlib.crc32(self.latest):
+            self.send_response(204)
+            self.end_headers()
+            return
+        if running not in self.bases:
+            self.send_error(404, "unknown image")
+            return
+        if running not in self.patches:
+            self.patches[running] = diff(self.bases[running], self.latest)
+        patch = self.patches[running]
+        self.log_message("sending %d byte patch from %08x to %08x", len(patch), running, zlib.crc32(self.latest))
+        self.send_response(200)
+        self.send_header("Content-Type", "application/octet-stream")
+        self.send_header("Content-Length", str(len(patch)))
+        self.end_headers()
+        self.wfile.write(patch)
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("latest", help="image nodes should run")
+    parser.add_argument("--base", action="append", default=[], help="image nodes may be running, repeatable")
+    parser.add_argument("--port", type=int, default=8080)
+    args = parser.parse_args()
+
+    with open(args.latest, "rb") as f:
+        UpdateHandler.latest = f.read()
+    for path in args.base:
+        with open(path, "rb") as f:
+            image = f.read()
+        UpdateHandler.bases[zlib.crc32(image)] = image
+    print(f"Serving {zlib.crc32(UpdateHandler.latest):08x} to {len(UpdateHandler.bases)} known image(s) on port {args.port}")
+    ThreadingHTTPServer(("", args.port), UpdateHandler).serve_forever()
@@ -0,0 +1,35 @@
+import socket
+import struct
+import sys
+
+# Must match udp_field in include/udp_packet.h
+FIELDS = [
+    "outTemp", "inTemp", "barometer", "pressure", "windSpeed", "windDir",
+    "windGust", "windGustDir", "outHumidity", "inHumidity", "radiation", "UV",
+    "rain", "txBatteryStatus", "windBatteryStatus", "rainBatteryStatus",
+    "outTempBatteryStatus", "inTempBatteryStatus", "consBatteryVoltage",
+    "heatingVoltage", "supplyVoltage", "referenceVoltage", "rxCheckPercent",
+    "dewpoint", "heatindex",
+]
+HEADER = struct.Struct("<2sBBIq")
+ACK = struct.Struct("<2sBBI")
+FIELD = struct.Struct("<Bf")
+
+if __name__ == "__main__":
+    # Pass --drop-acks to exercise the node's retransmission path
+    drop_acks = "--drop-acks" in sys.argv
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    sock.bind(('', 9836))
+    while True:
+        data, addr = sock.recvfrom(512)
+        if len(data) < HEADER.size:
+            print(f"From {addr}: short datagram {data.hex()}")
+            continue
+        magic, version, flags, sequence, timestamp_us = HEADER.unpack_from(data)
+        fields = {"dateTime": timestamp_us / 1e6} if timestamp_us else {}
+        for offset in range(HEADER.size, len(data) - FIELD.size + 1, FIELD.size):
+            field, value = FIELD.unpack_from(data, offset)
+            fields[FIELDS[field] if field < len(FIELDS) else field] = value
+        print(f"From {addr} #{sequence} v{version} flags {flags:#x}: {fields}")
+        if flags & 0x01 and not drop_acks:
+            sock.sendto(ACK.pack(b"WA", version, 0, sequence), addr)
@@ -8,6 +8,8 @@ import socketio
 import eventlet
 import eventlet.wsgi
 import os, signal
+import socket as pySocket
+import struct
 import time
 import logging
 from http import HTTPStatus
@@ -23,6 +25,7 @@ DRIVER_VERSION  = "0.1"
 log = logging.getLogger(DRIVER_NAME + " Extension v" + DRIVER_VERSION)
 sio_log = logging.getLogger(f"{DRIVER_NAME} v{DRIVER_VERSION} SocketIO")
 http_log = logging.getLogger(f"{DRIVER_NAME} v{DRIVER_VERSION} HTTP")
+udp_log = logging.getLogger(f"{DRIVER_NAME} v{DRIVER_VERSION} UDP")
 
 queue = Queue()
 sio = socketio.Server()
@@ -30,12 +33,54 @@ http = Flask(__name__)
 
 manager: Manager = None
 
+# Must match udp_field in include/udp_packet.h
+UDP_FIELDS = [
+    "outTemp",
+    "inTemp",
+    "barometer",
+    "pressure",
+    "windSpeed",
+    "windDir",
+    "windGust",
+    "windGustDir",
+    "outHumidity",
+    "inHumidity",
+    "radiation",
+    "UV",
+    "rain",
+    "txBatteryStatus",
+    "windBatteryStatus",
+    "rainBatteryStatus",
+    "outTempBatteryStatus",
+    "inTempBatteryStatus",
+    "consBatteryVoltage",
+    "heatingVoltage",
+    "supplyVoltage",
+    "referenceVoltage",
+    "rxCheckPercent",
+    "dewpoint",
+    "heatindex",
+]
+UDP_VERSION = 2
+UDP_FLAG_ACK = 0x01
+UDP_HEADER = struct.Struct("<2sBBIq")
+UDP_ACK = struct.Struct("<2sBBI")
+UDP_FIELD = struct.Struct("<Bf")
+# Sequence numbers remembered per sender to drop retransmitted duplicates
+UDP_DEDUPE_WINDOW = 32
+
+# Node timestamps further than this from the server clock are not trusted
+MAX_CLOCK_SKEW = 24 * 60 * 60
+
 class LoopPacket:
     def __init__(self, **kwargs):
+        self.__timestamp = kwargs.get("dateTime")
         self.__packet = {
             "UV": None,
             "barometer": None,
             "consBatteryVoltage": None,
+            "dewpoint": None,
+            "heatindex": None,
             "heatingVoltage": None,
             "inHumidity": None,
             "inTemp": None,
@@ -62,7 +107,12 @@ class LoopPacket:
                 self.__packet[arg] = kwargs[arg]
     
     def serialize(self):
-        self.__packet["dateTime"] = int(time.time())
+        now = time.time()
+        timestamp = self.__timestamp
+        if not isinstance(timestamp, (int, float)) or abs(timestamp - now) > MAX_CLOCK_SKEW:
+            # Node has not synced its clock, fall back to the time of arrival
+            timestamp = int(now)
+        self.__packet["dateTime"] = timestamp
         self.__packet["usUnits"] = weewx.METRIC
         return self.__packet
 
@@ -118,6 +168,45 @@ def post_loop_packet():
     queue.put(data)
     return Response(status=HTTPStatus.OK)
 
+def decode_udp_packet(data: bytes):
+    if len(data) < UDP_HEADER.size:
+        return None
+    magic, version, flags, sequence, timestamp_us = UDP_HEADER.unpack_from(data)
+    if magic != b"WN" or version != UDP_VERSION:
+        return None
+    fields = {}
+    if timestamp_us:
+        fields["dateTime"] = timestamp_us / 1e6
+    for offset in range(UDP_HEADER.size, len(data) - UDP_FIELD.size + 1, UDP_FIELD.size):
+        field, value = UDP_FIELD.unpack_from(data, offset)
+        if field < len(UDP_FIELDS):
+            fields[UDP_FIELDS[field]] = value
+    return flags, sequence, fields
+
+def encode_udp_ack(sequence: int) -> bytes:
+    return UDP_ACK.pack(b"WA", UDP_VERSION, 0, sequence)
+
+def run_udp(port: int, packets: Queue = queue):
+    sock = pySocket.socket(pySocket.AF_INET, pySocket.SOCK_DGRAM)
+    sock.bind(('', port))
+    recent = {}
+    while True:
+        data, addr = sock.recvfrom(512)
+        decoded = decode_udp_packet(data)
+        if decoded is None:
+            udp_log.warning(f"Invalid datagram from {addr}")
+            continue
+        flags, sequence, fields = decoded
+        if flags & UDP_FLAG_ACK:
+            sock.sendto(encode_udp_ack(sequence), addr)
+        seen = recent.setdefault(addr[0], [])
+        if sequence in seen:
+            udp_log.debug(f"Duplicate sequence {sequence} from {addr}")
+            continue
+        seen.append(sequence)
+        del seen[:-UDP_DEDUPE_WINDOW]
+        packets.put(fields)
+
 def run_socketio(port: int):
     log = logging.getLogger(__name__)
     app = socketio.WSGIApp(sio)
@@ -153,6 +242,12 @@ class PicoWeathernode(weewx.drivers.AbstractDevice):
         log.info("Starting http server...")
         self.__http_process = Process(target=run_http, args=[self.__http_port], daemon=True)
         self.__http_process.start()
+        self.__udp_port = int(config["udp_port"]) if "udp_port" in config else None
+        self.__udp_process = None
+        if self.__udp_port:
+            log.info("Starting udp listener...")
+            self.__udp_process = Process(target=run_udp, args=[self.__udp_port], daemon=True)
+            self.__udp_process.start()
 
     def genLoopPackets(self):
         while True:
@@ -162,6 +257,9 @@ class PicoWeathernode(weewx.drivers.AbstractDevice):
             if self.__http_process.exitcode:
                 self.__http_process = Process(target=run_http, args=[self.__http_port], daemon=True)
                 self.__http_process.start()
+            if self.__udp_process and self.__udp_process.exitcode:
+                self.__udp_process = Process(target=run_udp, args=[self.__udp_port], daemon=True)
+                self.__udp_process.start()
             try:
                 data = queue.get(timeout=1)
                 packet = LoopPacket(**data)
@@ -173,6 +271,8 @@ class PicoWeathernode(weewx.drivers.AbstractDevice):
         log.info("Closing")
         os.kill(self.__sio_process.pid, signal.SIGINT)
         os.kill(self.__http_process.pid, signal.SIGINT)
+        if self.__udp_process:
+            os.kill(self.__udp_process.pid, signal.SIGINT)
 
     @property
     def hardware_name(self):
@@ -199,9 +299,11 @@ class PicoWeathernodeConfEditor(weewx.drivers.AbstractConfEditor):
     sio_port = 9834
     # The port to listen on for http connections
     http_port = 9835
+    # The port to listen on for udp datagrams, for nodes built with WEEWX_TRANSPORT=udp
+    udp_port = 9836
 """
 
 if __name__ == "__main__":
-    station = PicoWeathernode(sio_port=9834, http_port=9835)
+    station = PicoWeathernode(sio_port=9834, http_port=9835, udp_port=9836)
     for packet in station.genLoopPackets():
         print(packet)
\ No newline at end of file
@@ -0,0 +1,124 @@
+#include "adaptive_rate.h"
+
+#include <math.h>
+
+adaptive_rate::adaptive_rate(std::span<const float> thresholds_per_min, uint32_t min_interval_ms, uint32_t max_interval_ms)
+    : m_thresholds{}
+    , m_values{}
+    , m_times{}
+    , m_channels(thresholds_per_min.size() < ADAPTIVE_RATE_CHANNELS ? thresholds_per_min.size() : ADAPTIVE_RATE_CHANNELS)
+    , m_history_head(0)
+    , m_history_size(0)
+    , m_min_ms(min_interval_ms)
+    , m_max_ms(max_interval_ms < min_interval_ms ? min_interval_ms : max_interval_ms)
+    , m_interval_ms(min_interval_ms)
+    , m_stable_run(0)
+    , m_log{}
+    , m_log_head(0)
+    , m_log_size(0)
+{
+    for(size_t i = 0; i < m_channels; i++) {
+        m_thresholds[i] = thresholds_per_min[i];
+    }
+}
+
+uint32_t adaptive_rate::update(std::span<const float> values, uint32_t now_ms) {
+    size_t channels = values.size() < m_channels ? values.size() : m_channels;
+    size_t newest = (m_history_head + m_times.size() - 1) % m_times.size();
+    if(m_history_size > 0 && now_ms == m_times[newest]) {
+        // Same sample time, the newer values replace the older ones
+        for(size_t i = 0; i < channels; i++) {
+            m_values[i][newest] = values[i];
+        }
+        return m_interval_ms;
+    }
+    m_times[m_history_head] = now_ms;
+    for(size_t i = 0; i < channels; i++) {
+        m_values[i][m_history_head] = values[i];
+    }
+    m_history_head = (m_history_head + 1) % m_times.size();
+    if(m_history_size < m_times.size()) {
+        m_history_size++;
+    }
+    if(m_history_size == 1) {
+        record(now_ms, 0.0f, reason::first);
+        return m_interval_ms;
+    }
+
+    float ratio = 0.0f;
+    for(size_t i = 0; i < channels; i++) {
+        float rate = fabsf(slope_per_min(i));
+        float channel_ratio = m_thresholds[i] > 0.0f ? rate / m_thresholds[i] : 0.0f;
+        if(channel_ratio > ratio) {
+            ratio = channel_ratio;
+        }
+    }
+
+    if(ratio > 1.0f) {
+        m_stable_run = 0;
+        m_interval_ms = m_interval_ms / 2 < m_min_ms ? m_min_ms : m_interval_ms / 2;
+        record(now_ms, ratio, reason::fast);
+    } else if(ratio < 0.5f && ++m_stable_run >= ADAPTIVE_RATE_STABLE_RUN) {
+        m_stable_run = 0;
+        uint32_t next = m_interval_ms + m_interval_ms / 2;
+        m_interval_ms = next > m_max_ms ? m_max_ms : next;
+        record(now_ms, ratio, reason::stable);
+    } else {
+        if(ratio >= 0.5f) {
+            m_stable_run = 0;
+        }
+        record(now_ms, ratio, reason::hold);
+    }
+    return m_interval_ms;
+}
+
+void adaptive_rate::reset() {
+    m_interval_ms = m_min_ms;
+    m_stable_run = 0;
+    m_history_head = 0;
+    m_history_size = 0;
+    m_log_head = 0;
+    m_log_size = 0;
+}
+
+uint32_t adaptive_rate::interval_ms() const {
+    return m_interval_ms;
+}
+
+size_t adaptive_rate::log_size() const {
+    return m_log_size;
+}
+
+const adaptive_rate::decision& adaptive_rate::log(size_t index) const {
+    return m_log[(m_log_head + m_log.size() - m_log_size + index) % m_log.size()];
+}
+
+float adaptive_rate::slope_per_min(size_t channel) const {
+    // Times are taken relative to the newest sample, which keeps them small
+    // enough for float and handles the millisecond clock wrapping
+    size_t newest = (m_history_head + m_times.size() - 1) % m_times.size();
+    float mean_t = 0.0f, mean_v = 0.0f;
+    for(size_t n = 0; n < m_history_size; n++) {
+        size_t index = (newest + m_times.size() - n) % m_times.size();
+        mean_t -= (m_times[newest] - m_times[index]) / 60000.0f;
+        mean_v += m_values[channel][index];
+    }
+    mean_t /= m_history_size;
+    mean_v /= m_history_size;
+    float covariance = 0.0f, variance = 0.0f;
+    for(size_t n = 0; n < m_history_size; n++) {
+        size_t index = (newest + m_times.size() - n) % m_times.size();
+        float t = -((m_times[newest] - m_times[index]) / 60000.0f) - mean_t;
+        covariance += t * (m_values[channel][index] - mean_v);
+        variance += t * t;
+    }
+    return variance > 0.0f ? covariance / variance : 0.0f;
+}
+
+void adaptive_rate::record(uint32_t now_ms, float ratio, reason why) {
+    m_log[m_log_head] = {now_ms, ratio, m_interval_ms, why};
+    m_log_head = (m_log_head + 1) % m_log.size();
+    if(m_log_size < m_log.size()) {
+        m_log_size++;
+    }
+}
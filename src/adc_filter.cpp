@@ -0,0 +1,14 @@
+#include "adc_filter.h"
+
+float adc_mean(std::span<const uint16_t> samples, size_t offset, size_t stride) {
+    uint32_t sum = 0, count = 0;
+    for(size_t i = offset; i < samples.size(); i += stride) {
+        sum += samples[i];
+        count++;
+    }
+    return count ? (float)sum / count : 0.0f;
+}
+
+volt_t adc_to_volts(float counts, float divider) {
+    return counts * (ADC_REFERENCE_VOLTS / ADC_MAX_COUNTS) * divider;
+}
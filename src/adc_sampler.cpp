@@ -0,0 +1,133 @@
+#include "adc_sampler.h"
+
+#include <hardware/adc.h>
+#include <hardware/dma.h>
+#include <hardware/irq.h>
+
+#include "logger.h"
+
+#define ADC_CLOCK_HZ  48000000
+#define ADC_FIRST_PIN 26
+#define ADC_DMA_IRQ   DMA_IRQ_1
+
+// The ADC is a single peripheral, so only one sampler can exist at a time
+static adc_sampler *instance = nullptr;
+
+adc_sampler::adc_sampler(uint8_t channel_mask, uint32_t sample_rate_hz)
+    : m_buffers{}
+    , m_length(0)
+    , m_channels(0)
+    , m_dma{-1, -1}
+    , m_sequence(0)
+{
+    trace1("adc_sampler constructor entered...\n");
+    if(instance != nullptr) {
+        error1("adc_sampler: already in use\n");
+        return;
+    }
+    channel_mask &= (1 << ADC_SAMPLER_MAX_CHANNELS) - 1;
+    if(channel_mask == 0) {
+        error1("adc_sampler: no channels selected\n");
+        return;
+    }
+    m_dma[0] = dma_claim_unused_channel(false);
+    m_dma[1] = dma_claim_unused_channel(false);
+    if(m_dma[0] < 0 || m_dma[1] < 0) {
+        error1("adc_sampler: no free dma channels\n");
+        for(int &channel : m_dma) {
+            if(channel >= 0) {
+                dma_channel_unclaim(channel);
+                channel = -1;
+            }
+        }
+        return;
+    }
+    instance = this;
+
+    adc_init();
+    uint8_t first = 0xFF;
+    for(uint8_t channel = 0; channel < ADC_SAMPLER_MAX_CHANNELS; channel++) {
+        if((channel_mask & (1 << channel)) == 0) {
+            continue;
+        }
+        if(channel < 4) {
+            adc_gpio_init(ADC_FIRST_PIN + channel);
+        } else {
+            adc_set_temp_sensor_enabled(true);
+        }
+        if(first == 0xFF) {
+            first = channel;
+        }
+        m_channels++;
+    }
+    // A whole number of round robin passes per buffer keeps every buffer
+    // starting on the first enabled channel
+    m_length = m_channels * ADC_SAMPLER_SAMPLES_PER_CHANNEL;
+
+    adc_select_input(first);
+    adc_set_round_robin(channel_mask);
+    adc_fifo_setup(true, true, 1, false, false);
+    adc_set_clkdiv((float)ADC_CLOCK_HZ / sample_rate_hz - 1.0f);
+
+    configure_dma(0);
+    configure_dma(1);
+    irq_add_shared_handler(ADC_DMA_IRQ, dma_irq_handler, PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY);
+    dma_irqn_set_channel_enabled(1, m_dma[0], true);
+    dma_irqn_set_channel_enabled(1, m_dma[1], true);
+    irq_set_enabled(ADC_DMA_IRQ, true);
+
+    dma_channel_start(m_dma[0]);
+    adc_run(true);
+    trace1("adc_sampler constructor exited.\n");
+}
+
+adc_sampler::~adc_sampler() {
+    if(instance != this) {
+        return;
+    }
+    adc_run(false);
+    for(int channel : m_dma) {
+        dma_irqn_set_channel_enabled(1, channel, false);
+        dma_channel_abort(channel);
+        dma_channel_unclaim(channel);
+    }
+    irq_remove_handler(ADC_DMA_IRQ, dma_irq_handler);
+    adc_fifo_drain();
+    adc_set_round_robin(0);
+    instance = nullptr;
+}
+
+bool adc_sampler::valid() const {
+    return instance == this;
+}
+
+size_t adc_sampler::channels() const {
+    return m_channels;
+}
+
+void adc_sampler::configure_dma(int index) {
+    dma_channel_config c = dma_channel_get_default_config(m_dma[index]);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_16);
+    channel_config_set_read_increment(&c, false);
+    channel_config_set_write_increment(&c, true);
+    channel_config_set_dreq(&c, DREQ_ADC);
+    // Ping-pong: each channel starts the other when its buffer is full
+    channel_config_set_chain_to(&c, m_dma[index ^ 1]);
+    dma_channel_configure(m_dma[index], &c, m_buffers[index], &adc_hw->fifo, m_length, false);
+}
+
+void adc_sampler::dma_irq_handler() {
+    if(instance == nullptr) {
+        return;
+    }
+    for(int index = 0; index < 2; index++) {
+        int channel = instance->m_dma[index];
+        if(!dma_irqn_get_channel_status(1, channel)) {
+            continue;
+        }
+        dma_irqn_acknowledge_channel(1, channel);
+        // Rewind so the next chain trigger refills the same buffer
+        dma_channel_set_write_addr(channel, instance->m_buffers[index], false);
+        instance->m_sequence = instance->m_sequence + 1;
+    }
+}
@@ -6,6 +6,7 @@
 #include <stdio.h>
 #include "logger.h"
 #include "crc8.h"
+#include "i2c_trace.h"
 
 #define AHT20_I2C_ADDR      0x38
 #define AHT20_I2C_STATUS    0x71
@@ -36,6 +37,7 @@ int64_t aht20::retrieve_measurement_callback(alarm_id_t alarm, void* user_data)
         warn("CRC check failed:\n    Provided   %02x\n    Calculated %02x\n", sensor->m_rbuffer[6], crc);
         return -1000;
     }
+    sensor->m_sampled_at = get_absolute_time();
     trace1("aht20::retrieve_measurement_callback exiting: CRC check passed!\n");
 
     sensor->m_alarm = 0;
@@ -57,6 +59,7 @@ aht20::aht20(i2c_inst_t *instance, uint32_t baud, uint8_t sda_pin, uint8_t scl_p
     , m_wlen(0)
     , m_alarm(0)
     , m_busy_until(nil_time)
+    , m_sampled_at(nil_time)
 {
     if(gpio_get_function(sda_pin) != GPIO_FUNC_I2C) {
         i2c_init(m_i2c, baud);
@@ -198,12 +201,17 @@ uint32_t aht20::raw_temperature() const {
     return (m_rbuffer[3] & 0x0F) << 16 | m_rbuffer[4] << 8 | m_rbuffer[5];
 }
 
+absolute_time_t aht20::sampled_at() const {
+    trace1("aht20::sampled_at\n");
+    return m_sampled_at;
+}
+
 int aht20::read(uint8_t count) {
     trace("aht20::read count %d m_i2c %p\n", count, m_i2c);
     if(count > sizeof(m_rbuffer)) {
         return PICO_ERROR_GENERIC;
     }
-    int rc = i2c_read_blocking(m_i2c, AHT20_I2C_ADDR, m_rbuffer, count, false);
+    int rc = i2c_trace_read_blocking(m_i2c, AHT20_I2C_ADDR, m_rbuffer, count, false);
 #if LOG_LEVEL <= LOG_LEVEL_TRACE
     trace1("Read data:\n");
     for(int i = 0; i < rc; i++) {
@@ -219,7 +227,7 @@ int aht20::write(uint8_t count) {
     if(count > sizeof(m_wbuffer)) {
         return PICO_ERROR_GENERIC;
     }
-    int rc = i2c_write_blocking(m_i2c, AHT20_I2C_ADDR, m_wbuffer, count, false);
+    int rc = i2c_trace_write_blocking(m_i2c, AHT20_I2C_ADDR, m_wbuffer, count, false);
 #if LOG_LEVEL <= LOG_LEVEL_TRACE
     trace1("Wrote data:\n");
     for(int i = 0; i < rc; i++) {
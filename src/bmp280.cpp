@@ -3,6 +3,8 @@
 #include <stdio.h>
 #include <logger.h>
 
+#include "i2c_trace.h"
+
 #define BMP280_DEFAULT_ADDR 0x76
 #define BMP280_ALT_ADDR     0x77
 #define BMP280_CALIB_BASE   0x88
@@ -27,19 +29,6 @@
 #define BMP280_BUSY_BIT     3
 #define BMP280_BUSY_MASK    (1 << BMP280_BUSY_BIT)
 
-#define BMP280_T1 (((uint16_t)m_trim_params[1]) << 8 | m_trim_params[0])
-#define BMP280_T2 (((int16_t)m_trim_params[3]) << 8 | m_trim_params[2])
-#define BMP280_T3 (((int16_t)m_trim_params[5]) << 8 | m_trim_params[4])
-#define BMP280_P1 (((uint16_t)m_trim_params[7]) << 8 | m_trim_params[6])
-#define BMP280_P2 (((int16_t)m_trim_params[9]) << 8 | m_trim_params[8])
-#define BMP280_P3 (((int16_t)m_trim_params[11]) << 8 | m_trim_params[10])
-#define BMP280_P4 (((int16_t)m_trim_params[13]) << 8 | m_trim_params[12])
-#define BMP280_P5 (((int16_t)m_trim_params[15]) << 8 | m_trim_params[14])
-#define BMP280_P6 (((int16_t)m_trim_params[17]) << 8 | m_trim_params[16])
-#define BMP280_P7 (((int16_t)m_trim_params[19]) << 8 | m_trim_params[18])
-#define BMP280_P8 (((int16_t)m_trim_params[21]) << 8 | m_trim_params[20])
-#define BMP280_P9 (((int16_t)m_trim_params[23]) << 8 | m_trim_params[22])
-
 int64_t measurement_delay_us(bmp280::standby standby_val) {
     switch(standby_val) {
     case bmp280::standby::half_ms:
@@ -80,7 +69,7 @@ bmp280::bmp280(bool default_addr, i2c_inst_t *instance, uint32_t baud, uint8_t s
     : m_addr(default_addr ? BMP280_DEFAULT_ADDR : BMP280_ALT_ADDR)
     , m_i2c(instance)
     , m_alarm(0)
-    , m_trim_params{0}
+    , m_calib{0}
     , m_tfine(0)
     , m_temperature(0)
     , m_pressure(0)
@@ -103,7 +92,7 @@ bmp280::bmp280(bool default_addr, i2c_inst_t *instance, uint32_t baud, uint8_t s
         error("bmp280: ID mismatch - read 0x%02x, expected 0x%02x\n", m_id, BMP280_CHIP_ID);
     }
     trace1("Reading calibration data... ");
-    rc = read(BMP280_CALIB_BASE, {m_trim_params, sizeof(m_trim_params)});
+    rc = read_calibration();
     trace_cont("rc = %d\n", rc);
     trace1("bmp280 constructor exited.\n");
 }
@@ -121,7 +110,8 @@ bmp280::status bmp280::measure() {
     trace1("bmp280::measure entered...\n");
     if(m_mode != bmp280::mode::normal && m_alarm == 0) {
         set_mode(bmp280::mode::forced);
-        m_alarm = add_alarm_in_us(measurement_delay_us(m_standby), retrieve_measurement_callback, this, true);
+        // The delays are negative for the alarm callback's rescheduling
+        m_alarm = add_alarm_in_us(-measurement_delay_us(m_standby), retrieve_measurement_callback, this, true);
         trace("bmp280::measure setting alarm %08x\n", m_alarm);
         return m_alarm >= 0 ? bmp280::status::ERR_BUSY : bmp280::status::ERR_FAIL;
     }
@@ -151,6 +141,10 @@ uint8_t bmp280::chip_id() const {
     return m_id;
 }
 
+const bmp280::calibration& bmp280::trim() const {
+    return m_calib;
+}
+
 celsius_t bmp280::temperature() {
     trace1("bmp280::temperature entered...\n");
     if(m_needs_conversion) {
@@ -166,7 +160,7 @@ mbar_t bmp280::pressure() {
     if(m_needs_conversion) {
         convert();
     }
-    mbar_t to_return = (mbar_t)(m_pressure / 256.0f) / 100.0f;
+    mbar_t to_return = (mbar_t)m_pressure / 100.0f;
     trace("bmp280::pressure returning %.2f\n", to_return);
     m_has_data = false;
     return to_return;
@@ -231,12 +225,12 @@ void bmp280::read_raw_data() {
 
 int bmp280::read(uint8_t addr, std::span<uint8_t> buffer) {
     trace("bmp280::read 0x%02x %d entered...\n", addr, buffer.size());
-    int rc = i2c_write_blocking(m_i2c, m_addr, &addr, 1, true);
+    int rc = i2c_trace_write_blocking(m_i2c, m_addr, &addr, 1, true);
     if(rc == PICO_ERROR_GENERIC) {
         error("Read address 0x%02x failed!\n", addr);
         return rc;
     }
-    rc = i2c_read_blocking(m_i2c, m_addr, buffer.data(), buffer.size(), false);
+    rc = i2c_trace_read_blocking(m_i2c, m_addr, buffer.data(), buffer.size(), false);
     trace("bmp280::read exiting (rc = %d)\n", rc);
     return rc;
 }
@@ -250,43 +244,37 @@ int bmp280::write(uint8_t addr, std::span<uint8_t> buffer) {
         transfer[2 * i] = addr + i;
         transfer[2 * i + 1] = buffer[i];
     }
-    int rc = i2c_write_blocking(m_i2c, m_addr, transfer, 2 * buffer.size(), false);
+    int rc = i2c_trace_write_blocking(m_i2c, m_addr, transfer, 2 * buffer.size(), false);
     trace("bmp280::write exiting (rc = %d)\n", rc);
     return rc == PICO_ERROR_GENERIC ? rc : rc / 2;
 }
 
+int bmp280::read_calibration() {
+    trace1("bmp280::read_calibration entered...\n");
+    uint8_t data[BMP280_CALIB_LEN];
+    int rc = read(BMP280_CALIB_BASE, {data, sizeof(data)});
+    if(rc == PICO_ERROR_GENERIC) {
+        error1("bmp280: failed to read calibration data\n");
+        return rc;
+    }
+    m_calib = bmp280_decode_calibration(data);
+    trace("bmp280::read_calibration exiting (rc = %d)\n", rc);
+    return rc;
+}
+
 int32_t bmp280::calc_temp() {
     trace1("bmp280::calc_temp entered...\n");
-    // Taken from bosch bmp280 datasheet
-    int32_t var1, var2;
-    var1 = ((((m_raw_temperature >> 3) - ((int32_t)BMP280_T1 << 1))) * ((int32_t)BMP280_T2)) >> 11;
-    var2 = (((((m_raw_temperature >> 4) - ((int32_t)BMP280_T1)) * ((m_raw_temperature >> 4) - ((int32_t)BMP280_T1))) >> 12) * ((int32_t)BMP280_T3)) >> 14;
-    m_tfine = var1 + var2;
-    m_temperature = (m_tfine * 5 + 128) >> 8;
+    m_temperature = bmp280_compensate_temperature(m_calib, (int32_t)m_raw_temperature, m_tfine);
     trace("bmp280::calc_temp exiting. m_tfine = %d, m_temperature = %d\n", m_tfine, m_temperature);
     return m_temperature;
 }
 
 uint32_t bmp280::calc_pressure() {
     trace1("bmp280::calc_pressure entered...\n");
-    // Taken from bosch bmp280 datasheet
-    int64_t var1, var2, pressure;
-    var1 = ((int64_t)m_tfine) - 128000;
-    var2 = var1 * var1 * (int64_t)BMP280_P6;
-    var2 = var2 + ((var1 * (int64_t)BMP280_P5) << 17);
-    var2 = var2 + (((int64_t)BMP280_P4) << 35);
-    var1 = ((var1 * var1 * (int64_t)BMP280_P3) >> 8) + ((var1 * (int64_t)BMP280_P2) << 12);
-    var1 = (((1ll << 47) + var1)) * ((int64_t)BMP280_P1) >> 33;
-    if(var1 == 0) {
-        warn1("bmp280::calc_pressure exiting since var1 is zero.\n");
-        return 0;
+    m_pressure = bmp280_compensate_pressure(m_calib, (int32_t)m_raw_pressure, m_tfine);
+    if(m_pressure == 0) {
+        warn1("bmp280::calc_pressure: calibration has a zero divisor.\n");
     }
-    pressure = 1048576 - m_raw_pressure;
-    pressure = (((pressure << 31) - var2) * 3125) / var1;
-    var1 = (((int64_t)BMP280_P9) * (pressure >> 13) * (pressure >> 13)) >> 25;
-    var2 = (((int64_t)BMP280_P8) * pressure) >> 19;
-    pressure = ((pressure + var1 + var2) >> 8) + (((int64_t)BMP280_P7) << 4);
-    m_pressure = (uint32_t)pressure;
     trace("bmp280::calc_pressure exiting. m_pressure = %d\n", m_pressure);
     return m_pressure;
 }
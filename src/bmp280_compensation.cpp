@@ -0,0 +1,61 @@
+#include "bmp280_compensation.h"
+
+static uint16_t trim_u16(const uint8_t *data, int index) {
+    return ((uint16_t)data[index + 1]) << 8 | data[index];
+}
+
+static int16_t trim_s16(const uint8_t *data, int index) {
+    return (int16_t)trim_u16(data, index);
+}
+
+bmp280_calibration bmp280_decode_calibration(const uint8_t (&data)[BMP280_CALIB_LEN]) {
+    bmp280_calibration calib;
+    calib.T1 = trim_u16(data, 0);
+    calib.T2 = trim_s16(data, 2);
+    calib.T3 = trim_s16(data, 4);
+    calib.P1 = trim_u16(data, 6);
+    calib.P2 = trim_s16(data, 8);
+    calib.P3 = trim_s16(data, 10);
+    calib.P4 = trim_s16(data, 12);
+    calib.P5 = trim_s16(data, 14);
+    calib.P6 = trim_s16(data, 16);
+    calib.P7 = trim_s16(data, 18);
+    calib.P8 = trim_s16(data, 20);
+    calib.P9 = trim_s16(data, 22);
+    return calib;
+}
+
+int32_t bmp280_compensate_temperature(const bmp280_calibration &calib, int32_t adc_T, int32_t &t_fine) {
+    // Taken from bosch bmp280 datasheet
+    int32_t var1, var2;
+    var1 = ((((adc_T >> 3) - ((int32_t)calib.T1 << 1))) * ((int32_t)calib.T2)) >> 11;
+    var2 = (((((adc_T >> 4) - ((int32_t)calib.T1)) * ((adc_T >> 4) - ((int32_t)calib.T1))) >> 12) * ((int32_t)calib.T3)) >> 14;
+    t_fine = var1 + var2;
+    return (t_fine * 5 + 128) >> 8;
+}
+
+uint32_t bmp280_compensate_pressure(const bmp280_calibration &calib, int32_t adc_P, int32_t t_fine) {
+    // 32 bit fixed point variant from the bosch bmp280 datasheet, result in Pa.
+    // Avoids the 64 bit multiplies and divide of the reference implementation,
+    // the remaining 32 bit divide runs on the RP2040's hardware divider.
+    int32_t var1, var2;
+    uint32_t pressure;
+    var1 = (t_fine >> 1) - 64000;
+    var2 = (((var1 >> 2) * (var1 >> 2)) >> 11) * ((int32_t)calib.P6);
+    var2 = var2 + ((var1 * ((int32_t)calib.P5)) << 1);
+    var2 = (var2 >> 2) + (((int32_t)calib.P4) << 16);
+    var1 = (((calib.P3 * (((var1 >> 2) * (var1 >> 2)) >> 13)) >> 3) + ((((int32_t)calib.P2) * var1) >> 1)) >> 18;
+    var1 = ((32768 + var1) * ((int32_t)calib.P1)) >> 15;
+    if(var1 == 0) {
+        return 0;
+    }
+    pressure = (((uint32_t)(1048576 - adc_P)) - (var2 >> 12)) * 3125;
+    if(pressure < 0x80000000) {
+        pressure = (pressure << 1) / ((uint32_t)var1);
+    } else {
+        pressure = (pressure / (uint32_t)var1) * 2;
+    }
+    var1 = (((int32_t)calib.P9) * ((int32_t)(((pressure >> 3) * (pressure >> 3)) >> 13))) >> 12;
+    var2 = (((int32_t)(pressure >> 2)) * ((int32_t)calib.P8)) >> 13;
+    return (uint32_t)((int32_t)pressure + ((var1 + var2 + calib.P7) >> 4));
+}
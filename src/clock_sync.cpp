@@ -0,0 +1,49 @@
+#include "clock_sync.h"
+
+clock_sync::clock_sync() {
+    reset();
+}
+
+void clock_sync::update(uint64_t local_us, int64_t utc_us) {
+    if(m_synced && local_us > m_local_us && local_us - m_local_us >= CLOCK_SYNC_MIN_SPAN_US) {
+        // How far the previous mapping had wandered by now, as a rate
+        int64_t error_us = utc_us - to_utc_us(local_us);
+        int64_t span_us = local_us - m_local_us;
+        // Errors far beyond any oscillator drift are clock steps, not drift
+        if(error_us < span_us / 1000 && error_us > -span_us / 1000) {
+            int64_t correction_ppb = error_us * 1000000000ll / span_us;
+            int64_t drift = m_drift_ppb + (m_has_drift ? correction_ppb / 2 : correction_ppb);
+            if(drift > CLOCK_SYNC_MAX_DRIFT_PPB) {
+                drift = CLOCK_SYNC_MAX_DRIFT_PPB;
+            } else if(drift < -CLOCK_SYNC_MAX_DRIFT_PPB) {
+                drift = -CLOCK_SYNC_MAX_DRIFT_PPB;
+            }
+            m_drift_ppb = (int32_t)drift;
+            m_has_drift = true;
+        }
+    }
+    m_local_us = local_us;
+    m_utc_us = utc_us;
+    m_synced = true;
+}
+
+void clock_sync::reset() {
+    m_local_us = 0;
+    m_utc_us = 0;
+    m_drift_ppb = 0;
+    m_synced = false;
+    m_has_drift = false;
+}
+
+bool clock_sync::synced() const {
+    return m_synced;
+}
+
+int64_t clock_sync::to_utc_us(uint64_t local_us) const {
+    int64_t elapsed_us = (int64_t)(local_us - m_local_us);
+    return m_utc_us + elapsed_us + elapsed_us * m_drift_ppb / 1000000000ll;
+}
+
+int32_t clock_sync::drift_ppb() const {
+    return m_drift_ppb;
+}
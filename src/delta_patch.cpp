@@ -0,0 +1,181 @@
+#include "delta_patch.h"
+
+#include <string.h>
+#include <algorithm>
+
+#include "crc32.h"
+#include "logger.h"
+
+static const uint8_t magic[4] = {'W', 'N', 'D', 'P'};
+
+static uint32_t get_u32(const uint8_t *data) {
+    return data[0] | (data[1] << 8) | (data[2] << 16) | ((uint32_t)data[3] << 24);
+}
+
+delta_patch::delta_patch(flash_device &flash, uint32_t source_offset, size_t source_size,
+                         uint32_t target_offset, size_t target_capacity)
+    : m_flash(flash), m_source_offset(source_offset), m_source_size(source_size),
+      m_target_offset(target_offset), m_target_capacity(target_capacity) {
+}
+
+delta_patch::status delta_patch::fail(const char *reason) {
+    error("delta_patch: %s after %zu bytes\n", reason, m_written);
+    m_status = status::failed;
+    return m_status;
+}
+
+bool delta_patch::check_header() {
+    if(memcmp(m_header, magic, sizeof(magic)) != 0 || m_header[4] != DELTA_PATCH_VERSION) {
+        return false;
+    }
+    m_old_size = get_u32(m_header + 8);
+    uint32_t old_crc = get_u32(m_header + 12);
+    m_new_size = get_u32(m_header + 16);
+    m_new_crc = get_u32(m_header + 20);
+    debug("delta_patch: %zu bytes (crc %08lx) -> %zu bytes (crc %08lx)\n",
+        m_old_size, (unsigned long)old_crc, m_new_size, (unsigned long)m_new_crc);
+
+    if(m_old_size > m_source_size || m_new_size == 0 || m_new_size > m_target_capacity) {
+        return false;
+    }
+    // A patch only makes sense against the exact image it was built from
+    auto source = m_flash.read(m_source_offset, m_old_size);
+    return source.size() == m_old_size && crc32(source.data(), source.size()) == old_crc;
+}
+
+bool delta_patch::varint(uint8_t byte, uint32_t &value) {
+    m_varint |= (uint32_t)(byte & 0x7F) << m_varint_shift;
+    m_varint_shift += 7;
+    if(byte & 0x80) {
+        return false;
+    }
+    value = m_varint;
+    m_varint = 0;
+    m_varint_shift = 0;
+    return true;
+}
+
+bool delta_patch::flush_page() {
+    uint32_t offset = m_target_offset + m_written - m_page_fill;
+    if(m_page_fill < sizeof(m_page)) {
+        memset(m_page + m_page_fill, 0xFF, sizeof(m_page) - m_page_fill);
+    }
+    // Sectors are erased only as the image grows into them
+    if((offset - m_target_offset) % FLASH_DEVICE_SECTOR_SIZE == 0 && !m_flash.erase(offset, FLASH_DEVICE_SECTOR_SIZE)) {
+        return false;
+    }
+    m_page_fill = 0;
+    return m_flash.program(offset, m_page);
+}
+
+bool delta_patch::emit(std::span<const uint8_t> data) {
+    if(m_written + data.size() > m_new_size) {
+        return false;
+    }
+    while(!data.empty()) {
+        size_t length = std::min(data.size(), sizeof(m_page) - m_page_fill);
+        memcpy(m_page + m_page_fill, data.data(), length);
+        m_page_fill += length;
+        m_written += length;
+        data = data.subspan(length);
+        if(m_page_fill == sizeof(m_page) && !flush_page()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool delta_patch::copy(uint32_t offset, uint32_t length) {
+    if((uint64_t)offset + length > m_old_size) {
+        return false;
+    }
+    auto source = m_flash.read(m_source_offset + offset, length);
+    return source.size() == length && emit(source);
+}
+
+bool delta_patch::finish() {
+    if(m_written != m_new_size || (m_page_fill && !flush_page())) {
+        return false;
+    }
+    // Check what actually landed in flash, not what was meant to
+    auto image = m_flash.read(m_target_offset, m_new_size);
+    return image.size() == m_new_size && crc32(image.data(), image.size()) == m_new_crc;
+}
+
+delta_patch::status delta_patch::feed(std::span<const uint8_t> data) {
+    size_t i = 0;
+    while(m_status == status::more && i < data.size()) {
+        switch(m_stage) {
+            case stage::header: {
+                size_t length = std::min(data.size() - i, sizeof(m_header) - m_header_fill);
+                memcpy(m_header + m_header_fill, data.data() + i, length);
+                m_header_fill += length;
+                i += length;
+                if(m_header_fill == sizeof(m_header)) {
+                    if(!check_header()) {
+                        return fail("patch does not apply to the running image");
+                    }
+                    m_stage = stage::op;
+                }
+                break;
+            }
+            case stage::op: {
+                uint8_t op = data[i++];
+                if(op == DELTA_OP_COPY) {
+                    m_stage = stage::copy_offset;
+                } else if(op == DELTA_OP_DATA) {
+                    m_stage = stage::data_length;
+                } else if(op == DELTA_OP_END) {
+                    if(!finish()) {
+                        return fail("image verification failed");
+                    }
+                    info("delta_patch: wrote %zu bytes, crc %08lx\n", m_written, (unsigned long)m_new_crc);
+                    m_status = status::done;
+                } else {
+                    return fail("unknown operation");
+                }
+                break;
+            }
+            case stage::copy_offset:
+                if(m_varint_shift > 28) {
+                    return fail("malformed varint");
+                }
+                if(varint(data[i++], m_copy_offset)) {
+                    m_stage = stage::copy_length;
+                }
+                break;
+            case stage::copy_length:
+                if(m_varint_shift > 28) {
+                    return fail("malformed varint");
+                }
+                if(varint(data[i++], m_remaining)) {
+                    if(!copy(m_copy_offset, m_remaining)) {
+                        return fail("copy out of range");
+                    }
+                    m_stage = stage::op;
+                }
+                break;
+            case stage::data_length:
+                if(m_varint_shift > 28) {
+                    return fail("malformed varint");
+                }
+                if(varint(data[i++], m_remaining)) {
+                    m_stage = m_remaining ? stage::data : stage::op;
+                }
+                break;
+            case stage::data: {
+                size_t length = std::min<size_t>(data.size() - i, m_remaining);
+                if(!emit(data.subspan(i, length))) {
+                    return fail("image larger than announced");
+                }
+                i += length;
+                m_remaining -= length;
+                if(m_remaining == 0) {
+                    m_stage = stage::op;
+                }
+                break;
+            }
+        }
+    }
+    return m_status;
+}
@@ -0,0 +1,172 @@
+#include "derived_weather.h"
+
+#include <math.h>
+#include <string.h>
+
+// weewx's Magnus coefficients
+#define MAGNUS_B       17.27f
+#define MAGNUS_C       237.7f
+#define KELVIN         273.15f
+// Gravity over the gas constant of dry air, and the standard lapse rate, in K/m
+#define GRAVITY_OVER_R 0.0341632f
+#define LAPSE_RATE     0.0065f
+#define LN_2           0.693147181f
+#define SQRT_2         1.41421356f
+
+// Natural log of a positive, normal x. The exponent is split off and the
+// mantissa brought into [sqrt(2)/2, sqrt(2)), where the atanh series
+// ln(m) = 2(s + s^3/3 + s^5/5 + s^7/7), s = (m - 1)/(m + 1), is good to 1e-8
+static float approx_ln(float x) {
+    uint32_t bits;
+    memcpy(&bits, &x, sizeof(bits));
+    int exponent = (int)((bits >> 23) & 0xFF) - 127;
+    bits = (bits & 0x007FFFFF) | 0x3F800000;
+    float m;
+    memcpy(&m, &bits, sizeof(m));
+    if(m > SQRT_2) {
+        m *= 0.5f;
+        exponent++;
+    }
+    float s = (m - 1.0f) / (m + 1.0f);
+    float s2 = s * s;
+    return exponent * LN_2 + 2.0f * s * (1.0f + s2 * (1.0f / 3.0f + s2 * (1.0f / 5.0f + s2 * (1.0f / 7.0f))));
+}
+
+// Taylor series, good to 2e-6 for |x| <= 0.5. Larger arguments are halved
+// until they fit and the result squared back up. Outside the range of a
+// normal float the answer is known, and an infinite x would never fit.
+static float approx_exp(float x) {
+    if(isnan(x)) {
+        return x;
+    }
+    if(x > 88.7f) {
+        return INFINITY;
+    }
+    if(x < -87.3f) {
+        return 0.0f;
+    }
+    int halvings = 0;
+    while(x > 0.5f || x < -0.5f) {
+        x *= 0.5f;
+        halvings++;
+    }
+    float e = 1.0f + x * (1.0f + x * (1.0f / 2.0f + x * (1.0f / 6.0f + x * (1.0f / 24.0f + x * (1.0f / 120.0f + x * (1.0f / 720.0f))))));
+    while(halvings-- > 0) {
+        e *= e;
+    }
+    return e;
+}
+
+// Newton's method for x in (0, 1], only used for a small correction term
+static float approx_sqrt_unit(float x) {
+    float root = 0.5f * (1.0f + x);
+    for(int i = 0; i < 5; i++) {
+        root = 0.5f * (root + x / root);
+    }
+    return root;
+}
+
+std::optional<celsius_t> dewpoint(celsius_t temperature, percentage_t humidity) {
+    if(!(humidity > 0.0f) || !(temperature > -MAGNUS_C) || !isfinite(temperature)) {
+        return {};
+    }
+    if(humidity > 100.0f) {
+        humidity = 100.0f;
+    }
+    float gamma = MAGNUS_B * temperature / (MAGNUS_C + temperature) + approx_ln(humidity * 0.01f);
+    return MAGNUS_C * gamma / (MAGNUS_B - gamma);
+}
+
+celsius_t heat_index(celsius_t temperature, percentage_t humidity) {
+    float t = temperature * 1.8f + 32.0f;
+    float r = humidity;
+    if(t <= 40.0f) {
+        return temperature;
+    }
+    float hi = 0.5f * (t + 61.0f + (t - 68.0f) * 1.2f + r * 0.094f);
+    if((hi + t) * 0.5f >= 80.0f) {
+        hi = -42.379f + 2.04901523f * t + 10.14333127f * r - 0.22475541f * t * r
+            - 6.83783e-3f * t * t - 5.481717e-2f * r * r + 1.22874e-3f * t * t * r
+            + 8.5282e-4f * t * r * r - 1.99e-6f * t * t * r * r;
+        if(r < 13.0f && t > 80.0f && t < 112.0f) {
+            float offset = t > 95.0f ? t - 95.0f : 95.0f - t;
+            hi -= (13.0f - r) * 0.25f * approx_sqrt_unit((17.0f - offset) / 17.0f);
+        } else if(r > 85.0f && t >= 80.0f && t < 87.0f) {
+            hi += (r - 85.0f) * 0.1f * (87.0f - t) * 0.2f;
+        }
+    }
+    return (hi - 32.0f) / 1.8f;
+}
+
+std::optional<mbar_t> sea_level_pressure(mbar_t pressure, celsius_t temperature, float altitude_m) {
+    float column_k = temperature + KELVIN + LAPSE_RATE * altitude_m * 0.5f;
+    // Also false for NaN, and for infinite inputs after the sum or the division
+    if(!(column_k > 0.0f) || !isfinite(column_k) || !isfinite(pressure)) {
+        return {};
+    }
+    return pressure * approx_exp(GRAVITY_OVER_R * altitude_m / column_k);
+}
+
+derived_weather::derived_weather(std::optional<float> altitude_m)
+    : m_altitude(altitude_m)
+    , m_evaluations(0)
+{}
+
+void derived_weather::update(const packet_args &args) {
+    if(args.outTemp && args.outTemp != m_temperature) {
+        m_temperature = args.outTemp;
+        m_dewpoint.valid = m_heat_index.valid = m_barometer.valid = false;
+    }
+    if(args.outHumidity && args.outHumidity != m_humidity) {
+        m_humidity = args.outHumidity;
+        m_dewpoint.valid = m_heat_index.valid = false;
+    }
+    if(args.pressure && args.pressure != m_pressure) {
+        m_pressure = args.pressure;
+        m_barometer.valid = false;
+    }
+}
+
+std::optional<celsius_t> derived_weather::dewpoint() {
+    if(!m_dewpoint.valid) {
+        m_dewpoint.value = m_temperature && m_humidity ? ::dewpoint(*m_temperature, *m_humidity) : std::nullopt;
+        m_dewpoint.valid = true;
+        m_evaluations++;
+    }
+    return m_dewpoint.value;
+}
+
+std::optional<celsius_t> derived_weather::heat_index() {
+    if(!m_heat_index.valid) {
+        m_heat_index.value.reset();
+        if(m_temperature && m_humidity) {
+            m_heat_index.value = ::heat_index(*m_temperature, *m_humidity);
+        }
+        m_heat_index.valid = true;
+        m_evaluations++;
+    }
+    return m_heat_index.value;
+}
+
+std::optional<mbar_t> derived_weather::barometer() {
+    if(!m_barometer.valid) {
+        m_barometer.value.reset();
+        if(m_pressure && m_temperature && m_altitude) {
+            m_barometer.value = ::sea_level_pressure(*m_pressure, *m_temperature, *m_altitude);
+        }
+        m_barometer.valid = true;
+        m_evaluations++;
+    }
+    return m_barometer.value;
+}
+
+void derived_weather::fill(packet_args &args) {
+    update(args);
+    if(args.outTemp && args.outHumidity) {
+        args.dewpoint = dewpoint();
+        args.heatindex = heat_index();
+    }
+    if(args.pressure && !args.barometer) {
+        args.barometer = barometer();
+    }
+}
@@ -0,0 +1,50 @@
+#include "flash_device.h"
+
+#include <hardware/flash.h>
+#include <hardware/sync.h>
+
+#include "logger.h"
+
+static_assert(FLASH_DEVICE_SECTOR_SIZE == FLASH_SECTOR_SIZE && FLASH_DEVICE_PAGE_SIZE == FLASH_PAGE_SIZE);
+
+extern char __flash_binary_start, __flash_binary_end;
+
+size_t rp2040_flash::binary_size() {
+    return (size_t)(&__flash_binary_end - &__flash_binary_start);
+}
+
+size_t rp2040_flash::size() const {
+    return PICO_FLASH_SIZE_BYTES;
+}
+
+bool rp2040_flash::erase(uint32_t offset, size_t length) {
+    trace("rp2040_flash::erase 0x%08lx %zu\n", (unsigned long)offset, length);
+    if(offset % FLASH_SECTOR_SIZE || length % FLASH_SECTOR_SIZE || offset + length > size()) {
+        error("rp2040_flash: misaligned erase 0x%08lx %zu\n", (unsigned long)offset, length);
+        return false;
+    }
+    // Interrupt handlers may live in flash, which is unavailable while erasing
+    uint32_t interrupts = save_and_disable_interrupts();
+    flash_range_erase(offset, length);
+    restore_interrupts(interrupts);
+    return true;
+}
+
+bool rp2040_flash::program(uint32_t offset, std::span<const uint8_t> data) {
+    trace("rp2040_flash::program 0x%08lx %zu\n", (unsigned long)offset, data.size());
+    if(offset % FLASH_PAGE_SIZE || data.size() % FLASH_PAGE_SIZE || offset + data.size() > size()) {
+        error("rp2040_flash: misaligned program 0x%08lx %zu\n", (unsigned long)offset, data.size());
+        return false;
+    }
+    uint32_t interrupts = save_and_disable_interrupts();
+    flash_range_program(offset, data.data(), data.size());
+    restore_interrupts(interrupts);
+    return true;
+}
+
+std::span<const uint8_t> rp2040_flash::read(uint32_t offset, size_t length) const {
+    if(offset + length > size()) {
+        return {};
+    }
+    return {(const uint8_t*)(XIP_BASE + offset), length};
+}
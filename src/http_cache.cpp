@@ -0,0 +1,147 @@
+#include "http_cache.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+
+#define HTTP_ETAG_FORMAT "\"%08lx-%08lx\""
+
+static const char bad_request[] =
+    "HTTP/1.1 400 Bad Request\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+static const char not_found[] =
+    "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+static const char method_not_allowed[] =
+    "HTTP/1.1 405 Method Not Allowed\r\nAllow: GET, HEAD\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+static const char unavailable[] =
+    "HTTP/1.1 503 Service Unavailable\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+
+template<size_t N>
+static http_cache::response static_response(const char (&text)[N]) {
+    return {text, N - 1, -1};
+}
+
+// Returns the value of the named header, or an empty view if it is missing
+static std::string_view find_header(std::string_view request, std::string_view name) {
+    size_t line = request.find("\r\n");
+    while(line != std::string_view::npos) {
+        line += 2;
+        size_t end = request.find("\r\n", line);
+        if(end == std::string_view::npos || end == line) {
+            break;
+        }
+        std::string_view header = request.substr(line, end - line);
+        if(header.size() > name.size() && header[name.size()] == ':'
+                && strncasecmp(header.data(), name.data(), name.size()) == 0) {
+            std::string_view value = header.substr(name.size() + 1);
+            while(!value.empty() && value.front() == ' ') {
+                value.remove_prefix(1);
+            }
+            return value;
+        }
+        line = end;
+    }
+    return {};
+}
+
+http_cache::http_cache(uint32_t nonce, std::string_view path)
+    : m_buffers{}
+    , m_not_modified{}
+    , m_etag{}
+    , m_start{0}
+    , m_header_length{0}
+    , m_length{0}
+    , m_not_modified_length{0}
+    , m_references{0}
+    , m_current(-1)
+    , m_nonce(nonce)
+    , m_sequence(0)
+    , m_path(path)
+{}
+
+bool http_cache::render(std::string_view body) {
+    return render_with([body](auto &write) {
+        return write(body);
+    });
+}
+
+int http_cache::begin_render() {
+    int next = m_current < 0 ? 0 : m_current ^ 1;
+    return m_references[next] == 0 ? next : -1;
+}
+
+bool http_cache::finish_render(int next, size_t body_length) {
+    // Formatted locally so neither header is written from a member it could overlap
+    char etag[HTTP_CACHE_ETAG_SIZE];
+    snprintf(etag, sizeof(etag), HTTP_ETAG_FORMAT,
+        (unsigned long)m_nonce, (unsigned long)(m_sequence + 1));
+    char headers[HTTP_CACHE_HEADER_SIZE];
+    int header = snprintf(headers, sizeof(headers),
+        "HTTP/1.1 200 OK\r\n"
+        "Content-Type: application/json\r\n"
+        "Content-Length: %u\r\n"
+        "ETag: %s\r\n"
+        "Cache-Control: no-cache\r\n"
+        "Connection: close\r\n\r\n",
+        (unsigned)body_length, etag);
+    if(header < 0 || header >= HTTP_CACHE_HEADER_SIZE) {
+        return false;
+    }
+    // The body is already in place, the headers go right in front of it
+    m_start[next] = HTTP_CACHE_HEADER_SIZE - header;
+    memcpy(m_buffers[next] + m_start[next], headers, header);
+    m_header_length[next] = header;
+    m_length[next] = header + body_length;
+    int not_modified = snprintf(m_not_modified[next], HTTP_CACHE_HEADER_SIZE,
+        "HTTP/1.1 304 Not Modified\r\n"
+        "ETag: %s\r\n"
+        "Connection: close\r\n\r\n",
+        etag);
+    m_not_modified_length[next] = not_modified;
+    memcpy(m_etag[next], etag, sizeof(etag));
+    m_sequence++;
+    m_current = next;
+    return true;
+}
+
+http_cache::response http_cache::handle(std::string_view request) {
+    size_t method_end = request.find(' ');
+    if(method_end == std::string_view::npos) {
+        return static_response(bad_request);
+    }
+    size_t path_end = request.find(' ', method_end + 1);
+    if(path_end == std::string_view::npos) {
+        return static_response(bad_request);
+    }
+    std::string_view method = request.substr(0, method_end);
+    std::string_view path = request.substr(method_end + 1, path_end - method_end - 1);
+    path = path.substr(0, path.find('?'));
+    bool head = method == "HEAD";
+    if(!head && method != "GET") {
+        return static_response(method_not_allowed);
+    }
+    if(path != m_path) {
+        return static_response(not_found);
+    }
+    if(m_current < 0) {
+        return static_response(unavailable);
+    }
+
+    int buffer = m_current;
+    m_references[buffer]++;
+    std::string_view etag(m_etag[buffer]);
+    std::string_view if_none_match = find_header(request, "If-None-Match");
+    if(!if_none_match.empty() && (if_none_match == "*" || if_none_match.find(etag) != std::string_view::npos)) {
+        return {m_not_modified[buffer], m_not_modified_length[buffer], buffer};
+    }
+    return {m_buffers[buffer] + m_start[buffer], head ? m_header_length[buffer] : m_length[buffer], buffer};
+}
+
+void http_cache::release(int buffer) {
+    if(buffer >= 0 && m_references[buffer] > 0) {
+        m_references[buffer]--;
+    }
+}
+
+uint32_t http_cache::sequence() const {
+    return m_sequence;
+}
@@ -0,0 +1,202 @@
+#include "http_server.h"
+
+#include <string_view>
+
+#include "logger.h"
+
+#define HTTP_SERVER_POLL_INTERVAL 10
+
+http_server::http_server(http_cache &cache, uint16_t port)
+    : m_cache(cache)
+    , m_listener(nullptr)
+    , m_port(port)
+    , m_connections{}
+{}
+
+http_server::~http_server() {
+    close();
+}
+
+bool http_server::listen() {
+    trace1("http_server::listen entered...\n");
+    if(m_listener != nullptr) {
+        return true;
+    }
+    tcp_pcb *pcb = tcp_new_ip_type(IPADDR_TYPE_ANY);
+    if(pcb == nullptr) {
+        error1("http_server: failed to create pcb\n");
+        return false;
+    }
+    err_t err = tcp_bind(pcb, IP_ANY_TYPE, m_port);
+    if(err != ERR_OK) {
+        error("http_server: failed to bind port %d (err = %d)\n", m_port, err);
+        tcp_close(pcb);
+        return false;
+    }
+    m_listener = tcp_listen_with_backlog(pcb, HTTP_SERVER_MAX_CONNECTIONS);
+    if(m_listener == nullptr) {
+        error1("http_server: failed to listen\n");
+        tcp_close(pcb);
+        return false;
+    }
+    tcp_arg(m_listener, this);
+    tcp_accept(m_listener, accept_callback);
+    info("http_server listening on port %d\n", m_port);
+    return true;
+}
+
+bool http_server::listening() const {
+    return m_listener != nullptr;
+}
+
+void http_server::close() {
+    for(connection &conn : m_connections) {
+        if(conn.pcb != nullptr) {
+            finish(&conn, true);
+        }
+    }
+    if(m_listener != nullptr) {
+        tcp_close(m_listener);
+        m_listener = nullptr;
+    }
+}
+
+http_server::connection *http_server::allocate(tcp_pcb *pcb) {
+    for(connection &conn : m_connections) {
+        if(conn.pcb == nullptr) {
+            conn.server = this;
+            conn.pcb = pcb;
+            conn.length = 0;
+            conn.unacked = 0;
+            conn.buffer = -1;
+            conn.responded = false;
+            conn.closing = false;
+            return &conn;
+        }
+    }
+    return nullptr;
+}
+
+void http_server::respond(connection *conn) {
+    http_cache::response response = m_cache.handle({conn->request, conn->length});
+    conn->buffer = response.buffer;
+    conn->responded = true;
+    if(response.length > tcp_sndbuf(conn->pcb)) {
+        warn("http_server: response of %zu bytes exceeds send buffer\n", response.length);
+        finish(conn, true);
+        return;
+    }
+    // No TCP_WRITE_FLAG_COPY: lwIP references the cached response directly
+    err_t err = tcp_write(conn->pcb, response.data, response.length, 0);
+    if(err != ERR_OK) {
+        warn("http_server: tcp_write failed (err = %d)\n", err);
+        finish(conn, true);
+        return;
+    }
+    conn->unacked = response.length;
+    tcp_output(conn->pcb);
+}
+
+err_t http_server::finish(connection *conn, bool abort) {
+    tcp_pcb *pcb = conn->pcb;
+    if(pcb == nullptr) {
+        return ERR_OK;
+    }
+    if(abort) {
+        detach(conn);
+        tcp_abort(pcb);
+        return ERR_ABRT;
+    }
+    if(conn->closing) {
+        // Already closed, only waiting for the last acknowledgement
+        if(conn->unacked == 0) {
+            detach(conn);
+        }
+        return ERR_OK;
+    }
+    tcp_recv(pcb, nullptr);
+    if(tcp_close(pcb) != ERR_OK) {
+        detach(conn);
+        tcp_abort(pcb);
+        return ERR_ABRT;
+    }
+    if(conn->unacked > 0) {
+        // lwIP keeps referencing the cached response until the client has
+        // acknowledged it, so the buffer stays pinned until sent_callback
+        // sees the last byte acknowledged or err_callback reports the pcb gone
+        conn->closing = true;
+        return ERR_OK;
+    }
+    detach(conn);
+    return ERR_OK;
+}
+
+void http_server::detach(connection *conn) {
+    if(conn->pcb != nullptr) {
+        tcp_arg(conn->pcb, nullptr);
+        tcp_recv(conn->pcb, nullptr);
+        tcp_sent(conn->pcb, nullptr);
+        tcp_err(conn->pcb, nullptr);
+        conn->pcb = nullptr;
+    }
+    conn->closing = false;
+    m_cache.release(conn->buffer);
+    conn->buffer = -1;
+}
+
+err_t http_server::accept_callback(void *arg, tcp_pcb *pcb, err_t err) {
+    http_server *server = (http_server*)arg;
+    if(err != ERR_OK || pcb == nullptr) {
+        return ERR_VAL;
+    }
+    connection *conn = server->allocate(pcb);
+    if(conn == nullptr) {
+        warn1("http_server: too many connections\n");
+        tcp_abort(pcb);
+        return ERR_ABRT;
+    }
+    tcp_arg(pcb, conn);
+    tcp_recv(pcb, recv_callback);
+    tcp_sent(pcb, sent_callback);
+    tcp_err(pcb, err_callback);
+    return ERR_OK;
+}
+
+err_t http_server::recv_callback(void *arg, tcp_pcb *pcb, pbuf *p, err_t err) {
+    connection *conn = (connection*)arg;
+    if(p == nullptr) {
+        // Remote closed the connection
+        return conn->server->finish(conn, false);
+    }
+    tcp_recved(pcb, p->tot_len);
+    if(!conn->responded) {
+        size_t space = sizeof(conn->request) - conn->length;
+        size_t copied = pbuf_copy_partial(p, conn->request + conn->length, space < p->tot_len ? space : p->tot_len, 0);
+        conn->length += copied;
+        std::string_view request(conn->request, conn->length);
+        if(request.find("\r\n\r\n") != std::string_view::npos || conn->length == sizeof(conn->request)) {
+            conn->server->respond(conn);
+        }
+    }
+    pbuf_free(p);
+    return conn->pcb == nullptr ? ERR_ABRT : ERR_OK;
+}
+
+err_t http_server::sent_callback(void *arg, tcp_pcb *pcb, u16_t len) {
+    connection *conn = (connection*)arg;
+    conn->unacked = len < conn->unacked ? conn->unacked - len : 0;
+    if(conn->responded && conn->unacked == 0) {
+        return conn->server->finish(conn, false);
+    }
+    return ERR_OK;
+}
+
+void http_server::err_callback(void *arg, err_t err) {
+    connection *conn = (connection*)arg;
+    if(conn == nullptr) {
+        return;
+    }
+    // The pcb has already been freed by lwIP
+    conn->pcb = nullptr;
+    conn->server->detach(conn);
+}
@@ -0,0 +1,230 @@
+#include "i2c_trace.h"
+
+#if I2C_TRACE || I2C_TRACE_REPLAY
+
+#include <stdio.h>
+#include <string.h>
+#include <pico/time.h>
+#include <hardware/sync.h>
+
+#include "i2c_trace_format.h"
+#include "logger.h"
+
+#define I2C_TRACE_DUMP_LINE 32
+
+static uint8_t flags_for(i2c_inst_t *i2c, bool read, bool nostop, int rc) {
+    uint8_t flags = read ? I2C_TRACE_FLAG_READ : 0;
+    if(nostop) {
+        flags |= I2C_TRACE_FLAG_NOSTOP;
+    }
+    if(i2c_hw_index(i2c) == 1) {
+        flags |= I2C_TRACE_FLAG_BUS1;
+    }
+    if(rc < 0) {
+        flags |= I2C_TRACE_FLAG_FAILED;
+    }
+    return flags;
+}
+
+#endif
+
+#if I2C_TRACE
+
+static uint8_t buffer[I2C_TRACE_BUFFER_SIZE];
+static size_t buffer_length = 0;
+static uint32_t last_us = 0;
+static volatile bool capturing = false, full = false;
+// Transactions that did not fit once the buffer filled. Counted in whatever
+// context issued them, reported later from the main loop.
+static volatile uint32_t overflows = 0, reported_overflows = 0;
+
+static void capture(i2c_inst_t *i2c, uint8_t addr, const uint8_t *data, size_t len, bool read, bool nostop, int rc, uint32_t start_us, uint32_t end_us) {
+    if(!capturing) {
+        return;
+    }
+    // Transactions are issued from both the main loop and alarm callbacks
+    uint32_t interrupts = save_and_disable_interrupts();
+    if(full) {
+        overflows = overflows + 1;
+        restore_interrupts(interrupts);
+        return;
+    }
+    i2c_trace_record record = {
+        flags_for(i2c, read, nostop, rc),
+        addr,
+        buffer_length == I2C_TRACE_HEADER_SIZE ? 0 : start_us - last_us,
+        end_us - start_us,
+        rc,
+        {data, len}
+    };
+    size_t written = i2c_trace_encode(record, {buffer + buffer_length, sizeof(buffer) - buffer_length});
+    if(written == 0) {
+        full = true;
+        overflows = overflows + 1;
+    } else {
+        buffer_length += written;
+        last_us = start_us;
+    }
+    restore_interrupts(interrupts);
+}
+
+void i2c_trace_start() {
+    uint32_t interrupts = save_and_disable_interrupts();
+    buffer_length = i2c_trace_write_header(buffer);
+    full = false;
+    overflows = 0;
+    reported_overflows = 0;
+    capturing = true;
+    restore_interrupts(interrupts);
+}
+
+void i2c_trace_stop() {
+    capturing = false;
+}
+
+bool i2c_trace_capturing() {
+    return capturing && !full;
+}
+
+uint32_t i2c_trace_overflows() {
+    return overflows;
+}
+
+void i2c_trace_report() {
+    uint32_t count = overflows;
+    if(count != 0 && reported_overflows == 0) {
+        warn1("i2c_trace: buffer full, capture stopped\n");
+    }
+    reported_overflows = count;
+}
+
+std::span<const uint8_t> i2c_trace_buffer() {
+    return {buffer, buffer_length};
+}
+
+void i2c_trace_dump() {
+    bool was_capturing = capturing;
+    capturing = false;
+    printf("I2CTRACE BEGIN %u\n", (unsigned)buffer_length);
+    for(size_t offset = 0; offset < buffer_length; offset += I2C_TRACE_DUMP_LINE) {
+        printf("I2CTRACE ");
+        for(size_t i = offset; i < buffer_length && i < offset + I2C_TRACE_DUMP_LINE; i++) {
+            printf("%02x", buffer[i]);
+        }
+        printf("\n");
+    }
+    printf("I2CTRACE END\n");
+    if(overflows != 0) {
+        warn("i2c_trace: %u transactions after the buffer filled were not captured\n", (unsigned)overflows);
+    }
+    capturing = was_capturing;
+}
+
+int i2c_trace_write_blocking(i2c_inst_t *i2c, uint8_t addr, const uint8_t *src, size_t len, bool nostop) {
+    uint32_t start_us = time_us_32();
+    int rc = i2c_write_blocking(i2c, addr, src, len, nostop);
+    capture(i2c, addr, src, len, false, nostop, rc, start_us, time_us_32());
+    return rc;
+}
+
+int i2c_trace_read_blocking(i2c_inst_t *i2c, uint8_t addr, uint8_t *dst, size_t len, bool nostop) {
+    uint32_t start_us = time_us_32();
+    int rc = i2c_read_blocking(i2c, addr, dst, len, nostop);
+    capture(i2c, addr, dst, len, true, nostop, rc, start_us, time_us_32());
+    return rc;
+}
+
+#elif I2C_TRACE_REPLAY
+
+static std::span<const uint8_t> trace;
+static i2c_replay_stats stats = {};
+
+// Each device keeps its own place in the trace, so the interleaving
+// between devices does not have to match the capture exactly
+struct replay_cursor {
+    uint8_t bus, address;
+    size_t offset;
+    bool used;
+};
+static replay_cursor cursors[I2C_TRACE_REPLAY_DEVICES];
+
+static replay_cursor *find_cursor(uint8_t bus, uint8_t addr) {
+    for(replay_cursor &cursor : cursors) {
+        if(cursor.used && cursor.bus == bus && cursor.address == addr) {
+            return &cursor;
+        }
+    }
+    for(replay_cursor &cursor : cursors) {
+        if(!cursor.used) {
+            cursor = {bus, addr, I2C_TRACE_HEADER_SIZE, true};
+            return &cursor;
+        }
+    }
+    return nullptr;
+}
+
+// Pulls the device's next record and checks it against the request being made
+static bool next_record(i2c_inst_t *i2c, uint8_t addr, size_t len, bool read, bool nostop, i2c_trace_record &record) {
+    stats.transactions++;
+    uint8_t bus = i2c_hw_index(i2c);
+    replay_cursor *cursor = find_cursor(bus, addr);
+    while(true) {
+        size_t used = cursor == nullptr ? 0 : i2c_trace_decode(trace.subspan(cursor->offset), record);
+        if(used == 0) {
+            stats.exhausted++;
+            return false;
+        }
+        cursor->offset += used;
+        if(record.bus() == bus && record.address == addr) {
+            break;
+        }
+    }
+    stats.recorded_us += record.duration_us;
+    // Occupy the caller for as long as the bus did during the capture
+    busy_wait_us_32(record.duration_us);
+    uint8_t expected = flags_for(i2c, read, nostop, 0);
+    if((record.flags & ~I2C_TRACE_FLAG_FAILED) != expected || (!record.failed() && record.data.size() != len)) {
+        warn("i2c_trace: replay mismatch at transaction %u\n", (unsigned)stats.transactions);
+        stats.mismatches++;
+    }
+    return true;
+}
+
+bool i2c_trace_replay(std::span<const uint8_t> data) {
+    if(!i2c_trace_check_header(data)) {
+        return false;
+    }
+    trace = data;
+    stats = {};
+    for(replay_cursor &cursor : cursors) {
+        cursor.used = false;
+    }
+    return true;
+}
+
+i2c_replay_stats i2c_trace_replay_stats() {
+    return stats;
+}
+
+int i2c_trace_write_blocking(i2c_inst_t *i2c, uint8_t addr, const uint8_t *src, size_t len, bool nostop) {
+    i2c_trace_record record;
+    if(!next_record(i2c, addr, len, false, nostop, record)) {
+        return PICO_ERROR_GENERIC;
+    }
+    if(record.data.size() == len && memcmp(record.data.data(), src, len) != 0) {
+        warn("i2c_trace: replay wrote different data at transaction %u\n", (unsigned)stats.transactions);
+        stats.mismatches++;
+    }
+    return record.rc;
+}
+
+int i2c_trace_read_blocking(i2c_inst_t *i2c, uint8_t addr, uint8_t *dst, size_t len, bool nostop) {
+    i2c_trace_record record;
+    if(!next_record(i2c, addr, len, true, nostop, record)) {
+        return PICO_ERROR_GENERIC;
+    }
+    memcpy(dst, record.data.data(), record.data.size() < len ? record.data.size() : len);
+    return record.rc;
+}
+
+#endif
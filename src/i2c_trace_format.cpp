@@ -0,0 +1,100 @@
+#include "i2c_trace_format.h"
+
+#include <string.h>
+
+static const uint8_t magic[4] = {'I', '2', 'C', 'T'};
+
+static size_t put_varint(uint8_t *out, uint32_t value) {
+    size_t length = 0;
+    do {
+        uint8_t byte = value & 0x7F;
+        value >>= 7;
+        out[length++] = byte | (value ? 0x80 : 0);
+    } while(value);
+    return length;
+}
+
+static size_t get_varint(std::span<const uint8_t> data, uint32_t &value) {
+    value = 0;
+    for(size_t i = 0; i < data.size() && i < 5; i++) {
+        value |= (uint32_t)(data[i] & 0x7F) << (7 * i);
+        if((data[i] & 0x80) == 0) {
+            return i + 1;
+        }
+    }
+    return 0;
+}
+
+size_t i2c_trace_write_header(std::span<uint8_t> out) {
+    if(out.size() < I2C_TRACE_HEADER_SIZE) {
+        return 0;
+    }
+    memcpy(out.data(), magic, sizeof(magic));
+    out[4] = I2C_TRACE_VERSION;
+    return I2C_TRACE_HEADER_SIZE;
+}
+
+bool i2c_trace_check_header(std::span<const uint8_t> data) {
+    return data.size() >= I2C_TRACE_HEADER_SIZE
+        && memcmp(data.data(), magic, sizeof(magic)) == 0
+        && data[4] == I2C_TRACE_VERSION;
+}
+
+size_t i2c_trace_encode(const i2c_trace_record &record, std::span<uint8_t> out) {
+    bool has_data = !(record.failed() && record.read());
+    size_t needed = 2 + 5 + 5 + 1 + (record.failed() ? 1 : 0) + (has_data ? record.data.size() : 0);
+    if(out.size() < needed || record.data.size() > 255) {
+        return 0;
+    }
+    uint8_t *cursor = out.data();
+    *cursor++ = record.flags;
+    *cursor++ = record.address;
+    cursor += put_varint(cursor, record.delta_us);
+    cursor += put_varint(cursor, record.duration_us);
+    *cursor++ = (uint8_t)record.data.size();
+    if(record.failed()) {
+        *cursor++ = (uint8_t)(int8_t)record.rc;
+    }
+    if(has_data) {
+        memcpy(cursor, record.data.data(), record.data.size());
+        cursor += record.data.size();
+    }
+    return cursor - out.data();
+}
+
+size_t i2c_trace_decode(std::span<const uint8_t> data, i2c_trace_record &record) {
+    size_t offset = 0;
+    if(data.size() < 2) {
+        return 0;
+    }
+    record.flags = data[offset++];
+    record.address = data[offset++];
+    size_t used = get_varint(data.subspan(offset), record.delta_us);
+    if(used == 0) {
+        return 0;
+    }
+    offset += used;
+    used = get_varint(data.subspan(offset), record.duration_us);
+    if(used == 0 || offset + used >= data.size()) {
+        return 0;
+    }
+    offset += used;
+    size_t length = data[offset++];
+    record.rc = (int)length;
+    if(record.failed()) {
+        if(offset >= data.size()) {
+            return 0;
+        }
+        record.rc = (int8_t)data[offset++];
+    }
+    bool has_data = !(record.failed() && record.read());
+    if(!has_data) {
+        record.data = {};
+        return offset;
+    }
+    if(offset + length > data.size()) {
+        return 0;
+    }
+    record.data = data.subspan(offset, length);
+    return offset + length;
+}
@@ -0,0 +1,45 @@
+#include <pico/stdlib.h>
+#include <hardware/irq.h>
+#include <hardware/watchdog.h>
+#include <hardware/structs/scb.h>
+#include <hardware/structs/systick.h>
+
+#include "flash_device.h"
+#include "flash_layout.h"
+#include "logger.h"
+#include "ota_slots.h"
+
+// First stage after boot2, in the FLASH_LOADER_SIZE bytes at the start of
+// flash that no slot covers. It finishes, counts or rolls back updates and
+// then starts the image in the active slot. Since the swap never rewrites
+// the code doing it, the loader runs from flash like any other program.
+
+static void __attribute__((noreturn)) start_image(uint32_t offset) {
+    const uint32_t *vectors = (const uint32_t*)(XIP_BASE + offset + FLASH_IMAGE_VECTORS);
+    // Nothing of the loader's may interrupt the image before it has set up
+    systick_hw->csr = 0;
+    irq_set_mask_enabled(0xFFFFFFFF, false);
+    scb_hw->vtor = (uintptr_t)vectors;
+    asm volatile(
+        "msr msp, %0\n"
+        "bx %1\n"
+        :: "r" (vectors[0]), "r" (vectors[1])
+    );
+    __builtin_unreachable();
+}
+
+int main() {
+    stdio_init_all();
+    rp2040_flash flash;
+    // The size of the image is only needed to stage one, which the loader never does
+    ota_slots slots(flash, ota_layout_for(flash.size()), 0);
+    while(slots.boot()) {
+    }
+    info("loader: starting image %08lx (%s)\n", (unsigned long)slots.record().image_crc, ota_state_name(slots.state()));
+    stdio_flush();
+    if(slots.state() == ota_state::trial) {
+        // The image feeds it from its main loop and disables it once confirmed
+        watchdog_enable(OTA_TRIAL_WATCHDOG_MS, true);
+    }
+    start_image(slots.layout().active);
+}
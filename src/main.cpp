@@ -2,28 +2,117 @@
 #include <pico/stdlib.h>
 #include <pico/binary_info.h>
 #include <pico/cyw43_arch.h>
+#include <pico/rand.h>
+#include <hardware/watchdog.h>
+
+#include <stdlib.h>
+#include <time.h>
 
 #include <optional>
 
+#include "adc_filter.h"
+#include "adc_sampler.h"
+#include "adaptive_rate.h"
 #include "aht20.h"
+#include "clock_sync.h"
+#include "derived_weather.h"
+#include "flash_device.h"
+#include "http_cache.h"
+#include "http_server.h"
+#include "i2c_trace.h"
 #include "logger.h"
 #include "loop_packet.h"
+#include "memory_stats.h"
+#include "ota_slots.h"
+#include "packet_writer.h"
+#include "pulse_counter.h"
+#include "rain_tracker.h"
+#include "sntp_client.h"
 #include "wifi_utils.h"
+#include "wind_tracker.h"
+#include "wind_vane.h"
 
+#if WEEWX_TRANSPORT_UDP
+#include "udp_transport.h"
+#else
 #include "sio_client.h"
+#endif
+#ifdef OTA_URL
+#include "ota_client.h"
+#endif
+#if BMP280
+#include "bmp280.h"
+#endif
 
 #define INDOOR_I2C_SDA_PIN 2
 #define INDOOR_I2C_SCL_PIN 3
+#define ANEMOMETER_PIN 6
+#define RAIN_GAUGE_PIN 7
+// ADC inputs, sampled in this order by the round robin
+#define WIND_VANE_ADC 0
+#define BATTERY_ADC 1
+#define SUPPLY_ADC 2
+#define BATTERY_DIVIDER 2.0f
+#define SUPPLY_DIVIDER 3.0f
+#define HTTP_PORT 80
+// Bounds for the adaptive sensor sampling intervals
+#define SAMPLE_MIN_INTERVAL_MS 2500
+#define SAMPLE_MAX_INTERVAL_MS 60000
+// Longest the loop sleeps, so networking is still serviced regularly
+#define LOOP_MAX_INTERVAL_MS 10000
+// Time for an aht20 measurement to complete
+#define MEASUREMENT_WAIT_MS 100
+// Rates of change that call for faster sampling, in degrees C and %RH per minute
+#define TEMPERATURE_THRESHOLD 0.5f
+#define HUMIDITY_THRESHOLD 2.0f
+// Pressure changes slowly and its noise would dominate the fitted rate at
+// shorter intervals; 3 hPa an hour already counts as rapid
+#define PRESSURE_MIN_INTERVAL_MS 30000
+#define PRESSURE_MAX_INTERVAL_MS 300000
+#define PRESSURE_THRESHOLD 0.05f
+// Longest the loop sleeps while the image is on trial, well inside OTA_TRIAL_WATCHDOG_MS
+#define OTA_TRIAL_SLEEP_MS 4000
+
+static const float aht20_thresholds[] = {TEMPERATURE_THRESHOLD, HUMIDITY_THRESHOLD};
+static const float bmp280_thresholds[] = {PRESSURE_THRESHOLD};
+
+static void print_rate(const char *name, const adaptive_rate &rate) {
+    static const char *reasons[] = {"first", "fast", "stable", "hold"};
+    info("%s: sampling every %u ms\n", name, rate.interval_ms());
+    size_t start = rate.log_size() > 8 ? rate.log_size() - 8 : 0;
+    for(size_t i = start; i < rate.log_size(); i++) {
+        const adaptive_rate::decision &d = rate.log(i);
+        info("    %10u ms %-6s x%.2f -> %u ms\n", d.time_ms, reasons[(int)d.why], d.ratio, d.interval_ms);
+    }
+}
 
 int main() {
+    memory_stats_paint();
     bi_decl(bi_2pins_with_func(PICO_DEFAULT_I2C_SDA_PIN, PICO_DEFAULT_I2C_SCL_PIN, GPIO_FUNC_I2C));
     bi_decl(bi_2pins_with_func(INDOOR_I2C_SDA_PIN, INDOOR_I2C_SCL_PIN, GPIO_FUNC_I2C));
+    bi_decl(bi_1pin_with_name(ANEMOMETER_PIN, "Anemometer"));
+    bi_decl(bi_1pin_with_name(RAIN_GAUGE_PIN, "Rain gauge"));
+    bi_decl(bi_1pin_with_name(26 + WIND_VANE_ADC, "Wind vane"));
+    bi_decl(bi_1pin_with_name(26 + BATTERY_ADC, "Battery divider"));
+    bi_decl(bi_1pin_with_name(26 + SUPPLY_ADC, "Supply divider"));
     stdio_init_all();
     sleep_ms(1000);
+    // The loader has already finished or rolled back any update and, if
+    // the image is on trial, counted this boot and started the watchdog
+    rp2040_flash flash;
+    ota_slots slots(flash, ota_layout_for(flash.size()), rp2040_flash::binary_size());
+    bool on_trial = slots.state() == ota_state::trial;
+    absolute_time_t trial_deadline = make_timeout_time_ms(OTA_TRIAL_DEADLINE_MS);
+    // Only used to show local time in logs, packets are always stamped in UTC
+    setenv("TZ", TIMEZONE, 1);
+    tzset();
     if(cyw43_arch_init_with_country(CYW43_COUNTRY_USA)) {
         error1("Wi-Fi init failed\n");
         return -1;
     }
+    if(on_trial) {
+        watchdog_update();
+    }
 
     cyw43_arch_enable_sta_mode();
     info("Connecting to WiFi SSID %s...\n", WIFI_SSID);
@@ -32,19 +121,110 @@ int main() {
 
     int link_status = cyw43_tcpip_link_status(&cyw43_state, CYW43_ITF_STA);
 
+    clock_sync clock;
+    sntp_client sntp(clock);
+    bool clock_logged = false;
+
+    http_cache latest_reading(get_rand_32());
+    http_server server(latest_reading, HTTP_PORT);
+    cyw43_arch_lwip_begin();
+    server.listen();
+    cyw43_arch_lwip_end();
+
+#ifdef OTA_URL
+    ota_client updates(slots, flash, OTA_URL);
+#endif
+    auto confirm_image = [&]() {
+        if(on_trial) {
+            slots.confirm();
+            watchdog_disable();
+            on_trial = false;
+        }
+    };
+
+#if WEEWX_TRANSPORT_UDP
+    udp_transport transport(WEEWX_UDP_HOST, WEEWX_UDP_PORT, WEEWX_UDP_ACK);
+#else
     sio_client client(WEEWX_URL, {});
 
     client.on_open([&client](){
         info1("User open callback\n");
         client.connect();
     });
+#endif
 
+#if I2C_TRACE
+    i2c_trace_start();
+#endif
     aht20 outdoor_sensor(i2c_default, 100 * 1000, PICO_DEFAULT_I2C_SDA_PIN, PICO_DEFAULT_I2C_SCL_PIN);
     aht20 indoor_sensor(&i2c1_inst, 100 * 1000, INDOOR_I2C_SDA_PIN, INDOOR_I2C_SCL_PIN);
+#if BMP280
+    // Shares the outdoor bus. Sleeps between forced measurements taken when
+    // its own adaptive rate says so, without the IIR filter, which would
+    // smear readings that are minutes apart.
+    bmp280 pressure_sensor(true, i2c_default, 100 * 1000, PICO_DEFAULT_I2C_SDA_PIN, PICO_DEFAULT_I2C_SCL_PIN);
+    pressure_sensor.init();
+    pressure_sensor.set_filtering(bmp280::filter::OFF);
+    pressure_sensor.set_mode(bmp280::mode::sleep);
+    adaptive_rate pressure_rate(bmp280_thresholds, PRESSURE_MIN_INTERVAL_MS, PRESSURE_MAX_INTERVAL_MS);
+    absolute_time_t pressure_due = get_absolute_time(), pressure_seen = nil_time;
+#endif
+#ifdef ALTITUDE
+    derived_weather derived(ALTITUDE);
+#else
+    derived_weather derived;
+#endif
+    pulse_counter anemometer(pio0, ANEMOMETER_PIN);
+    pulse_counter rain_gauge(pio0, RAIN_GAUGE_PIN);
+    adc_sampler analog((1 << WIND_VANE_ADC) | (1 << BATTERY_ADC) | (1 << SUPPLY_ADC));
+    wind_vane vane;
+    wind_tracker wind;
+    rain_tracker rain;
+    adaptive_rate outdoor_rate(aht20_thresholds, SAMPLE_MIN_INTERVAL_MS, SAMPLE_MAX_INTERVAL_MS);
+    adaptive_rate indoor_rate(aht20_thresholds, SAMPLE_MIN_INTERVAL_MS, SAMPLE_MAX_INTERVAL_MS);
+    absolute_time_t outdoor_due = get_absolute_time(), indoor_due = get_absolute_time();
+    absolute_time_t outdoor_seen = nil_time, indoor_seen = nil_time;
+    uint32_t last_wind_count = 0;
     aht20::status rc;
     int reconnection_count = -1;
     while(true) {
         link_status = check_network_connection(WIFI_SSID, WIFI_PASSWORD);
+        if(link_status == CYW43_LINK_UP) {
+            cyw43_arch_lwip_begin();
+            sntp.poll();
+#ifdef OTA_URL
+            bool staged = updates.poll();
+#endif
+            cyw43_arch_lwip_end();
+#ifdef OTA_URL
+            if(staged) {
+                info1("Update staged, resetting to install it\n");
+                watchdog_enable(0, false);
+                while(true) {
+                    tight_loop_contents();
+                }
+            }
+#endif
+        }
+        // Past the deadline the watchdog is left to reset an image that never confirmed
+        if(on_trial && !time_reached(trial_deadline)) {
+            watchdog_update();
+        }
+#if WEEWX_TRANSPORT_UDP
+        cyw43_arch_lwip_begin();
+        if(link_status == CYW43_LINK_UP && !transport.ready()) {
+            transport.open();
+        }
+        transport.poll();
+        // send() only says the datagram was queued. With acknowledgements a
+        // trial image is good once weewx confirms one, without them once
+        // one has at least left the node.
+        bool delivered = (WEEWX_UDP_ACK ? transport.acknowledged() : transport.sent()) > 0;
+        cyw43_arch_lwip_end();
+        if(delivered) {
+            confirm_image();
+        }
+#else
         if(link_status == CYW43_LINK_UP && client.state() == sio_client::client_state::disconnected) {
             if(reconnection_count < 0) {
                 client.open();
@@ -57,40 +237,217 @@ int main() {
             }
             reconnection_count++;
         }
-        debug1("Starting measurements...\n");
-        rc = outdoor_sensor.measure();
-        if(rc == aht20::status::ERR_FAIL) {
-            error1("Failed to read from outdoor sensor!\n");
-            cyw43_arch_gpio_put(CYW43_WL_GPIO_LED_PIN, 1);
-        } else {
-            cyw43_arch_gpio_put(CYW43_WL_GPIO_LED_PIN, 0);
-        }
-        rc = indoor_sensor.measure();
-        if(rc == aht20::status::ERR_FAIL) {
-            error1("Failed to read from indoor sensor!\n");
-            cyw43_arch_gpio_put(CYW43_WL_GPIO_LED_PIN, 1);
-        } else {
-            cyw43_arch_gpio_put(CYW43_WL_GPIO_LED_PIN, 0);
-        }
-        outdoor_sensor.update_status();
-        indoor_sensor.update_status();
+#endif
+        memory_stats_sample();
+#if I2C_TRACE
+        i2c_trace_report();
+#endif
+        switch(getchar_timeout_us(0)) {
+        // Send 'm' over USB to print stack and heap usage
+        case 'm':
+            memory_stats_print();
+            break;
+        // Send 'o' over USB to print the firmware update state
+        case 'o':
+            if(on_trial) {
+                info("Image %08lx on trial, boot %lu of %d\n", (unsigned long)slots.record().image_crc,
+                     (unsigned long)slots.attempts(), OTA_MAX_ATTEMPTS);
+            } else {
+                info("Image %08lx, %s\n", (unsigned long)slots.record().image_crc, ota_state_name(slots.state()));
+            }
+            break;
+        // Send 'r' over USB to print the adaptive sampling state
+        case 'r':
+            print_rate("Outdoor", outdoor_rate);
+            print_rate("Indoor", indoor_rate);
+#if BMP280
+            print_rate("Pressure", pressure_rate);
+#endif
+            break;
+#if I2C_TRACE
+        // Send 'd' over USB to dump the captured I2C trace
+        case 'd':
+            i2c_trace_dump();
+            break;
+#endif
+        default:
+            break;
+        }
+        absolute_time_t now = get_absolute_time();
+        bool measuring = false;
+        if(time_reached(outdoor_due)) {
+            debug1("Starting outdoor measurement...\n");
+            rc = outdoor_sensor.measure();
+            if(rc == aht20::status::ERR_FAIL) {
+                error1("Failed to read from outdoor sensor!\n");
+                cyw43_arch_gpio_put(CYW43_WL_GPIO_LED_PIN, 1);
+            } else {
+                cyw43_arch_gpio_put(CYW43_WL_GPIO_LED_PIN, 0);
+            }
+            outdoor_due = delayed_by_ms(now, outdoor_rate.interval_ms());
+            measuring = true;
+        }
+        if(time_reached(indoor_due)) {
+            debug1("Starting indoor measurement...\n");
+            rc = indoor_sensor.measure();
+            if(rc == aht20::status::ERR_FAIL) {
+                error1("Failed to read from indoor sensor!\n");
+                cyw43_arch_gpio_put(CYW43_WL_GPIO_LED_PIN, 1);
+            } else {
+                cyw43_arch_gpio_put(CYW43_WL_GPIO_LED_PIN, 0);
+            }
+            indoor_due = delayed_by_ms(now, indoor_rate.interval_ms());
+            measuring = true;
+        }
+#if BMP280
+        if(time_reached(pressure_due)) {
+            debug1("Starting pressure measurement...\n");
+            if(pressure_sensor.measure() == bmp280::status::ERR_FAIL) {
+                error1("Failed to start a pressure measurement!\n");
+            }
+            pressure_due = delayed_by_ms(now, pressure_rate.interval_ms());
+            measuring = true;
+        }
+#endif
         packet_args args;
-        if(outdoor_sensor.has_data()) {
+        bool sampled = analog.with_latest([&](std::span<const uint16_t> samples) {
+            size_t stride = analog.channels();
+            args.windDir = vane.average(samples, WIND_VANE_ADC, stride);
+            args.consBatteryVoltage = adc_to_volts(adc_mean(samples, BATTERY_ADC, stride), BATTERY_DIVIDER);
+            args.supplyVoltage = adc_to_volts(adc_mean(samples, SUPPLY_ADC, stride), SUPPLY_DIVIDER);
+        });
+        if(!sampled) {
+            // Buffer was overwritten mid read, skip analog values this cycle
+            args.windDir.reset();
+            args.consBatteryVoltage.reset();
+            args.supplyVoltage.reset();
+        }
+        uint32_t wind_count = anemometer.count();
+        bool windy = wind_count != last_wind_count;
+        last_wind_count = wind_count;
+        wind.update(wind_count, to_ms_since_boot(now), args.windDir);
+        rain.update(rain_gauge.count());
+        args.windSpeed = wind.speed();
+        args.windGust = wind.gust();
+        args.windGustDir = wind.gust_direction();
+        // Only report sensor values once per measurement
+        if(outdoor_sensor.has_data() && to_us_since_boot(outdoor_sensor.sampled_at()) != to_us_since_boot(outdoor_seen)) {
+            outdoor_seen = outdoor_sensor.sampled_at();
             args.outTemp = outdoor_sensor.temperature();
             args.outHumidity = outdoor_sensor.humidity();
+            float values[] = {*args.outTemp, *args.outHumidity};
+            outdoor_due = delayed_by_ms(outdoor_seen, outdoor_rate.update(values, to_ms_since_boot(outdoor_seen)));
             info("Outdoors: %.2f%%RH %.2f°F\n", outdoor_sensor.humidity(), outdoor_sensor.temperature_f());
         }
-        if(indoor_sensor.has_data()) {
+        if(indoor_sensor.has_data() && to_us_since_boot(indoor_sensor.sampled_at()) != to_us_since_boot(indoor_seen)) {
+            indoor_seen = indoor_sensor.sampled_at();
             args.inTemp = indoor_sensor.temperature();
             args.inHumidity = indoor_sensor.humidity();
+            float values[] = {*args.inTemp, *args.inHumidity};
+            indoor_due = delayed_by_ms(indoor_seen, indoor_rate.update(values, to_ms_since_boot(indoor_seen)));
             info("Indoors:  %.2f%%RH %.2f°F\n", indoor_sensor.humidity(), indoor_sensor.temperature_f());
         }
+#if BMP280
+        // has_data() is set once the forced measurement has been read back
+        if(pressure_sensor.has_data()) {
+            pressure_seen = now;
+            args.pressure = pressure_sensor.pressure();
+            float values[] = {*args.pressure};
+            pressure_due = delayed_by_ms(pressure_seen, pressure_rate.update(values, to_ms_since_boot(pressure_seen)));
+            info("Pressure: %.2f mbar\n", *args.pressure);
+        }
+#endif
+        cyw43_arch_lwip_begin();
+        if(clock.synced()) {
+            // Stamp with the newest reading this packet actually carries
+            absolute_time_t sampled_at = nil_time;
+            if(args.outTemp) {
+                sampled_at = outdoor_seen;
+            }
+            if(args.inTemp && (is_nil_time(sampled_at) || absolute_time_diff_us(sampled_at, indoor_seen) > 0)) {
+                sampled_at = indoor_seen;
+            }
+#if BMP280
+            if(args.pressure && (is_nil_time(sampled_at) || absolute_time_diff_us(sampled_at, pressure_seen) > 0)) {
+                sampled_at = pressure_seen;
+            }
+#endif
+            if(!is_nil_time(sampled_at)) {
+                args.dateTime = clock.to_utc_us(to_us_since_boot(sampled_at)) / 1e6;
+            }
+            if(!clock_logged) {
+                time_t utc_now = clock.to_utc_us(time_us_64()) / 1000000;
+                struct tm local;
+                char formatted[32];
+                localtime_r(&utc_now, &local);
+                strftime(formatted, sizeof(formatted), "%Y-%m-%d %H:%M:%S %Z", &local);
+                info("Clock synced: %s\n", formatted);
+                clock_logged = true;
+            }
+        }
+        cyw43_arch_lwip_end();
 
-        if(client.socket()->connected() && (args.outTemp || args.inTemp)) {
-            client.socket()->emit("weather_event", create_packet(args));
+        // The pressure sensor runs on its own schedule, so a packet may carry only pressure
+        bool fresh = args.outTemp || args.inTemp || args.pressure;
+        if(fresh) {
+            derived.fill(args);
+            // The http reading shows both sensors, even if only one was just sampled
+            packet_args latest = args;
+            if(!latest.outTemp && outdoor_sensor.has_data()) {
+                latest.outTemp = outdoor_sensor.temperature();
+                latest.outHumidity = outdoor_sensor.humidity();
+                // Derived from this same reading when it was sent, so cached
+                latest.dewpoint = derived.dewpoint();
+                latest.heatindex = derived.heat_index();
+            }
+            if(!latest.inTemp && indoor_sensor.has_data()) {
+                latest.inTemp = indoor_sensor.temperature();
+                latest.inHumidity = indoor_sensor.humidity();
+            }
+            cyw43_arch_lwip_begin();
+            bool rendered = latest_reading.render_with([&latest](auto &write) {
+                return write_packet(latest, write);
+            });
+            if(!rendered) {
+                warn1("Could not render latest reading for http\n");
+            }
+            cyw43_arch_lwip_end();
         }
-        sleep_ms(2500);
 
+#if WEEWX_TRANSPORT_UDP
+        if(fresh) {
+            args.rain = rain.peek();
+            cyw43_arch_lwip_begin();
+            if(transport.send(args)) {
+                rain.take();
+            }
+            cyw43_arch_lwip_end();
+        }
+#else
+        if(client.socket()->connected() && fresh) {
+            args.rain = rain.take();
+            // pico-web-client only sends events it frames itself, so this
+            // still goes through nlohmann::json rather than write_packet()
+            client.socket()->emit("weather_event", create_packet(args));
+            confirm_image();
+        }
+#endif
+        // Sleep until the next sensor is due, waking early to collect a
+        // measurement in progress and to follow gusts while the wind blows
+        absolute_time_t wake = make_timeout_time_ms(LOOP_MAX_INTERVAL_MS);
+        if(measuring) {
+            wake = make_timeout_time_ms(MEASUREMENT_WAIT_MS);
+        } else if(windy) {
+            wake = absolute_time_min(wake, make_timeout_time_ms(SAMPLE_MIN_INTERVAL_MS));
+        }
+        wake = absolute_time_min(wake, absolute_time_min(outdoor_due, indoor_due));
+#if BMP280
+        wake = absolute_time_min(wake, pressure_due);
+#endif
+        if(on_trial) {
+            wake = absolute_time_min(wake, make_timeout_time_ms(OTA_TRIAL_SLEEP_MS));
+        }
+        sleep_until(wake);
     }
     return 0;
 }
\ No newline at end of file
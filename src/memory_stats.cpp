@@ -0,0 +1,77 @@
+#include "memory_stats.h"
+
+#include <malloc.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include "logger.h"
+
+#define STACK_PAINT         0xDEADBEEF
+// Leave the frames of the painting function itself alone
+#define STACK_PAINT_MARGIN  64
+
+// Provided by the pico-sdk linker script
+extern uint32_t __StackBottom, __StackTop;
+extern uint32_t __StackOneBottom, __StackOneTop;
+extern char end, __StackLimit;
+
+static size_t peak_in_use = 0;
+
+static void paint(uint32_t *bottom, uint32_t *top) {
+    for(uint32_t *word = bottom; word < top; word++) {
+        *word = STACK_PAINT;
+    }
+}
+
+static stack_usage measure(uint32_t *bottom, uint32_t *top) {
+    uint32_t *word = bottom;
+    while(word < top && *word == STACK_PAINT) {
+        word++;
+    }
+    return {(size_t)(top - bottom) * sizeof(uint32_t), (size_t)(top - word) * sizeof(uint32_t)};
+}
+
+void memory_stats_paint() {
+    uint32_t marker;
+    paint(&__StackBottom, &marker - STACK_PAINT_MARGIN / sizeof(uint32_t));
+    paint(&__StackOneBottom, &__StackOneTop);
+}
+
+stack_usage memory_stats_core0() {
+    return measure(&__StackBottom, &__StackTop);
+}
+
+stack_usage memory_stats_core1() {
+    return measure(&__StackOneBottom, &__StackOneTop);
+}
+
+heap_usage memory_stats_heap() {
+    struct mallinfo info = mallinfo();
+    char *brk = (char*)sbrk(0);
+    heap_usage usage;
+    usage.size = &__StackLimit - &end;
+    usage.high_water = info.arena;
+    usage.in_use = info.uordblks;
+    usage.free = info.fordblks + (&__StackLimit - brk);
+    usage.peak_in_use = peak_in_use > usage.in_use ? peak_in_use : usage.in_use;
+    usage.largest_free = info.keepcost + (&__StackLimit - brk);
+    return usage;
+}
+
+void memory_stats_sample() {
+    size_t in_use = mallinfo().uordblks;
+    if(in_use > peak_in_use) {
+        peak_in_use = in_use;
+    }
+}
+
+void memory_stats_print() {
+    memory_stats_sample();
+    stack_usage core0 = memory_stats_core0();
+    stack_usage core1 = memory_stats_core1();
+    heap_usage heap = memory_stats_heap();
+    info("Stack core0: %u/%u bytes\n", core0.high_water, core0.size);
+    info("Stack core1: %u/%u bytes\n", core1.high_water, core1.size);
+    info("Heap: %u in use (peak %u), %u free, largest free %u, high water %u/%u bytes\n",
+        heap.in_use, heap.peak_in_use, heap.free, heap.largest_free, heap.high_water, heap.size);
+}
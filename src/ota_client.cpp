@@ -0,0 +1,234 @@
+#include "ota_client.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <string>
+#include <string_view>
+
+#include <lwip/dns.h>
+
+#include "crc32.h"
+#include "logger.h"
+
+ota_client::ota_client(ota_slots &slots, flash_device &flash, const char *url)
+    : m_slots(slots)
+    , m_flash(flash)
+    , m_host{}
+    , m_path{}
+    , m_port(0)
+    , m_running_crc(0)
+    , m_phase(phase::idle)
+    , m_pcb(nullptr)
+    , m_addr{}
+    , m_queue(nullptr)
+    , m_closed(false)
+    , m_next_check(nil_time)
+    , m_deadline(nil_time)
+{
+    // Only plain http://host[:port]/path, images are verified by crc rather than by the transport
+    std::string_view remaining(url);
+    if(!remaining.starts_with("http://")) {
+        error("ota_client: unsupported url '%s', updates disabled\n", url);
+        return;
+    }
+    remaining.remove_prefix(7);
+    size_t path_start = remaining.find('/');
+    std::string_view authority = remaining.substr(0, path_start);
+    std::string_view path = path_start == std::string_view::npos ? "/" : remaining.substr(path_start);
+    size_t colon = authority.find(':');
+    uint16_t port = 80;
+    if(colon != std::string_view::npos) {
+        port = atoi(std::string(authority.substr(colon + 1)).c_str());
+        authority = authority.substr(0, colon);
+    }
+    if(authority.empty() || authority.size() >= sizeof(m_host) || path.size() >= sizeof(m_path) || port == 0) {
+        error("ota_client: unsupported url '%s', updates disabled\n", url);
+        return;
+    }
+    memcpy(m_host, authority.data(), authority.size());
+    memcpy(m_path, path.data(), path.size());
+    m_port = port;
+
+    const ota_layout &layout = m_slots.layout();
+    auto running = m_flash.read(layout.active, m_slots.running_size());
+    m_running_crc = crc32(running.data(), running.size());
+    info("ota_client: running image %08lx, %zu bytes\n", (unsigned long)m_running_crc, m_slots.running_size());
+}
+
+ota_client::~ota_client() {
+    finish(false);
+}
+
+bool ota_client::poll() {
+    if(m_port == 0) {
+        return false;
+    }
+    if(m_phase == phase::idle) {
+        if(!time_reached(m_next_check)) {
+            return false;
+        }
+        // Nothing new is fetched until the running image has been confirmed
+        ota_state state = m_slots.state();
+        if(state != ota_state::confirmed && state != ota_state::rolled_back) {
+            m_next_check = make_timeout_time_ms(OTA_RETRY_INTERVAL_MS);
+            return false;
+        }
+        start();
+        return false;
+    }
+    if(time_reached(m_deadline)) {
+        warn1("ota_client: update check timed out\n");
+        finish(true);
+        return false;
+    }
+    if(m_queue == nullptr) {
+        if(m_closed) {
+            warn1("ota_client: connection closed before the update was complete\n");
+            finish(true);
+        }
+        return false;
+    }
+
+    pbuf *queue = m_queue;
+    m_queue = nullptr;
+    size_t total = queue->tot_len;
+    ota_download::status status = m_download->state();
+    for(pbuf *q = queue; q != nullptr && status == ota_download::status::more; q = q->next) {
+        status = m_download->feed({(const uint8_t*)q->payload, q->len});
+    }
+    pbuf_free(queue);
+    switch(status) {
+        case ota_download::status::more:
+            // Only now that it is in flash may the server send more
+            if(m_pcb != nullptr) {
+                tcp_recved(m_pcb, total);
+            }
+            m_deadline = make_timeout_time_ms(OTA_TIMEOUT_MS);
+            return false;
+        case ota_download::status::no_update:
+            finish(false);
+            return false;
+        case ota_download::status::failed:
+            finish(true);
+            return false;
+        case ota_download::status::done: {
+            bool staged = m_slots.stage(m_download->image_size(), m_download->image_crc());
+            finish(!staged);
+            return staged;
+        }
+    }
+    return false;
+}
+
+void ota_client::start() {
+    trace1("ota_client::start entered...\n");
+    m_phase = phase::resolving;
+    m_closed = false;
+    m_download.emplace(m_flash, m_slots.layout(), m_slots.running_size(), m_slots.record().rejected_crc);
+    m_deadline = make_timeout_time_ms(OTA_TIMEOUT_MS);
+    err_t err = dns_gethostbyname(m_host, &m_addr, dns_callback, this);
+    if(err == ERR_OK) {
+        connect();
+    } else if(err != ERR_INPROGRESS) {
+        error("ota_client: failed to resolve %s (err = %d)\n", m_host, err);
+        finish(true);
+    }
+}
+
+void ota_client::connect() {
+    m_pcb = tcp_new_ip_type(IP_GET_TYPE(&m_addr));
+    if(m_pcb == nullptr) {
+        error1("ota_client: failed to create pcb\n");
+        finish(true);
+        return;
+    }
+    tcp_arg(m_pcb, this);
+    tcp_recv(m_pcb, recv_callback);
+    tcp_err(m_pcb, err_callback);
+    m_phase = phase::connecting;
+    err_t err = tcp_connect(m_pcb, &m_addr, m_port, connected_callback);
+    if(err != ERR_OK) {
+        error("ota_client: failed to connect to %s:%d (err = %d)\n", m_host, m_port, err);
+        finish(true);
+    }
+}
+
+void ota_client::finish(bool retry) {
+    if(m_pcb != nullptr) {
+        tcp_arg(m_pcb, nullptr);
+        tcp_recv(m_pcb, nullptr);
+        tcp_err(m_pcb, nullptr);
+        if(tcp_close(m_pcb) != ERR_OK) {
+            tcp_abort(m_pcb);
+        }
+        m_pcb = nullptr;
+    }
+    if(m_queue != nullptr) {
+        pbuf_free(m_queue);
+        m_queue = nullptr;
+    }
+    m_download.reset();
+    m_phase = phase::idle;
+    m_closed = false;
+    m_next_check = make_timeout_time_ms(retry ? OTA_RETRY_INTERVAL_MS : OTA_CHECK_INTERVAL_MS);
+}
+
+void ota_client::dns_callback(const char *name, const ip_addr_t *addr, void *arg) {
+    ota_client *client = (ota_client*)arg;
+    if(client->m_phase != phase::resolving) {
+        return;
+    }
+    if(addr == nullptr) {
+        error("ota_client: failed to resolve %s\n", name);
+        client->finish(true);
+        return;
+    }
+    client->m_addr = *addr;
+    client->connect();
+}
+
+err_t ota_client::connected_callback(void *arg, tcp_pcb *pcb, err_t err) {
+    ota_client *client = (ota_client*)arg;
+    char request[sizeof(m_path) + sizeof(m_host) + 96];
+    int length = snprintf(request, sizeof(request),
+        "GET %s%cfrom=%08lx HTTP/1.0\r\nHost: %s\r\nUser-Agent: pico-weathernode\r\n\r\n",
+        client->m_path, strchr(client->m_path, '?') ? '&' : '?', (unsigned long)client->m_running_crc, client->m_host);
+    err = tcp_write(pcb, request, length, TCP_WRITE_FLAG_COPY);
+    if(err != ERR_OK) {
+        warn("ota_client: tcp_write failed (err = %d)\n", err);
+        client->m_closed = true;
+        return ERR_OK;
+    }
+    tcp_output(pcb);
+    client->m_phase = phase::receiving;
+    return ERR_OK;
+}
+
+err_t ota_client::recv_callback(void *arg, tcp_pcb *pcb, pbuf *p, err_t err) {
+    ota_client *client = (ota_client*)arg;
+    if(p == nullptr) {
+        // Remote closed the connection, whatever is queued is still applied
+        client->m_closed = true;
+        return ERR_OK;
+    }
+    // Flash writes are too slow for this context, poll() applies the data
+    if(client->m_queue == nullptr) {
+        client->m_queue = p;
+    } else {
+        pbuf_cat(client->m_queue, p);
+    }
+    return ERR_OK;
+}
+
+void ota_client::err_callback(void *arg, err_t err) {
+    ota_client *client = (ota_client*)arg;
+    if(client == nullptr) {
+        return;
+    }
+    // The pcb has already been freed by lwIP
+    client->m_pcb = nullptr;
+    client->m_closed = true;
+    warn("ota_client: connection error (err = %d)\n", err);
+}
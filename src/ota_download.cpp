@@ -0,0 +1,85 @@
+#include "ota_download.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <string_view>
+
+#include "logger.h"
+
+ota_download::ota_download(flash_device &flash, const ota_layout &layout, size_t running_size, uint32_t rejected_crc)
+    : m_flash(flash)
+    , m_layout(layout)
+    , m_running_size(running_size)
+    , m_rejected_crc(rejected_crc)
+    , m_status(status::more)
+    , m_header{}
+    , m_header_length(0)
+{
+}
+
+// Buffers the response head until its blank line, returns false on a
+// response that cannot be an update
+bool ota_download::headers(std::span<const uint8_t> data, size_t &used) {
+    size_t space = sizeof(m_header) - m_header_length;
+    size_t copied = data.size() < space ? data.size() : space;
+    memcpy(m_header + m_header_length, data.data(), copied);
+    std::string_view header(m_header, m_header_length + copied);
+    size_t end = header.find("\r\n\r\n");
+    if(end == std::string_view::npos) {
+        m_header_length += copied;
+        used = copied;
+        if(m_header_length == sizeof(m_header)) {
+            warn1("ota_download: response headers too large\n");
+            return false;
+        }
+        return true;
+    }
+    used = end + 4 - m_header_length;
+    m_header_length = end + 4;
+
+    int status = 0;
+    if(!header.starts_with("HTTP/1.") || header.size() < 9 || sscanf(m_header + 8, " %d", &status) != 1) {
+        warn1("ota_download: malformed response\n");
+        return false;
+    }
+    if(status == 204 || status == 404) {
+        info1("ota_download: no update available\n");
+        m_status = status::no_update;
+        return true;
+    }
+    if(status != 200) {
+        warn("ota_download: server answered %d\n", status);
+        return false;
+    }
+    m_patch.emplace(m_flash, m_layout.active, m_running_size, m_layout.staging, m_layout.slot_size);
+    info1("ota_download: downloading update\n");
+    return true;
+}
+
+ota_download::status ota_download::feed(std::span<const uint8_t> data) {
+    if(m_status != status::more) {
+        return m_status;
+    }
+    if(!m_patch) {
+        size_t used = 0;
+        if(!headers(data, used)) {
+            m_status = status::failed;
+            return m_status;
+        }
+        data = data.subspan(used);
+    }
+    if(m_status != status::more || !m_patch || data.empty()) {
+        return m_status;
+    }
+    delta_patch::status patched = m_patch->feed(data);
+    if(patched == delta_patch::status::failed) {
+        m_status = status::failed;
+    } else if(m_patch->image_size() != 0 && m_patch->image_crc() == m_rejected_crc) {
+        warn("ota_download: image %08lx was rolled back before, skipping it\n", (unsigned long)m_patch->image_crc());
+        m_status = status::no_update;
+    } else if(patched == delta_patch::status::done) {
+        m_status = status::done;
+    }
+    return m_status;
+}
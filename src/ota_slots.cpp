@@ -0,0 +1,276 @@
+#include "ota_slots.h"
+
+#include <string.h>
+#include <algorithm>
+
+#include "crc32.h"
+#include "flash_layout.h"
+#include "logger.h"
+
+#define OTA_RECORD_MAGIC   0x41544F57
+#define OTA_RECORD_PAGE    0
+#define OTA_PROGRESS_PAGE  1
+#define OTA_ATTEMPTS_PAGE  2
+// Each swapped sector takes three steps, one bit each
+#define OTA_MAX_SECTORS    (FLASH_DEVICE_PAGE_SIZE * 8 / 3)
+
+ota_layout ota_layout_for(size_t flash_size) {
+    uint32_t state = flash_size - 2 * FLASH_DEVICE_SECTOR_SIZE;
+    uint32_t scratch = state - FLASH_DEVICE_SECTOR_SIZE;
+    size_t slot_size = ((scratch - FLASH_LOADER_SIZE) / 2) & ~(FLASH_DEVICE_SECTOR_SIZE - 1);
+    return {
+        .active = FLASH_LOADER_SIZE,
+        .staging = (uint32_t)(FLASH_LOADER_SIZE + slot_size),
+        .scratch = scratch,
+        .state = state,
+        .slot_size = slot_size
+    };
+}
+
+const char *ota_state_name(ota_state state) {
+    switch(state) {
+        case ota_state::confirmed: return "confirmed";
+        case ota_state::staged: return "staged";
+        case ota_state::swapping: return "swapping";
+        case ota_state::trial: return "trial";
+        case ota_state::rolled_back: return "rolled back";
+    }
+    return "unknown";
+}
+
+ota_slots::ota_slots(flash_device &flash, const ota_layout &layout, size_t running_size)
+    : m_flash(flash), m_layout(layout), m_running_size(running_size), m_current(layout.state) {
+    load();
+}
+
+bool ota_slots::read_record(uint32_t sector, ota_record &record) const {
+    auto stored = m_flash.read(sector + OTA_RECORD_PAGE * FLASH_DEVICE_PAGE_SIZE, sizeof(ota_record));
+    if(stored.size() != sizeof(ota_record)) {
+        return false;
+    }
+    memcpy(&record, stored.data(), sizeof(ota_record));
+    return record.magic == OTA_RECORD_MAGIC && record.crc == crc32(&record, offsetof(ota_record, crc));
+}
+
+bool ota_slots::load() {
+    ota_record first, second;
+    uint32_t other = m_layout.state + FLASH_DEVICE_SECTOR_SIZE;
+    bool first_valid = read_record(m_layout.state, first);
+    bool second_valid = read_record(other, second);
+    // A store interrupted before its record was complete leaves the previous one in charge
+    if(first_valid && (!second_valid || (int32_t)(first.sequence - second.sequence) > 0)) {
+        m_record = first;
+        m_current = m_layout.state;
+        return true;
+    }
+    if(second_valid) {
+        m_record = second;
+        m_current = other;
+        return true;
+    }
+    // Never updated, or both records are unreadable: whatever is running is all there is
+    m_record = {
+        .magic = OTA_RECORD_MAGIC,
+        .state = ota_state::confirmed,
+        .image_size = (uint32_t)m_running_size,
+        .next_state = ota_state::confirmed
+    };
+    m_current = other;
+    return false;
+}
+
+bool ota_slots::store(const ota_record &record) {
+    uint8_t page[FLASH_DEVICE_PAGE_SIZE];
+    memset(page, 0xFF, sizeof(page));
+    ota_record stored = record;
+    stored.magic = OTA_RECORD_MAGIC;
+    stored.sequence = m_record.sequence + 1;
+    stored.crc = crc32(&stored, offsetof(ota_record, crc));
+    memcpy(page, &stored, sizeof(stored));
+
+    // The erase also gives the new record empty progress and attempt bitmaps
+    uint32_t next = m_current == m_layout.state ? m_layout.state + FLASH_DEVICE_SECTOR_SIZE : m_layout.state;
+    if(!m_flash.erase(next, FLASH_DEVICE_SECTOR_SIZE) || !m_flash.program(next, page)) {
+        error("ota_slots: failed to store %s record\n", ota_state_name(record.state));
+        return false;
+    }
+    m_record = stored;
+    m_current = next;
+    return true;
+}
+
+uint32_t ota_slots::count_cleared(uint32_t page) const {
+    auto bits = m_flash.read(m_current + page * FLASH_DEVICE_PAGE_SIZE, FLASH_DEVICE_PAGE_SIZE);
+    uint32_t count = 0;
+    for(uint8_t byte : bits) {
+        count += __builtin_popcount((uint8_t)~byte);
+    }
+    return count;
+}
+
+// Programming only clears bits, so counters are kept without an erase
+bool ota_slots::mark(uint32_t page, uint32_t bit) {
+    uint8_t bits[FLASH_DEVICE_PAGE_SIZE];
+    memset(bits, 0xFF, sizeof(bits));
+    bits[bit >> 3] = ~(1 << (bit & 7));
+    return m_flash.program(m_current + page * FLASH_DEVICE_PAGE_SIZE, bits);
+}
+
+uint32_t ota_slots::attempts() const {
+    return m_record.state == ota_state::trial ? count_cleared(OTA_ATTEMPTS_PAGE) : 0;
+}
+
+bool ota_slots::copy_sector(uint32_t to, uint32_t from) {
+    if(!m_flash.erase(to, FLASH_DEVICE_SECTOR_SIZE)) {
+        return false;
+    }
+    // Through RAM, flash cannot be read while it is being programmed
+    uint8_t page[FLASH_DEVICE_PAGE_SIZE];
+    for(uint32_t offset = 0; offset < FLASH_DEVICE_SECTOR_SIZE; offset += FLASH_DEVICE_PAGE_SIZE) {
+        auto source = m_flash.read(from + offset, sizeof(page));
+        if(source.size() != sizeof(page)) {
+            return false;
+        }
+        memcpy(page, source.data(), sizeof(page));
+        if(!m_flash.program(to + offset, page)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Exchanges the first sectors of the active and staging slots through the
+// scratch sector, marking each step in the progress bitmap once it is done.
+// Every step only reads a sector that no earlier step has overwritten, so
+// the swap can resume from any step after a reset. The loader that runs it
+// is never part of a slot.
+bool ota_slots::swap(uint32_t first_step) {
+    info("ota_slots: swapping %lu sectors from step %lu, then %s\n",
+         (unsigned long)m_record.sectors, (unsigned long)first_step, ota_state_name(m_record.next_state));
+    uint32_t step = 0;
+    for(uint32_t sector = m_record.sectors; sector-- > 0; ) {
+        uint32_t active = m_layout.active + sector * FLASH_DEVICE_SECTOR_SIZE;
+        uint32_t staging = m_layout.staging + sector * FLASH_DEVICE_SECTOR_SIZE;
+        for(uint32_t part = 0; part < 3; part++, step++) {
+            if(step < first_step) {
+                continue;
+            }
+            bool copied;
+            if(part == 0) {
+                copied = copy_sector(m_layout.scratch, active);
+            } else if(part == 1) {
+                copied = copy_sector(active, staging);
+            } else {
+                copied = copy_sector(staging, m_layout.scratch);
+            }
+            if(!copied || !mark(OTA_PROGRESS_PAGE, step)) {
+                error("ota_slots: swap failed at step %lu\n", (unsigned long)step);
+                return false;
+            }
+        }
+    }
+    ota_record record = m_record;
+    record.state = m_record.next_state;
+    record.next_state = ota_state::confirmed;
+    return store(record);
+}
+
+bool ota_slots::boot() {
+    debug("ota_slots: boot in state %s\n", ota_state_name(m_record.state));
+    switch(m_record.state) {
+        case ota_state::confirmed:
+        case ota_state::rolled_back:
+            return false;
+
+        case ota_state::staged: {
+            auto image = m_flash.read(m_layout.staging, m_record.image_size);
+            if(image.size() != m_record.image_size || crc32(image.data(), image.size()) != m_record.image_crc) {
+                error("ota_slots: staged image is corrupt, discarding it\n");
+                ota_record record = m_record;
+                record.state = ota_state::confirmed;
+                store(record);
+                return false;
+            }
+            ota_record record = m_record;
+            record.state = ota_state::swapping;
+            record.next_state = ota_state::trial;
+            if(!store(record)) {
+                return false;
+            }
+            return swap(0);
+        }
+
+        case ota_state::swapping:
+            // Steps already done are skipped, the first pending one is redone
+            return swap(count_cleared(OTA_PROGRESS_PAGE));
+
+        case ota_state::trial: {
+            uint32_t used = count_cleared(OTA_ATTEMPTS_PAGE);
+            if(used >= OTA_MAX_ATTEMPTS) {
+                warn("ota_slots: image %08lx never confirmed after %lu boots, rolling back\n",
+                     (unsigned long)m_record.image_crc, (unsigned long)used);
+                ota_record record = m_record;
+                record.state = ota_state::swapping;
+                record.next_state = ota_state::rolled_back;
+                record.image_size = m_record.previous_size;
+                record.image_crc = m_record.previous_crc;
+                record.previous_size = m_record.image_size;
+                record.previous_crc = m_record.image_crc;
+                record.rejected_crc = m_record.image_crc;
+                if(!store(record)) {
+                    return false;
+                }
+                return swap(0);
+            }
+            mark(OTA_ATTEMPTS_PAGE, used);
+            info("ota_slots: trial boot %lu of %d for image %08lx\n",
+                 (unsigned long)used + 1, OTA_MAX_ATTEMPTS, (unsigned long)m_record.image_crc);
+            return false;
+        }
+    }
+    return false;
+}
+
+bool ota_slots::stage(size_t image_size, uint32_t image_crc) {
+    if(m_record.state != ota_state::confirmed && m_record.state != ota_state::rolled_back) {
+        warn("ota_slots: cannot stage while %s\n", ota_state_name(m_record.state));
+        return false;
+    }
+    if(image_crc == m_record.rejected_crc) {
+        warn("ota_slots: image %08lx was rolled back before, not staging it\n", (unsigned long)image_crc);
+        return false;
+    }
+    size_t covered = std::max(image_size, m_running_size);
+    uint32_t sectors = (covered + FLASH_DEVICE_SECTOR_SIZE - 1) / FLASH_DEVICE_SECTOR_SIZE;
+    if(image_size == 0 || image_size > m_layout.slot_size || sectors > OTA_MAX_SECTORS) {
+        error("ota_slots: image of %zu bytes does not fit\n", image_size);
+        return false;
+    }
+
+    auto running = m_flash.read(m_layout.active, m_running_size);
+    ota_record record = m_record;
+    record.state = ota_state::staged;
+    record.image_size = image_size;
+    record.image_crc = image_crc;
+    record.previous_size = m_running_size;
+    record.previous_crc = crc32(running.data(), running.size());
+    record.sectors = sectors;
+    record.next_state = ota_state::trial;
+    if(!store(record)) {
+        return false;
+    }
+    info("ota_slots: staged image %08lx, %zu bytes\n", (unsigned long)image_crc, image_size);
+    return true;
+}
+
+void ota_slots::confirm() {
+    if(m_record.state != ota_state::trial) {
+        return;
+    }
+    ota_record record = m_record;
+    record.state = ota_state::confirmed;
+    record.rejected_crc = 0;
+    if(store(record)) {
+        info("ota_slots: image %08lx confirmed\n", (unsigned long)record.image_crc);
+    }
+}
@@ -0,0 +1,45 @@
+#include "packet_writer.h"
+
+#include <stdio.h>
+#include <math.h>
+#include <string.h>
+
+static size_t null_number(char (&out)[PACKET_NUMBER_SIZE]) {
+    memcpy(out, "null", 4);
+    return 4;
+}
+
+// snprintf returns the length it wanted, not what fit. A truncated number
+// would still parse, as the wrong value, so it is never written.
+static size_t fitted(char (&out)[PACKET_NUMBER_SIZE], int length) {
+    if(length < 0 || length >= PACKET_NUMBER_SIZE) {
+        return null_number(out);
+    }
+    return length;
+}
+
+size_t format_packet_number(char (&out)[PACKET_NUMBER_SIZE], double value) {
+    if(!isfinite(value)) {
+        return null_number(out);
+    }
+    // Only timestamps are doubles, milliseconds are plenty
+    int length = snprintf(out, PACKET_NUMBER_SIZE, "%.3f", value);
+    if(length >= PACKET_NUMBER_SIZE) {
+        // Too large for fixed point, which no timestamp is. %.17g always
+        // fits and reads back as the same double.
+        length = snprintf(out, PACKET_NUMBER_SIZE, "%.17g", value);
+    }
+    return fitted(out, length);
+}
+
+size_t format_packet_number(char (&out)[PACKET_NUMBER_SIZE], float value) {
+    if(!isfinite(value)) {
+        return null_number(out);
+    }
+    // Enough digits to round trip a float, without the noise of widening it to double
+    return fitted(out, snprintf(out, PACKET_NUMBER_SIZE, "%.7g", value));
+}
+
+size_t format_packet_number(char (&out)[PACKET_NUMBER_SIZE], int value) {
+    return fitted(out, snprintf(out, PACKET_NUMBER_SIZE, "%d", value));
+}
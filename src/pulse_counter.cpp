@@ -0,0 +1,82 @@
+#include "pulse_counter.h"
+
+#include <hardware/dma.h>
+
+#include "logger.h"
+#include "pulse_counter.pio.h"
+
+// Re-arm the DMA channel well before the transfer count runs out
+#define PULSE_COUNTER_DMA_TRANSFERS 0xFFFFFFFF
+#define PULSE_COUNTER_DMA_REARM     0x80000000
+
+// The program is shared between every counter on the same PIO block
+static int program_offset[NUM_PIOS] = {-1, -1};
+
+pulse_counter::pulse_counter(PIO pio, uint8_t pin, uint32_t debounce_us)
+    : m_pio(pio)
+    , m_sm(-1)
+    , m_dma(-1)
+    , m_count(0)
+{
+    trace1("pulse_counter constructor entered...\n");
+    uint index = pio_get_index(pio);
+    if(program_offset[index] < 0) {
+        if(!pio_can_add_program(pio, &pulse_counter_program)) {
+            error("pulse_counter: no room for program on pio%d\n", index);
+            return;
+        }
+        program_offset[index] = pio_add_program(pio, &pulse_counter_program);
+    }
+    m_sm = pio_claim_unused_sm(pio, false);
+    if(m_sm < 0) {
+        error("pulse_counter: no free state machine on pio%d\n", index);
+        return;
+    }
+    m_dma = dma_claim_unused_channel(false);
+    if(m_dma < 0) {
+        error1("pulse_counter: no free dma channel\n");
+        pio_sm_unclaim(pio, m_sm);
+        m_sm = -1;
+        return;
+    }
+    arm_dma();
+    pulse_counter_program_init(pio, m_sm, program_offset[index], pin, debounce_us);
+    trace1("pulse_counter constructor exited.\n");
+}
+
+pulse_counter::~pulse_counter() {
+    if(m_sm >= 0) {
+        pio_sm_set_enabled(m_pio, m_sm, false);
+        pio_sm_unclaim(m_pio, m_sm);
+    }
+    if(m_dma >= 0) {
+        dma_channel_abort(m_dma);
+        dma_channel_unclaim(m_dma);
+    }
+}
+
+bool pulse_counter::valid() const {
+    return m_sm >= 0 && m_dma >= 0;
+}
+
+uint32_t pulse_counter::count() {
+    if(!valid()) {
+        return 0;
+    }
+    if(dma_channel_hw_addr(m_dma)->transfer_count < PULSE_COUNTER_DMA_REARM) {
+        arm_dma();
+    }
+    return m_count;
+}
+
+void pulse_counter::arm_dma() {
+    if(dma_channel_is_busy(m_dma)) {
+        dma_channel_abort(m_dma);
+    }
+    dma_channel_config c = dma_channel_get_default_config(m_dma);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_32);
+    channel_config_set_read_increment(&c, false);
+    channel_config_set_write_increment(&c, false);
+    channel_config_set_dreq(&c, pio_get_dreq(m_pio, m_sm, false));
+    dma_channel_configure(m_dma, &c, &m_count, &m_pio->rxf[m_sm], PULSE_COUNTER_DMA_TRANSFERS, true);
+}
@@ -0,0 +1,30 @@
+#include "rain_tracker.h"
+
+rain_tracker::rain_tracker(cm_t cm_per_tip)
+    : m_cm_per_tip(cm_per_tip)
+    , m_last_count(0)
+    , m_pending(0)
+    , m_primed(false)
+{}
+
+void rain_tracker::update(uint32_t count) {
+    if(m_primed) {
+        m_pending += count - m_last_count;
+    }
+    m_last_count = count;
+    m_primed = true;
+}
+
+cm_t rain_tracker::take() {
+    cm_t rain = m_pending * m_cm_per_tip;
+    m_pending = 0;
+    return rain;
+}
+
+cm_t rain_tracker::peek() const {
+    return m_pending * m_cm_per_tip;
+}
+
+uint32_t rain_tracker::pending_tips() const {
+    return m_pending;
+}
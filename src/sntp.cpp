@@ -0,0 +1,68 @@
+#include "sntp.h"
+
+#include <string.h>
+
+// Seconds between the NTP epoch (1900) and the unix epoch (1970)
+#define NTP_UNIX_OFFSET  2208988800ull
+#define SNTP_LI_MASK     0xC0
+#define SNTP_LI_ALARM    0xC0
+#define SNTP_VERSION     (4 << 3)
+#define SNTP_MODE_MASK   0x07
+#define SNTP_MODE_CLIENT 3
+#define SNTP_MODE_SERVER 4
+#define SNTP_STRATUM     1
+#define SNTP_ORIGINATE   24
+#define SNTP_RECEIVE     32
+#define SNTP_TRANSMIT    40
+
+static void put_u64(uint8_t *out, uint64_t value) {
+    for(int i = 7; i >= 0; i--) {
+        out[i] = value;
+        value >>= 8;
+    }
+}
+
+static uint64_t get_u64(const uint8_t *data) {
+    uint64_t value = 0;
+    for(int i = 0; i < 8; i++) {
+        value = value << 8 | data[i];
+    }
+    return value;
+}
+
+// NTP 32.32 fixed point to microseconds since the unix epoch
+static int64_t ntp_to_unix_us(uint64_t timestamp) {
+    int64_t seconds = (int64_t)(timestamp >> 32) - (int64_t)NTP_UNIX_OFFSET;
+    int64_t fraction_us = (int64_t)(((timestamp & 0xFFFFFFFF) * 1000000ull) >> 32);
+    return seconds * 1000000ll + fraction_us;
+}
+
+void sntp_build_request(std::span<uint8_t, SNTP_PACKET_SIZE> out, uint64_t nonce) {
+    memset(out.data(), 0, out.size());
+    out[0] = SNTP_VERSION | SNTP_MODE_CLIENT;
+    put_u64(out.data() + SNTP_TRANSMIT, nonce);
+}
+
+bool sntp_parse_response(std::span<const uint8_t> data, uint64_t nonce, uint64_t sent_us, uint64_t received_us, int64_t &utc_us) {
+    if(data.size() < SNTP_PACKET_SIZE) {
+        return false;
+    }
+    if((data[0] & SNTP_MODE_MASK) != SNTP_MODE_SERVER || (data[0] & SNTP_LI_MASK) == SNTP_LI_ALARM) {
+        return false;
+    }
+    // Stratum 0 is a kiss-o'-death, anything above 15 is unsynchronized
+    if(data[1] < SNTP_STRATUM || data[1] > 15) {
+        return false;
+    }
+    if(get_u64(data.data() + SNTP_ORIGINATE) != nonce) {
+        return false;
+    }
+    int64_t server_received = ntp_to_unix_us(get_u64(data.data() + SNTP_RECEIVE));
+    int64_t server_sent = ntp_to_unix_us(get_u64(data.data() + SNTP_TRANSMIT));
+    int64_t round_trip = (int64_t)(received_us - sent_us) - (server_sent - server_received);
+    if(round_trip < 0) {
+        round_trip = 0;
+    }
+    utc_us = server_sent + round_trip / 2;
+    return true;
+}
@@ -0,0 +1,102 @@
+#include "sntp_client.h"
+
+#include <pico/rand.h>
+#include <lwip/dns.h>
+
+#include "logger.h"
+#include "sntp.h"
+
+sntp_client::sntp_client(clock_sync &clock, const char *server)
+    : m_clock(clock)
+    , m_server(server)
+    , m_pcb(nullptr)
+    , m_addr{}
+    , m_next_request(nil_time)
+    , m_sent_us(0)
+    , m_nonce(0)
+    , m_resolving(false)
+    , m_waiting(false)
+{}
+
+sntp_client::~sntp_client() {
+    if(m_pcb != nullptr) {
+        udp_remove(m_pcb);
+        m_pcb = nullptr;
+    }
+}
+
+void sntp_client::poll() {
+    if(m_resolving || !time_reached(m_next_request)) {
+        return;
+    }
+    if(m_waiting) {
+        warn1("sntp_client: request timed out\n");
+        m_waiting = false;
+    }
+    if(m_pcb == nullptr) {
+        m_pcb = udp_new_ip_type(IPADDR_TYPE_ANY);
+        if(m_pcb == nullptr) {
+            error1("sntp_client: failed to create pcb\n");
+            return;
+        }
+        udp_recv(m_pcb, recv_callback, this);
+    }
+    m_next_request = make_timeout_time_ms(SNTP_RETRY_INTERVAL_MS);
+    // Resolve every time so pool rotation spreads the load
+    err_t err = dns_gethostbyname(m_server, &m_addr, dns_callback, this);
+    if(err == ERR_OK) {
+        request();
+    } else if(err == ERR_INPROGRESS) {
+        m_resolving = true;
+    } else {
+        error("sntp_client: failed to resolve %s (err = %d)\n", m_server, err);
+    }
+}
+
+void sntp_client::request() {
+    trace1("sntp_client::request entered...\n");
+    pbuf *p = pbuf_alloc(PBUF_TRANSPORT, SNTP_PACKET_SIZE, PBUF_RAM);
+    if(p == nullptr) {
+        warn1("sntp_client: out of pbufs\n");
+        return;
+    }
+    m_nonce = get_rand_64();
+    sntp_build_request(std::span<uint8_t, SNTP_PACKET_SIZE>((uint8_t*)p->payload, SNTP_PACKET_SIZE), m_nonce);
+    m_sent_us = time_us_64();
+    err_t err = udp_sendto(m_pcb, p, &m_addr, SNTP_PORT);
+    pbuf_free(p);
+    if(err != ERR_OK) {
+        warn("sntp_client: udp_sendto failed (err = %d)\n", err);
+        return;
+    }
+    m_waiting = true;
+    trace1("sntp_client::request exiting.\n");
+}
+
+void sntp_client::dns_callback(const char *name, const ip_addr_t *addr, void *arg) {
+    sntp_client *client = (sntp_client*)arg;
+    client->m_resolving = false;
+    if(addr == nullptr) {
+        error("sntp_client: failed to resolve %s\n", name);
+        return;
+    }
+    client->m_addr = *addr;
+    client->request();
+}
+
+void sntp_client::recv_callback(void *arg, udp_pcb *pcb, pbuf *p, const ip_addr_t *addr, u16_t port) {
+    uint64_t received_us = time_us_64();
+    sntp_client *client = (sntp_client*)arg;
+    uint8_t data[SNTP_PACKET_SIZE];
+    size_t length = pbuf_copy_partial(p, data, sizeof(data), 0);
+    pbuf_free(p);
+    int64_t utc_us;
+    if(!client->m_waiting || !sntp_parse_response({data, length}, client->m_nonce, client->m_sent_us, received_us, utc_us)) {
+        warn1("sntp_client: ignoring invalid response\n");
+        return;
+    }
+    client->m_waiting = false;
+    client->m_clock.update(received_us, utc_us);
+    client->m_next_request = make_timeout_time_ms(SNTP_INTERVAL_MS);
+    debug("sntp_client: synced, drift %d ppb\n", client->m_clock.drift_ppb());
+}
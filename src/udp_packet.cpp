@@ -0,0 +1,80 @@
+#include "udp_packet.h"
+
+#include <string.h>
+
+static void put_u32(uint8_t *out, uint32_t value) {
+    out[0] = value;
+    out[1] = value >> 8;
+    out[2] = value >> 16;
+    out[3] = value >> 24;
+}
+
+static void put_u64(uint8_t *out, uint64_t value) {
+    put_u32(out, value);
+    put_u32(out + 4, value >> 32);
+}
+
+static uint32_t get_u32(const uint8_t *data) {
+    return data[0] | data[1] << 8 | data[2] << 16 | (uint32_t)data[3] << 24;
+}
+
+template<typename T>
+static void put_field(uint8_t *&out, udp_field id, const std::optional<T> &value) {
+    if(!value.has_value()) {
+        return;
+    }
+    float f = (float)*value;
+    uint32_t bits;
+    memcpy(&bits, &f, sizeof(bits));
+    *out++ = (uint8_t)id;
+    put_u32(out, bits);
+    out += 4;
+}
+
+size_t encode_udp_packet(const packet_args &args, uint32_t sequence, uint8_t flags, std::span<uint8_t> out) {
+    if(out.size() < UDP_PACKET_MAX_SIZE) {
+        return 0;
+    }
+    uint8_t *data = out.data();
+    data[0] = 'W';
+    data[1] = 'N';
+    data[2] = UDP_PACKET_VERSION;
+    data[3] = flags;
+    put_u32(data + 4, sequence);
+    put_u64(data + 8, args.dateTime.has_value() ? (int64_t)(*args.dateTime * 1000000.0) : 0);
+    uint8_t *cursor = data + UDP_PACKET_HEADER;
+    put_field(cursor, udp_field::outTemp, args.outTemp);
+    put_field(cursor, udp_field::inTemp, args.inTemp);
+    put_field(cursor, udp_field::barometer, args.barometer);
+    put_field(cursor, udp_field::pressure, args.pressure);
+    put_field(cursor, udp_field::windSpeed, args.windSpeed);
+    put_field(cursor, udp_field::windDir, args.windDir);
+    put_field(cursor, udp_field::windGust, args.windGust);
+    put_field(cursor, udp_field::windGustDir, args.windGustDir);
+    put_field(cursor, udp_field::outHumidity, args.outHumidity);
+    put_field(cursor, udp_field::inHumidity, args.inHumidity);
+    put_field(cursor, udp_field::radiation, args.radiation);
+    put_field(cursor, udp_field::UV, args.UV);
+    put_field(cursor, udp_field::rain, args.rain);
+    put_field(cursor, udp_field::txBatteryStatus, args.txBatteryStatus);
+    put_field(cursor, udp_field::windBatteryStatus, args.windBatteryStatus);
+    put_field(cursor, udp_field::rainBatteryStatus, args.rainBatteryStatus);
+    put_field(cursor, udp_field::outTempBatteryStatus, args.outTempBatteryStatus);
+    put_field(cursor, udp_field::inTempBatteryStatus, args.inTempBatteryStatus);
+    put_field(cursor, udp_field::consBatteryVoltage, args.consBatteryVoltage);
+    put_field(cursor, udp_field::heatingVoltage, args.heatingVoltage);
+    put_field(cursor, udp_field::supplyVoltage, args.supplyVoltage);
+    put_field(cursor, udp_field::referenceVoltage, args.referenceVoltage);
+    put_field(cursor, udp_field::rxCheckPercent, args.rxCheckPercent);
+    put_field(cursor, udp_field::dewpoint, args.dewpoint);
+    put_field(cursor, udp_field::heatindex, args.heatindex);
+    return cursor - data;
+}
+
+bool decode_udp_ack(std::span<const uint8_t> data, uint32_t &sequence) {
+    if(data.size() < UDP_PACKET_ACK_SIZE || data[0] != 'W' || data[1] != 'A' || data[2] != UDP_PACKET_VERSION) {
+        return false;
+    }
+    sequence = get_u32(data.data() + 4);
+    return true;
+}
@@ -0,0 +1,186 @@
+#include "udp_transport.h"
+
+#include <string.h>
+
+#include <pico/rand.h>
+#include <lwip/dns.h>
+
+#include "logger.h"
+
+udp_transport::udp_transport(const char *host, uint16_t port, bool acknowledge)
+    : m_host(host)
+    , m_port(port)
+    , m_acknowledge(acknowledge)
+    , m_resolved(false)
+    , m_pcb(nullptr)
+    , m_addr{}
+    // A random start keeps a quick reboot from reusing sequence numbers the
+    // driver still remembers and would drop as duplicates
+    , m_sequence(get_rand_32())
+    , m_sent(0)
+    , m_dropped(0)
+    , m_acknowledged(0)
+    , m_pending{}
+{}
+
+udp_transport::~udp_transport() {
+    if(m_pcb != nullptr) {
+        udp_remove(m_pcb);
+        m_pcb = nullptr;
+    }
+}
+
+bool udp_transport::open() {
+    trace1("udp_transport::open entered...\n");
+    if(m_pcb == nullptr) {
+        m_pcb = udp_new_ip_type(IPADDR_TYPE_ANY);
+        if(m_pcb == nullptr) {
+            error1("udp_transport: failed to create pcb\n");
+            return false;
+        }
+        udp_recv(m_pcb, recv_callback, this);
+    }
+    if(m_resolved) {
+        return true;
+    }
+    err_t err = dns_gethostbyname(m_host, &m_addr, dns_callback, this);
+    if(err == ERR_OK) {
+        m_resolved = true;
+        info("udp_transport sending to %s:%d\n", ipaddr_ntoa(&m_addr), m_port);
+    } else if(err != ERR_INPROGRESS) {
+        error("udp_transport: failed to resolve %s (err = %d)\n", m_host, err);
+        return false;
+    }
+    trace1("udp_transport::open exiting.\n");
+    return true;
+}
+
+bool udp_transport::ready() const {
+    return m_pcb != nullptr && m_resolved;
+}
+
+bool udp_transport::send(const packet_args &args) {
+    trace1("udp_transport::send entered...\n");
+    if(!ready()) {
+        return false;
+    }
+    uint8_t flags = m_acknowledge ? UDP_PACKET_FLAG_ACK : 0;
+    uint8_t data[UDP_PACKET_MAX_SIZE];
+    size_t length = encode_udp_packet(args, m_sequence + 1, flags, data);
+    if(length == 0) {
+        warn1("udp_transport: packet does not encode\n");
+        return false;
+    }
+    uint32_t sequence = ++m_sequence;
+    if(!m_acknowledge) {
+        return transmit(data, length);
+    }
+    pending *slot = allocate();
+    memcpy(slot->data, data, length);
+    slot->length = length;
+    slot->sequence = sequence;
+    slot->retries = 0;
+    slot->resend_at = make_timeout_time_ms(UDP_TRANSPORT_TIMEOUT_MS);
+    slot->in_use = true;
+    // Once queued the datagram is poll()'s to deliver, so a failed first
+    // attempt still counts as sent and the caller must not resend it
+    transmit(slot->data, slot->length);
+    return true;
+}
+
+void udp_transport::poll() {
+    if(!ready()) {
+        return;
+    }
+    for(pending &slot : m_pending) {
+        if(!slot.in_use || !time_reached(slot.resend_at)) {
+            continue;
+        }
+        if(slot.retries >= UDP_TRANSPORT_RETRIES) {
+            warn("udp_transport: giving up on sequence %lu\n", (unsigned long)slot.sequence);
+            slot.in_use = false;
+            m_dropped++;
+            continue;
+        }
+        slot.retries++;
+        // Back off so a dead link does not keep the radio busy
+        slot.resend_at = make_timeout_time_ms(UDP_TRANSPORT_TIMEOUT_MS << slot.retries);
+        debug("udp_transport: resending sequence %lu (attempt %d)\n", (unsigned long)slot.sequence, slot.retries);
+        transmit(slot.data, slot.length);
+    }
+}
+
+uint32_t udp_transport::sent() const {
+    return m_sent;
+}
+
+uint32_t udp_transport::dropped() const {
+    return m_dropped;
+}
+
+uint32_t udp_transport::acknowledged() const {
+    return m_acknowledged;
+}
+
+bool udp_transport::transmit(const uint8_t *data, size_t length) {
+    pbuf *p = pbuf_alloc(PBUF_TRANSPORT, length, PBUF_RAM);
+    if(p == nullptr) {
+        warn1("udp_transport: out of pbufs\n");
+        return false;
+    }
+    memcpy(p->payload, data, length);
+    err_t err = udp_sendto(m_pcb, p, &m_addr, m_port);
+    pbuf_free(p);
+    if(err != ERR_OK) {
+        warn("udp_transport: udp_sendto failed (err = %d)\n", err);
+        return false;
+    }
+    m_sent++;
+    return true;
+}
+
+udp_transport::pending *udp_transport::allocate() {
+    pending *oldest = &m_pending[0];
+    for(pending &slot : m_pending) {
+        if(!slot.in_use) {
+            return &slot;
+        }
+        if(slot.sequence - oldest->sequence > 0x80000000) {
+            oldest = &slot;
+        }
+    }
+    // Pool is full, the oldest sample is the least useful one to keep
+    warn("udp_transport: dropping unacknowledged sequence %lu\n", (unsigned long)oldest->sequence);
+    m_dropped++;
+    return oldest;
+}
+
+void udp_transport::dns_callback(const char *name, const ip_addr_t *addr, void *arg) {
+    udp_transport *transport = (udp_transport*)arg;
+    if(addr == nullptr) {
+        error("udp_transport: failed to resolve %s\n", name);
+        return;
+    }
+    transport->m_addr = *addr;
+    transport->m_resolved = true;
+    info("udp_transport sending to %s:%d\n", ipaddr_ntoa(addr), transport->m_port);
+}
+
+void udp_transport::recv_callback(void *arg, udp_pcb *pcb, pbuf *p, const ip_addr_t *addr, u16_t port) {
+    udp_transport *transport = (udp_transport*)arg;
+    uint8_t data[UDP_PACKET_ACK_SIZE];
+    uint32_t sequence;
+    size_t length = pbuf_copy_partial(p, data, sizeof(data), 0);
+    pbuf_free(p);
+    if(!decode_udp_ack({data, length}, sequence)) {
+        return;
+    }
+    for(pending &slot : transport->m_pending) {
+        if(slot.in_use && slot.sequence == sequence) {
+            trace("udp_transport: sequence %lu acknowledged\n", (unsigned long)sequence);
+            slot.in_use = false;
+            transport->m_acknowledged++;
+            break;
+        }
+    }
+}
@@ -0,0 +1,105 @@
+#include "wind_tracker.h"
+
+wind_tracker::wind_tracker(float kmph_per_hz)
+    : m_ring{}
+    , m_head(0)
+    , m_size(0)
+    , m_gust(0)
+    , m_kmph_per_hz(kmph_per_hz)
+    , m_pulses(0.0f)
+    , m_last_count(0)
+    , m_last_ms(0)
+    , m_period_start_ms(0)
+    , m_primed(false)
+{}
+
+void wind_tracker::update(uint32_t count, uint32_t now_ms, std::optional<degree_compass_t> direction) {
+    if(!m_primed) {
+        // The first reading only establishes the baseline count and period
+        m_last_count = count;
+        m_last_ms = now_ms;
+        m_period_start_ms = now_ms;
+        m_pulses = 0.0f;
+        m_primed = true;
+        return;
+    }
+    // Unsigned subtraction handles the counter and the clock wrapping
+    float pulses = count - m_last_count;
+    uint32_t from_ms = m_last_ms;
+    m_last_count = count;
+    m_last_ms = now_ms;
+
+    uint32_t periods = (now_ms - m_period_start_ms) / WIND_PERIOD_MS;
+    if(periods > WIND_GUST_SLOTS) {
+        // A gap longer than the whole window, only its tail can be kept
+        uint32_t skipped = periods - WIND_GUST_SLOTS;
+        m_period_start_ms += skipped * WIND_PERIOD_MS;
+        if(m_period_start_ms - from_ms < now_ms - from_ms) {
+            pulses -= pulses * (m_period_start_ms - from_ms) / (now_ms - from_ms);
+            from_ms = m_period_start_ms;
+        }
+        m_pulses = 0.0f;
+    }
+    while(now_ms - m_period_start_ms >= WIND_PERIOD_MS) {
+        uint32_t end_ms = m_period_start_ms + WIND_PERIOD_MS;
+        float share = pulses * (end_ms - from_ms) / (now_ms - from_ms);
+        m_pulses += share;
+        pulses -= share;
+        from_ms = end_ms;
+        close_period(direction);
+    }
+    m_pulses += pulses;
+}
+
+void wind_tracker::reset() {
+    m_head = 0;
+    m_size = 0;
+    m_gust = 0;
+    m_primed = false;
+}
+
+std::optional<kmph_t> wind_tracker::speed() const {
+    if(m_size == 0) {
+        return {};
+    }
+    return newest().speed;
+}
+
+std::optional<kmph_t> wind_tracker::gust() const {
+    if(m_size == 0) {
+        return {};
+    }
+    return m_ring[m_gust].speed;
+}
+
+std::optional<degree_compass_t> wind_tracker::gust_direction() const {
+    if(m_size == 0) {
+        return {};
+    }
+    return m_ring[m_gust].direction;
+}
+
+void wind_tracker::close_period(std::optional<degree_compass_t> direction) {
+    m_ring[m_head] = {m_pulses * 1000.0f / WIND_PERIOD_MS * m_kmph_per_hz, direction};
+    m_head = (m_head + 1) % m_ring.size();
+    if(m_size < m_ring.size()) {
+        m_size++;
+    }
+    m_pulses = 0.0f;
+    m_period_start_ms += WIND_PERIOD_MS;
+    find_gust();
+}
+
+const wind_tracker::sample& wind_tracker::newest() const {
+    return m_ring[(m_head + m_ring.size() - 1) % m_ring.size()];
+}
+
+void wind_tracker::find_gust() {
+    // Walk from newest to oldest so ties report the most recent gust
+    for(size_t i = 0; i < m_size; i++) {
+        size_t index = (m_head + m_ring.size() - 1 - i) % m_ring.size();
+        if(i == 0 || m_ring[index].speed > m_ring[m_gust].speed) {
+            m_gust = index;
+        }
+    }
+}
@@ -0,0 +1,90 @@
+#include "wind_vane.h"
+
+#include <math.h>
+
+#include <algorithm>
+
+#include "adc_filter.h"
+
+// Ladder resistance for each 22.5 degree position, starting at north
+static const float vane_ohms[WIND_VANE_POSITIONS] = {
+    33000, 6570, 8200, 891, 1000, 688, 2200, 1410,
+    3900, 3140, 16000, 14120, 120000, 42120, 64900, 21880
+};
+
+// Unit vectors for each position, so averaging needs no trig per sample
+static const float vane_sin[WIND_VANE_POSITIONS] = {
+     0.000000f,  0.382683f,  0.707107f,  0.923880f,  1.000000f,  0.923880f,  0.707107f,  0.382683f,
+     0.000000f, -0.382683f, -0.707107f, -0.923880f, -1.000000f, -0.923880f, -0.707107f, -0.382683f
+};
+static const float vane_cos[WIND_VANE_POSITIONS] = {
+     1.000000f,  0.923880f,  0.707107f,  0.382683f,  0.000000f, -0.382683f, -0.707107f, -0.923880f,
+    -1.000000f, -0.923880f, -0.707107f, -0.382683f,  0.000000f,  0.382683f,  0.707107f,  0.923880f
+};
+
+wind_vane::wind_vane(float pullup_ohms, uint16_t tolerance_counts)
+    : m_table{}
+    , m_tolerance(tolerance_counts)
+{
+    for(uint8_t i = 0; i < WIND_VANE_POSITIONS; i++) {
+        m_table[i].counts = (uint16_t)(ADC_MAX_COUNTS * vane_ohms[i] / (vane_ohms[i] + pullup_ohms) + 0.5f);
+        m_table[i].index = i;
+    }
+    std::sort(std::begin(m_table), std::end(m_table), [](const position &a, const position &b) {
+        return a.counts < b.counts;
+    });
+}
+
+std::optional<degree_compass_t> wind_vane::lookup(uint16_t counts) const {
+    int index = find(counts);
+    if(index < 0) {
+        return {};
+    }
+    return index * (360.0f / WIND_VANE_POSITIONS);
+}
+
+std::optional<degree_compass_t> wind_vane::average(std::span<const uint16_t> samples, size_t offset, size_t stride) const {
+    float x = 0.0f, y = 0.0f;
+    size_t matched = 0;
+    for(size_t i = offset; i < samples.size(); i += stride) {
+        int index = find(samples[i]);
+        if(index < 0) {
+            continue;
+        }
+        x += vane_sin[index];
+        y += vane_cos[index];
+        matched++;
+    }
+    // Require most samples to decode, otherwise the vane is likely disconnected
+    if(matched == 0 || matched * 2 < (samples.size() - offset + stride - 1) / stride) {
+        return {};
+    }
+    if(fabsf(x) < 1e-3f * matched && fabsf(y) < 1e-3f * matched) {
+        // Readings cancel out, there is no meaningful mean direction
+        return {};
+    }
+    float degrees = atan2f(x, y) * (180.0f / (float)M_PI);
+    return degrees < 0.0f ? degrees + 360.0f : degrees;
+}
+
+int wind_vane::find(uint16_t counts) const {
+    // Binary search for the closest table entry
+    size_t low = 0, high = WIND_VANE_POSITIONS;
+    while(low < high) {
+        size_t mid = (low + high) / 2;
+        if(m_table[mid].counts < counts) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    size_t best = low;
+    if(low == WIND_VANE_POSITIONS || (low > 0 && counts - m_table[low - 1].counts < m_table[low].counts - counts)) {
+        best = low - 1;
+    }
+    uint16_t distance = counts > m_table[best].counts ? counts - m_table[best].counts : m_table[best].counts - counts;
+    if(distance > m_tolerance) {
+        return -1;
+    }
+    return m_table[best].index;
+}
@@ -0,0 +1,62 @@
+// Times the per-cycle ADC decimation on the host: adc_mean and the wind
+// vane average over a full three channel adc_sampler buffer. Host numbers
+// only rank changes against each other, the M0+ is far slower.
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+#include <optional>
+
+#include "adc_filter.h"
+#include "adc_sampler.h"
+#include "wind_vane.h"
+
+#define CHANNELS   3
+#define ITERATIONS 20000
+
+static double cpu_seconds() {
+    timespec now;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+int main() {
+    static uint16_t samples[CHANNELS * ADC_SAMPLER_SAMPLES_PER_CHANNEL];
+    wind_vane vane;
+    uint32_t seed = 1;
+    for(size_t i = 0; i < CHANNELS * ADC_SAMPLER_SAMPLES_PER_CHANNEL; i += CHANNELS) {
+        seed = seed * 1103515245 + 12345;
+        // Vane swinging between two neighbouring positions, noisy supplies
+        samples[i] = (seed >> 16) & 1 ? 3150 : 2650;
+        samples[i + 1] = 2480 + ((seed >> 8) & 15);
+        samples[i + 2] = 3100 + ((seed >> 4) & 15);
+    }
+    volatile float sink = 0;
+
+    double start = cpu_seconds();
+    for(int n = 0; n < ITERATIONS; n++) {
+        sink = sink + adc_mean(samples, 1, CHANNELS) + adc_mean(samples, 2, CHANNELS);
+    }
+    double mean_ns = (cpu_seconds() - start) / ITERATIONS * 1e9;
+
+    start = cpu_seconds();
+    for(int n = 0; n < ITERATIONS; n++) {
+        std::optional<degree_compass_t> direction = vane.average(samples, 0, CHANNELS);
+        sink = sink + direction.value_or(0);
+    }
+    double vane_ns = (cpu_seconds() - start) / ITERATIONS * 1e9;
+
+    start = cpu_seconds();
+    for(int n = 0; n < ITERATIONS; n++) {
+        for(uint16_t counts = 0; counts < ADC_MAX_COUNTS; counts += 64) {
+            sink = sink + vane.lookup(counts).value_or(0);
+        }
+    }
+    double lookup_ns = (cpu_seconds() - start) / (ITERATIONS * (ADC_MAX_COUNTS / 64 + 1)) * 1e9;
+
+    printf("%d samples per channel, %d channels\n", ADC_SAMPLER_SAMPLES_PER_CHANNEL, CHANNELS);
+    printf("adc_mean x2:        %8.0f ns per cycle\n", mean_ns);
+    printf("wind_vane average:  %8.0f ns per cycle\n", vane_ns);
+    printf("wind_vane lookup:   %8.1f ns per sample\n", lookup_ns);
+    return 0;
+}
@@ -0,0 +1,113 @@
+// What sending a packet costs on the socket.io path, which still builds an
+// nlohmann::json: the dump, the Socket.IO event text wrapped around it and
+// the masked websocket frame it is copied into. Against write_packet()
+// straight into a fixed buffer, which only the http cache does; the udp
+// transport encodes binary datagrams with encode_udp_packet() instead.
+// Reports bytes copied, heap allocations and CPU time per packet.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <new>
+#include <string>
+
+#include "loop_packet.h"
+#include "packet_args_sample.h"
+#include "packet_writer.h"
+
+#define ITERATIONS 200000
+#define BUFFER_SIZE 1460
+
+static size_t allocations = 0;
+
+void *operator new(size_t size) {
+    allocations++;
+    if(void *p = malloc(size)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept {
+    free(p);
+}
+
+void operator delete(void *p, size_t) noexcept {
+    free(p);
+}
+
+static char buffer[BUFFER_SIZE];
+static size_t copied = 0;
+
+static size_t serialize_socketio(const packet_args &args) {
+    std::string json = create_packet(args).dump();
+    copied += json.size();
+    // Engine.IO message, Socket.IO event
+    std::string event = "42[\"weather_event\"," + json + "]";
+    copied += event.size();
+    // A client websocket text frame: FIN and opcode, the length, extended
+    // past 125 bytes, then the mask key and the masked payload
+    const uint8_t mask[4] = {0x12, 0x34, 0x56, 0x78};
+    size_t length = 0;
+    buffer[length++] = (char)0x81;
+    if(event.size() < 126) {
+        buffer[length++] = (char)(0x80 | event.size());
+    } else {
+        buffer[length++] = (char)(0x80 | 126);
+        buffer[length++] = (char)(event.size() >> 8);
+        buffer[length++] = (char)event.size();
+    }
+    memcpy(buffer + length, mask, sizeof(mask));
+    length += sizeof(mask);
+    if(event.size() > sizeof(buffer) - length) {
+        return 0;
+    }
+    for(size_t i = 0; i < event.size(); i++) {
+        buffer[length + i] = event[i] ^ mask[i % 4];
+    }
+    length += event.size();
+    copied += length;
+    return length;
+}
+
+static size_t serialize_writer(const packet_args &args) {
+    size_t length = 0;
+    write_packet(args, [&length](std::string_view piece) {
+        if(length + piece.size() > sizeof(buffer)) {
+            return false;
+        }
+        memcpy(buffer + length, piece.data(), piece.size());
+        length += piece.size();
+        return true;
+    });
+    copied += length;
+    return length;
+}
+
+static double cpu_ns() {
+    timespec now;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &now);
+    return now.tv_sec * 1e9 + now.tv_nsec;
+}
+
+template<typename Serialize>
+static void run(const char *name, const packet_args &args, Serialize serialize) {
+    copied = 0;
+    allocations = 0;
+    size_t length = 0;
+    double start = cpu_ns();
+    for(uint32_t i = 0; i < ITERATIONS; i++) {
+        length = serialize(args);
+    }
+    double ns = (cpu_ns() - start) / ITERATIONS;
+    printf("%-9s %4zu bytes, copied %5zu bytes, %5.1f allocations, %7.1f ns per packet\n",
+           name, length, copied / ITERATIONS, (double)allocations / ITERATIONS, ns);
+}
+
+int main() {
+    packet_args args = sample_packet();
+    run("socketio", args, serialize_socketio);
+    run("writer", args, serialize_writer);
+    return 0;
+}
@@ -0,0 +1,152 @@
+// Replays temperature/humidity traces through adaptive_rate and compares
+// the result with fixed rate sampling: how many samples are saved, and how
+// far the held value (what weewx sees between samples) strays from a
+// reading taken every SAMPLE_MIN_INTERVAL_MS.
+//
+//   eval_adaptive_rate [trace.csv...]
+//
+// A trace is CSV with one reading per line: seconds,temperature C,humidity %.
+// Lines starting with # are skipped, readings are linearly interpolated.
+// Without arguments a synthetic 24 h trace is used, which only checks the
+// controller against known shapes, not against real weather.
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <random>
+#include <vector>
+
+#include "adaptive_rate.h"
+#include "test.h"
+
+// Same settings as main.cpp
+#define SAMPLE_MIN_INTERVAL_MS 2500
+#define SAMPLE_MAX_INTERVAL_MS 60000
+#define TEMPERATURE_THRESHOLD  0.5f
+#define HUMIDITY_THRESHOLD     2.0f
+
+static const float thresholds[] = {TEMPERATURE_THRESHOLD, HUMIDITY_THRESHOLD};
+
+struct reading {
+    double seconds;
+    float values[2];
+};
+
+struct result {
+    size_t fixed, adaptive, fast;
+    double mean_error[2], max_error[2];
+};
+
+static std::vector<reading> load(const char *path) {
+    std::vector<reading> trace;
+    FILE *file = fopen(path, "r");
+    if(file == nullptr) {
+        printf("%s: cannot open\n", path);
+        return trace;
+    }
+    char line[128];
+    while(fgets(line, sizeof(line), file)) {
+        reading r;
+        if(line[0] != '#' && sscanf(line, "%lf,%f,%f", &r.seconds, &r.values[0], &r.values[1]) == 3) {
+            trace.push_back(r);
+        }
+    }
+    fclose(file);
+    return trace;
+}
+
+// Night, sunrise ramp, a humidity front in the afternoon and sensor noise
+static std::vector<reading> synthetic() {
+    std::vector<reading> trace;
+    std::mt19937 rng(2024);
+    std::normal_distribution<float> temperature_noise(0.0f, 0.02f), humidity_noise(0.0f, 0.05f);
+    for(double t = 0; t < 24 * 3600; t += 1.0) {
+        double hour = t / 3600.0;
+        double temperature = 8.0 + 6.0 / (1.0 + exp(-(hour - 7.5) * 2.0)) + 2.0 * sin((hour - 9.0) / 24.0 * 2 * M_PI);
+        double humidity = 85.0 - 20.0 / (1.0 + exp(-(hour - 8.0) * 2.0));
+        if(hour > 15.0) {
+            // Front passage: sharp cooling and a humidity jump over ~10 minutes
+            double front = 1.0 / (1.0 + exp(-(hour - 15.5) * 40.0));
+            temperature -= 4.0 * front;
+            humidity += 25.0 * front;
+        }
+        trace.push_back({t, {(float)temperature + temperature_noise(rng), (float)humidity + humidity_noise(rng)}});
+    }
+    return trace;
+}
+
+static void at(const std::vector<reading> &trace, double seconds, size_t &cursor, float (&out)[2]) {
+    while(cursor + 1 < trace.size() && trace[cursor + 1].seconds <= seconds) {
+        cursor++;
+    }
+    const reading &a = trace[cursor];
+    const reading &b = trace[cursor + 1 < trace.size() ? cursor + 1 : cursor];
+    double span = b.seconds - a.seconds;
+    double f = span > 0 ? (seconds - a.seconds) / span : 0;
+    for(int i = 0; i < 2; i++) {
+        out[i] = a.values[i] + (b.values[i] - a.values[i]) * f;
+    }
+}
+
+static result evaluate(const std::vector<reading> &trace) {
+    result r{};
+    adaptive_rate rate(thresholds, SAMPLE_MIN_INTERVAL_MS, SAMPLE_MAX_INTERVAL_MS);
+    double start = trace.front().seconds, end = trace.back().seconds;
+    size_t reference_cursor = 0, sample_cursor = 0;
+    double next_sample = start;
+    float held[2] = {0, 0};
+    for(double t = start; t <= end; t += SAMPLE_MIN_INTERVAL_MS / 1000.0) {
+        float reference[2];
+        at(trace, t, reference_cursor, reference);
+        r.fixed++;
+        if(t >= next_sample) {
+            at(trace, t, sample_cursor, held);
+            uint32_t now_ms = (uint32_t)((t - start) * 1000);
+            next_sample = t + rate.update(held, now_ms) / 1000.0;
+            const adaptive_rate::decision &d = rate.log(rate.log_size() - 1);
+            if(d.why == adaptive_rate::reason::fast) {
+                r.fast++;
+            }
+            r.adaptive++;
+        }
+        for(int i = 0; i < 2; i++) {
+            double error = fabs(reference[i] - held[i]);
+            r.mean_error[i] += error;
+            r.max_error[i] = error > r.max_error[i] ? error : r.max_error[i];
+        }
+    }
+    for(int i = 0; i < 2; i++) {
+        r.mean_error[i] /= r.fixed;
+    }
+    return r;
+}
+
+static result report(const char *name, const std::vector<reading> &trace) {
+    result r = evaluate(trace);
+    printf("%s: %zu readings over %.1f h\n", name, trace.size(), (trace.back().seconds - trace.front().seconds) / 3600);
+    printf("    samples: %zu fixed, %zu adaptive (%.1f%% fewer), %zu speed ups\n",
+        r.fixed, r.adaptive, 100.0 * (r.fixed - r.adaptive) / r.fixed, r.fast);
+    printf("    held value error: temperature mean %.3f C max %.2f C, humidity mean %.3f %% max %.2f %%\n",
+        r.mean_error[0], r.max_error[0], r.mean_error[1], r.max_error[1]);
+    return r;
+}
+
+int main(int argc, char **argv) {
+    if(argc > 1) {
+        for(int i = 1; i < argc; i++) {
+            std::vector<reading> trace = load(argv[i]);
+            if(trace.size() < 2) {
+                printf("%s: no readings\n", argv[i]);
+                return 1;
+            }
+            report(argv[i], trace);
+        }
+        return 0;
+    }
+    result r = report("synthetic", synthetic());
+    // Guards against regressions in the controller, not accuracy claims
+    CHECK(r.adaptive * 5 < r.fixed);
+    CHECK(r.max_error[0] < 1.0);
+    CHECK(r.max_error[1] < 5.0);
+    return test_result("adaptive_rate evaluation");
+}
@@ -0,0 +1,119 @@
+#pragma once
+
+// The sensor half of main.cpp without the network: the same drivers on the
+// same buses, each measured on a fixed interval from a loop ticking every
+// I2C_SESSION_TICK_MS of virtual time. record_i2c_session runs it against
+// simulated sensors, replay_i2c_trace against the trace that produced.
+#include <stdint.h>
+#include <stdio.h>
+
+#include <vector>
+
+#include "aht20.h"
+#include "bmp280.h"
+#include "fake_time.h"
+
+#define I2C_SESSION_TICK_MS        10
+#define I2C_SESSION_HUMIDITY_MS    10000
+#define I2C_SESSION_PRESSURE_MS    60000
+#define INDOOR_I2C_SDA_PIN         6
+#define INDOOR_I2C_SCL_PIN         7
+
+struct i2c_session_reading {
+    char sensor;
+    uint64_t at_us;
+    float first, second;
+};
+
+struct i2c_session_result {
+    std::vector<i2c_session_reading> readings;
+    // Virtual time from starting a measurement until its result was seen
+    uint64_t latency_total_us, latency_max_us;
+    uint32_t measurements;
+};
+
+inline void i2c_session_latency(i2c_session_result &result, absolute_time_t started) {
+    uint64_t latency = absolute_time_diff_us(started, get_absolute_time());
+    result.latency_total_us += latency;
+    result.latency_max_us = latency > result.latency_max_us ? latency : result.latency_max_us;
+    result.measurements++;
+}
+
+inline i2c_session_result run_i2c_session(uint32_t duration_ms) {
+    i2c_session_result result = {};
+    aht20 outdoor_sensor(i2c_default, 100 * 1000, PICO_DEFAULT_I2C_SDA_PIN, PICO_DEFAULT_I2C_SCL_PIN);
+    aht20 indoor_sensor(&i2c1_inst, 100 * 1000, INDOOR_I2C_SDA_PIN, INDOOR_I2C_SCL_PIN);
+    bmp280 pressure_sensor(true, i2c_default, 100 * 1000, PICO_DEFAULT_I2C_SDA_PIN, PICO_DEFAULT_I2C_SCL_PIN);
+    pressure_sensor.init();
+    pressure_sensor.set_filtering(bmp280::filter::OFF);
+    pressure_sensor.set_mode(bmp280::mode::sleep);
+
+    absolute_time_t outdoor_due = get_absolute_time(), indoor_due = outdoor_due, pressure_due = outdoor_due;
+    absolute_time_t outdoor_started = nil_time, indoor_started = nil_time, pressure_started = nil_time;
+    absolute_time_t outdoor_seen = nil_time, indoor_seen = nil_time;
+    absolute_time_t end = delayed_by_ms(get_absolute_time(), duration_ms);
+    while(!time_reached(end)) {
+        absolute_time_t now = get_absolute_time();
+        if(time_reached(outdoor_due)) {
+            if(outdoor_sensor.measure() == aht20::status::ERR_OK) {
+                outdoor_started = now;
+            }
+            outdoor_due = delayed_by_ms(now, I2C_SESSION_HUMIDITY_MS);
+        }
+        if(time_reached(indoor_due)) {
+            if(indoor_sensor.measure() == aht20::status::ERR_OK) {
+                indoor_started = now;
+            }
+            indoor_due = delayed_by_ms(now, I2C_SESSION_HUMIDITY_MS);
+        }
+        if(time_reached(pressure_due)) {
+            if(pressure_sensor.measure() != bmp280::status::ERR_FAIL) {
+                pressure_started = now;
+            }
+            pressure_due = delayed_by_ms(now, I2C_SESSION_PRESSURE_MS);
+        }
+        if(outdoor_sensor.has_data() && outdoor_sensor.sampled_at() != outdoor_seen) {
+            outdoor_seen = outdoor_sensor.sampled_at();
+            i2c_session_latency(result, outdoor_started);
+            result.readings.push_back({'o', now, outdoor_sensor.temperature(), outdoor_sensor.humidity()});
+        }
+        if(indoor_sensor.has_data() && indoor_sensor.sampled_at() != indoor_seen) {
+            indoor_seen = indoor_sensor.sampled_at();
+            i2c_session_latency(result, indoor_started);
+            result.readings.push_back({'i', now, indoor_sensor.temperature(), indoor_sensor.humidity()});
+        }
+        if(pressure_sensor.has_data()) {
+            i2c_session_latency(result, pressure_started);
+            float temperature = pressure_sensor.temperature();
+            result.readings.push_back({'p', now, temperature, pressure_sensor.pressure()});
+        }
+        fake_advance_to(delayed_by_ms(now, I2C_SESSION_TICK_MS));
+    }
+    return result;
+}
+
+inline bool write_i2c_session_readings(const char *path, const i2c_session_result &result) {
+    FILE *file = fopen(path, "w");
+    if(file == nullptr) {
+        return false;
+    }
+    for(const i2c_session_reading &reading : result.readings) {
+        fprintf(file, "%c %llu %.4f %.4f\n", reading.sensor, (unsigned long long)reading.at_us, reading.first, reading.second);
+    }
+    return fclose(file) == 0;
+}
+
+inline bool read_i2c_session_readings(const char *path, std::vector<i2c_session_reading> &readings) {
+    FILE *file = fopen(path, "r");
+    if(file == nullptr) {
+        return false;
+    }
+    i2c_session_reading reading;
+    unsigned long long at_us;
+    while(fscanf(file, " %c %llu %f %f", &reading.sensor, &at_us, &reading.first, &reading.second) == 4) {
+        reading.at_us = at_us;
+        readings.push_back(reading);
+    }
+    fclose(file);
+    return true;
+}
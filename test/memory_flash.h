@@ -0,0 +1,83 @@
+#pragma once
+
+// A flash_device backed by RAM that behaves like NOR flash: erases set
+// whole sectors to 0xFF, programs can only clear bits. It can also lose
+// power part way through an operation to test that update state survives.
+#include <stdint.h>
+#include <stddef.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "flash_device.h"
+
+// Thrown by the operation during which power was lost
+struct power_loss {};
+
+class memory_flash : public flash_device {
+public:
+    explicit memory_flash(size_t size) : m_data(size, 0xFF) {}
+
+    size_t size() const override { return m_data.size(); }
+
+    bool erase(uint32_t offset, size_t length) override {
+        if(offset % FLASH_DEVICE_SECTOR_SIZE || length % FLASH_DEVICE_SECTOR_SIZE || offset + length > size()) {
+            return false;
+        }
+        // An interrupted erase leaves the sector half erased
+        size_t done = tick() ? length : length / 2;
+        std::fill(m_data.begin() + offset, m_data.begin() + offset + done, 0xFF);
+        if(done != length) {
+            throw power_loss();
+        }
+        return true;
+    }
+
+    bool program(uint32_t offset, std::span<const uint8_t> data) override {
+        if(offset % FLASH_DEVICE_PAGE_SIZE || data.size() % FLASH_DEVICE_PAGE_SIZE || offset + data.size() > size()) {
+            return false;
+        }
+        // An interrupted program leaves the page half written
+        size_t done = tick() ? data.size() : data.size() / 2;
+        for(size_t i = 0; i < done; i++) {
+            m_data[offset + i] &= data[i];
+        }
+        if(done != data.size()) {
+            throw power_loss();
+        }
+        return true;
+    }
+
+    std::span<const uint8_t> read(uint32_t offset, size_t length) const override {
+        if(offset + length > size()) {
+            return {};
+        }
+        return {m_data.data() + offset, length};
+    }
+
+    // Power fails during the operation after count more have completed
+    void fail_after(uint32_t count) { m_remaining = count; m_failing = true; }
+    void keep_power() { m_failing = false; }
+    // Erases and programs so far
+    uint32_t operations() const { return m_operations; }
+
+    std::vector<uint8_t> &data() { return m_data; }
+
+private:
+    std::vector<uint8_t> m_data;
+    uint32_t m_operations = 0, m_remaining = 0;
+    bool m_failing = false;
+
+    bool tick() {
+        m_operations++;
+        if(!m_failing) {
+            return true;
+        }
+        if(m_remaining == 0) {
+            m_failing = false;
+            return false;
+        }
+        m_remaining--;
+        return true;
+    }
+};
@@ -0,0 +1,66 @@
+#pragma once
+
+// Firmware images and flash set up shared by the update tests
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#include <vector>
+
+#include "crc32.h"
+#include "flash_device.h"
+#include "memory_flash.h"
+#include "ota_slots.h"
+
+#define OTA_TEST_FLASH_SIZE (1024 * 1024)
+
+// Deterministic filler with some repetition, like code
+inline std::vector<uint8_t> make_image(uint32_t seed, size_t size) {
+    std::vector<uint8_t> image(size);
+    uint32_t state = seed * 2654435761u + 1;
+    for(size_t i = 0; i < size; i++) {
+        state = state * 1103515245u + 12345u;
+        image[i] = (uint8_t)(state >> 16) & (i % 64 < 48 ? 0xFF : 0x0F);
+    }
+    return image;
+}
+
+// The same image with a few local edits and a different length, as a small
+// code change would give
+inline std::vector<uint8_t> edit_image(std::vector<uint8_t> image, uint32_t seed, size_t size) {
+    std::vector<uint8_t> tail = make_image(seed, size > image.size() ? size - image.size() : 0);
+    image.resize(size);
+    for(size_t i = 0; i < tail.size(); i++) {
+        image[size - tail.size() + i] = tail[i];
+    }
+    for(size_t i = 100; i < image.size(); i += 5000) {
+        image[i] ^= 0x5A;
+    }
+    return image;
+}
+
+inline uint32_t image_crc(const std::vector<uint8_t> &image) {
+    return crc32(image.data(), image.size());
+}
+
+// Writes image at offset the way a programmer would
+inline void install(flash_device &flash, uint32_t offset, const std::vector<uint8_t> &image) {
+    size_t sectors = (image.size() + FLASH_DEVICE_SECTOR_SIZE - 1) / FLASH_DEVICE_SECTOR_SIZE;
+    std::vector<uint8_t> padded(sectors * FLASH_DEVICE_SECTOR_SIZE, 0xFF);
+    memcpy(padded.data(), image.data(), image.size());
+    flash.erase(offset, padded.size());
+    flash.program(offset, padded);
+}
+
+inline bool holds(const flash_device &flash, uint32_t offset, const std::vector<uint8_t> &image) {
+    auto stored = flash.read(offset, image.size());
+    return stored.size() == image.size() && memcmp(stored.data(), image.data(), image.size()) == 0;
+}
+
+// What the loader does on every reset
+inline ota_state loader_boot(flash_device &flash) {
+    ota_slots slots(flash, ota_layout_for(flash.size()), 0);
+    while(slots.boot()) {
+    }
+    return slots.state();
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include "loop_packet.h"
+
+// A full packet as the node sends one
+inline packet_args sample_packet() {
+    packet_args args;
+    args.dateTime = 1760875200.125;
+    args.outTemp = 12.34f;
+    args.inTemp = 21.5f;
+    args.pressure = 1013.25f;
+    args.windSpeed = 7.2f;
+    args.windDir = 247.5f;
+    args.windGust = 15.8f;
+    args.windGustDir = 225.0f;
+    args.outHumidity = 81.3f;
+    args.inHumidity = 44.0f;
+    args.dewpoint = 9.2f;
+    args.rain = 0.02f;
+    args.txBatteryStatus = 1;
+    args.consBatteryVoltage = 3.91f;
+    args.supplyVoltage = 5.02f;
+    return args;
+}
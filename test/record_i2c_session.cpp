@@ -0,0 +1,152 @@
+// Records a trace of the sensor drivers talking to simulated AHT20 and
+// BMP280 parts, for replay_i2c_trace to play back. Built with I2C_TRACE.
+//   record_i2c_session <trace out> <readings out>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "crc8.h"
+#include "fake_i2c.h"
+#include "i2c_session.h"
+#include "i2c_trace.h"
+#include "test.h"
+
+#define SESSION_MS (10 * 60 * 1000)
+#define AHT20_MEASUREMENT_US  75000
+#define BMP280_MEASUREMENT_US 43000
+
+// Slow daily-ish swing, so consecutive readings differ
+static float wave(float mean, float amplitude, float period_s, float phase) {
+    return mean + amplitude * sinf(2.0f * (float)M_PI * (fake_time_us / 1e6f / period_s + phase));
+}
+
+class fake_aht20 : public fake_i2c_device {
+public:
+    explicit fake_aht20(float phase) : m_phase(phase) {}
+
+    int write(const uint8_t *src, size_t len, bool) override {
+        switch(src[0]) {
+        case 0xBE:
+            m_calibrated = true;
+            break;
+        case 0xAC:
+            m_ready_at = fake_time_us + AHT20_MEASUREMENT_US;
+            m_humidity = wave(55.0f, 20.0f, 900.0f, m_phase);
+            m_temperature = wave(18.0f, 6.0f, 1200.0f, m_phase);
+            break;
+        default:
+            break;
+        }
+        return (int)len;
+    }
+
+    int read(uint8_t *dst, size_t len, bool) override {
+        uint32_t humidity = (uint32_t)(m_humidity / 100.0f * (1 << 20));
+        uint32_t temperature = (uint32_t)((m_temperature + 50.0f) / 200.0f * (1 << 20));
+        uint8_t data[7] = {
+            (uint8_t)(0x10 | (m_calibrated ? 0x08 : 0) | (fake_time_us < m_ready_at ? 0x80 : 0)),
+            (uint8_t)(humidity >> 12),
+            (uint8_t)(humidity >> 4),
+            (uint8_t)(humidity << 4 | temperature >> 16),
+            (uint8_t)(temperature >> 8),
+            (uint8_t)temperature,
+            0
+        };
+        data[6] = crc8(data, 6);
+        memcpy(dst, data, len < sizeof(data) ? len : sizeof(data));
+        return (int)len;
+    }
+private:
+    float m_phase, m_humidity = 0, m_temperature = 0;
+    bool m_calibrated = false;
+    uint64_t m_ready_at = 0;
+};
+
+class fake_bmp280 : public fake_i2c_device {
+public:
+    fake_bmp280() {
+        // Trim values of the worked example in the datasheet
+        const uint16_t trim[12] = {27504, 26435, (uint16_t)-1000, 36477, (uint16_t)-10685, 3024,
+                                   2855, 140, (uint16_t)-7, 15500, (uint16_t)-14600, 6000};
+        for(int i = 0; i < 12; i++) {
+            m_registers[0x88 + 2 * i] = (uint8_t)trim[i];
+            m_registers[0x89 + 2 * i] = (uint8_t)(trim[i] >> 8);
+        }
+        m_registers[0xD0] = 0x58;
+    }
+
+    int write(const uint8_t *src, size_t len, bool) override {
+        if(len == 1) {
+            m_pointer = src[0];
+            return 1;
+        }
+        for(size_t i = 0; i + 1 < len; i += 2) {
+            m_registers[src[i]] = src[i + 1];
+            if(src[i] == 0xF4 && (src[i + 1] & 0x03) == 0x01) {
+                m_ready_at = fake_time_us + BMP280_MEASUREMENT_US;
+            }
+        }
+        return (int)len;
+    }
+
+    int read(uint8_t *dst, size_t len, bool) override {
+        convert();
+        m_registers[0xF3] = fake_time_us < m_ready_at ? 0x08 : 0;
+        for(size_t i = 0; i < len; i++) {
+            dst[i] = m_registers[(uint8_t)(m_pointer + i)];
+        }
+        return (int)len;
+    }
+private:
+    uint8_t m_registers[256] = {};
+    uint8_t m_pointer = 0;
+    uint64_t m_ready_at = 0;
+
+    // Completes a forced measurement once its time is up
+    void convert() {
+        if(m_ready_at == 0 || fake_time_us < m_ready_at) {
+            return;
+        }
+        m_ready_at = 0;
+        m_registers[0xF4] &= 0xFC;
+        store(0xF7, (uint32_t)wave(415148.0f, 3000.0f, 3600.0f, 0.0f));
+        store(0xFA, (uint32_t)wave(519888.0f, 8000.0f, 1200.0f, 0.0f));
+    }
+
+    void store(uint8_t reg, uint32_t raw) {
+        m_registers[reg] = (uint8_t)(raw >> 12);
+        m_registers[reg + 1] = (uint8_t)(raw >> 4);
+        m_registers[reg + 2] = (uint8_t)(raw << 4);
+    }
+};
+
+int main(int argc, char **argv) {
+    if(argc != 3) {
+        fprintf(stderr, "usage: %s <trace out> <readings out>\n", argv[0]);
+        return 2;
+    }
+    fake_aht20 outdoor(0.0f), indoor(0.3f);
+    fake_bmp280 pressure;
+    i2c0_inst.devices[0x38] = &outdoor;
+    i2c1_inst.devices[0x38] = &indoor;
+    i2c0_inst.devices[0x76] = &pressure;
+
+    fake_time_reset();
+    i2c_trace_start();
+    i2c_session_result result = run_i2c_session(SESSION_MS);
+    i2c_trace_stop();
+    i2c_trace_report();
+
+    std::span<const uint8_t> trace = i2c_trace_buffer();
+    CHECK_MSG(i2c_trace_overflows() == 0, "%u transactions did not fit", (unsigned)i2c_trace_overflows());
+    CHECK(result.readings.size() > 0);
+    FILE *file = fopen(argv[1], "wb");
+    CHECK(file != nullptr && fwrite(trace.data(), 1, trace.size(), file) == trace.size());
+    if(file != nullptr) {
+        fclose(file);
+    }
+    CHECK(write_i2c_session_readings(argv[2], result));
+    printf("recorded %zu bytes, %zu readings over %u s\n", trace.size(), result.readings.size(), SESSION_MS / 1000);
+    return test_result("record_i2c_session");
+}
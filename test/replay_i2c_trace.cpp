@@ -0,0 +1,72 @@
+// Replays a trace from record_i2c_session through the same drivers, built
+// with I2C_TRACE_REPLAY. Checks the drivers asked for exactly what was
+// recorded and produced the same readings, and reports what the replay
+// cost in CPU time and how long measurements took on the virtual clock.
+// Without the readings, e.g. for a trace taken from a node with
+// scripts/i2c_trace.py -o, only the transactions are checked.
+//   replay_i2c_trace <trace> [readings]
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+#include <vector>
+
+#include "i2c_session.h"
+#include "i2c_trace.h"
+#include "test.h"
+
+#define SESSION_MS (10 * 60 * 1000)
+
+static double cpu_us() {
+    timespec now;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &now);
+    return now.tv_sec * 1e6 + now.tv_nsec / 1e3;
+}
+
+int main(int argc, char **argv) {
+    if(argc != 2 && argc != 3) {
+        fprintf(stderr, "usage: %s <trace> [readings]\n", argv[0]);
+        return 2;
+    }
+    std::vector<uint8_t> trace;
+    FILE *file = fopen(argv[1], "rb");
+    if(file == nullptr) {
+        fprintf(stderr, "cannot open %s\n", argv[1]);
+        return 2;
+    }
+    uint8_t chunk[4096];
+    for(size_t read; (read = fread(chunk, 1, sizeof(chunk), file)) > 0;) {
+        trace.insert(trace.end(), chunk, chunk + read);
+    }
+    fclose(file);
+    std::vector<i2c_session_reading> recorded;
+    if(argc == 3) {
+        CHECK(read_i2c_session_readings(argv[2], recorded));
+    }
+
+    CHECK(i2c_trace_replay(trace));
+    fake_time_reset();
+    double start = cpu_us();
+    i2c_session_result result = run_i2c_session(SESSION_MS);
+    double cpu = cpu_us() - start;
+    i2c_replay_stats stats = i2c_trace_replay_stats();
+
+    CHECK(stats.transactions > 0);
+    CHECK_MSG(stats.mismatches == 0, "%u", (unsigned)stats.mismatches);
+    CHECK_MSG(stats.exhausted == 0, "%u", (unsigned)stats.exhausted);
+    CHECK_MSG(argc == 2 || result.readings.size() == recorded.size(), "%zu replayed, %zu recorded", result.readings.size(), recorded.size());
+    for(size_t i = 0; i < result.readings.size() && i < recorded.size(); i++) {
+        const i2c_session_reading &a = result.readings[i], &b = recorded[i];
+        CHECK_MSG(a.sensor == b.sensor && a.at_us == b.at_us && fabsf(a.first - b.first) < 1e-3f && fabsf(a.second - b.second) < 1e-3f,
+            "reading %zu: %c %.4f %.4f, recorded %c %.4f %.4f", i, a.sensor, a.first, a.second, b.sensor, b.first, b.second);
+    }
+
+    printf("transactions:    %u (%u mismatched, %u past the trace)\n", (unsigned)stats.transactions, (unsigned)stats.mismatches, (unsigned)stats.exhausted);
+    printf("bus time:        %llu us recorded\n", (unsigned long long)stats.recorded_us);
+    printf("cpu time:        %.0f us, %.2f us per transaction\n", cpu, stats.transactions ? cpu / stats.transactions : 0.0);
+    printf("measurements:    %u\n", (unsigned)result.measurements);
+    printf("latency:         mean %.1f ms, max %.1f ms\n",
+        result.measurements ? result.latency_total_us / 1e3 / result.measurements : 0.0, result.latency_max_us / 1e3);
+    return test_result("replay_i2c_trace");
+}
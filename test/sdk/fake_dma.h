@@ -0,0 +1,124 @@
+#pragma once
+
+// Host stand-in for the ADC, DMA and IRQ parts of the pico SDK that
+// adc_sampler uses. DMA channels are modelled just far enough to stream
+// samples into their write address, chain to the next channel and raise the
+// completion interrupt.
+#include <stdint.h>
+#include <stddef.h>
+
+#define NUM_DMA_CHANNELS 12
+#define DMA_IRQ_1        12
+#define DREQ_ADC         36
+#define PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY 0x80
+
+typedef void (*irq_handler_t)();
+
+enum dma_channel_transfer_size {
+    DMA_SIZE_8 = 0,
+    DMA_SIZE_16 = 1,
+    DMA_SIZE_32 = 2
+};
+
+typedef struct {
+    int chain_to;
+    unsigned dreq;
+} dma_channel_config;
+
+struct fake_dma_channel {
+    bool claimed, busy, irq_enabled, status;
+    int chain_to;
+    uint16_t *write;
+    uint32_t length, remaining;
+};
+
+struct fake_adc {
+    bool running;
+    uint8_t round_robin;
+    uint32_t fifo;
+};
+
+inline fake_dma_channel fake_dma[NUM_DMA_CHANNELS];
+inline fake_adc fake_adc_state;
+inline irq_handler_t fake_dma_irq_handler;
+inline bool fake_dma_irq_enabled;
+
+inline fake_adc *const adc_hw = &fake_adc_state;
+
+inline void adc_init() {}
+inline void adc_gpio_init(unsigned) {}
+inline void adc_set_temp_sensor_enabled(bool) {}
+inline void adc_select_input(unsigned) {}
+inline void adc_set_round_robin(unsigned mask) { fake_adc_state.round_robin = mask; }
+inline void adc_fifo_setup(bool, bool, uint16_t, bool, bool) {}
+inline void adc_set_clkdiv(float) {}
+inline void adc_run(bool run) { fake_adc_state.running = run; }
+inline void adc_fifo_drain() {}
+
+inline int dma_claim_unused_channel(bool) {
+    for(int i = 0; i < NUM_DMA_CHANNELS; i++) {
+        if(!fake_dma[i].claimed) {
+            fake_dma[i] = {};
+            fake_dma[i].claimed = true;
+            fake_dma[i].chain_to = i;
+            return i;
+        }
+    }
+    return -1;
+}
+inline void dma_channel_unclaim(unsigned channel) { fake_dma[channel].claimed = false; }
+inline dma_channel_config dma_channel_get_default_config(unsigned channel) { return {(int)channel, 0}; }
+inline void channel_config_set_transfer_data_size(dma_channel_config*, dma_channel_transfer_size) {}
+inline void channel_config_set_read_increment(dma_channel_config*, bool) {}
+inline void channel_config_set_write_increment(dma_channel_config*, bool) {}
+inline void channel_config_set_dreq(dma_channel_config *c, unsigned dreq) { c->dreq = dreq; }
+inline void channel_config_set_chain_to(dma_channel_config *c, unsigned channel) { c->chain_to = channel; }
+inline void dma_channel_configure(unsigned channel, const dma_channel_config *c, volatile void *write,
+        const volatile void*, uint32_t count, bool trigger) {
+    fake_dma[channel].chain_to = c->chain_to;
+    fake_dma[channel].write = (uint16_t*)write;
+    fake_dma[channel].length = count;
+    fake_dma[channel].remaining = count;
+    fake_dma[channel].busy = trigger;
+}
+inline void dma_channel_start(unsigned channel) { fake_dma[channel].busy = true; }
+inline void dma_channel_abort(unsigned channel) { fake_dma[channel].busy = false; }
+inline void dma_channel_set_write_addr(unsigned channel, volatile void *write, bool trigger) {
+    fake_dma[channel].write = (uint16_t*)write;
+    fake_dma[channel].busy = fake_dma[channel].busy || trigger;
+}
+inline void dma_irqn_set_channel_enabled(unsigned, unsigned channel, bool enabled) { fake_dma[channel].irq_enabled = enabled; }
+inline bool dma_irqn_get_channel_status(unsigned, unsigned channel) { return fake_dma[channel].status; }
+inline void dma_irqn_acknowledge_channel(unsigned, unsigned channel) { fake_dma[channel].status = false; }
+
+inline void irq_add_shared_handler(unsigned, irq_handler_t handler, uint8_t) { fake_dma_irq_handler = handler; }
+inline void irq_remove_handler(unsigned, irq_handler_t) { fake_dma_irq_handler = nullptr; }
+inline void irq_set_enabled(unsigned, bool enabled) { fake_dma_irq_enabled = enabled; }
+
+// Delivers one ADC conversion to whichever channel is running. Completing a
+// transfer reloads its count, triggers the chained channel and raises the
+// interrupt, as on the RP2040.
+inline void fake_adc_convert(uint16_t sample) {
+    if(!fake_adc_state.running) {
+        return;
+    }
+    for(int i = 0; i < NUM_DMA_CHANNELS; i++) {
+        fake_dma_channel &channel = fake_dma[i];
+        if(!channel.claimed || !channel.busy) {
+            continue;
+        }
+        *channel.write++ = sample;
+        if(--channel.remaining == 0) {
+            channel.busy = false;
+            channel.remaining = channel.length;
+            channel.status = channel.irq_enabled;
+            if(channel.chain_to != i) {
+                fake_dma[channel.chain_to].busy = true;
+            }
+            if(channel.status && fake_dma_irq_enabled && fake_dma_irq_handler) {
+                fake_dma_irq_handler();
+            }
+        }
+        return;
+    }
+}
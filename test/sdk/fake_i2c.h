@@ -0,0 +1,68 @@
+#pragma once
+
+// Host stand-in for the pico SDK I2C and GPIO calls the sensor drivers make.
+// Transactions go to the fake_i2c_device attached at the bus and address,
+// and take as long on the virtual clock as the bytes would on the wire.
+#include <stdint.h>
+#include <stddef.h>
+
+#include "fake_time.h"
+
+#define GPIO_FUNC_I2C  3
+#define GPIO_FUNC_NULL 0x1f
+#define NUM_BANK0_GPIOS 30
+
+#define PICO_DEFAULT_I2C         0
+#define PICO_DEFAULT_I2C_SDA_PIN 4
+#define PICO_DEFAULT_I2C_SCL_PIN 5
+
+class fake_i2c_device {
+public:
+    virtual ~fake_i2c_device() = default;
+    // Both return the byte count, or PICO_ERROR_GENERIC for a NAK
+    virtual int write(const uint8_t *src, size_t len, bool nostop) = 0;
+    virtual int read(uint8_t *dst, size_t len, bool nostop) = 0;
+};
+
+typedef struct {
+    uint8_t index;
+    uint32_t baud;
+    fake_i2c_device *devices[128];
+} i2c_inst_t;
+
+inline i2c_inst_t i2c0_inst = {0};
+inline i2c_inst_t i2c1_inst = {1};
+inline uint8_t fake_gpio_function[NUM_BANK0_GPIOS];
+
+#define i2c0 (&i2c0_inst)
+#define i2c1 (&i2c1_inst)
+#define i2c_default i2c0
+#define PICO_DEFAULT_I2C_INSTANCE i2c_default
+
+inline unsigned i2c_hw_index(i2c_inst_t *i2c) { return i2c->index; }
+inline unsigned i2c_init(i2c_inst_t *i2c, unsigned baud) {
+    i2c->baud = baud;
+    return baud;
+}
+
+// Start, address and one ack bit per byte plus stop, nine clocks each
+inline void fake_i2c_clock(i2c_inst_t *i2c, size_t len) {
+    uint32_t baud = i2c->baud ? i2c->baud : 100000;
+    busy_wait_us_32((uint32_t)((len + 1) * 9 * 1000000ull / baud));
+}
+
+inline int i2c_write_blocking(i2c_inst_t *i2c, uint8_t addr, const uint8_t *src, size_t len, bool nostop) {
+    fake_i2c_clock(i2c, len);
+    fake_i2c_device *device = addr < 128 ? i2c->devices[addr] : nullptr;
+    return device ? device->write(src, len, nostop) : PICO_ERROR_GENERIC;
+}
+
+inline int i2c_read_blocking(i2c_inst_t *i2c, uint8_t addr, uint8_t *dst, size_t len, bool nostop) {
+    fake_i2c_clock(i2c, len);
+    fake_i2c_device *device = addr < 128 ? i2c->devices[addr] : nullptr;
+    return device ? device->read(dst, len, nostop) : PICO_ERROR_GENERIC;
+}
+
+inline unsigned gpio_get_function(unsigned pin) { return fake_gpio_function[pin]; }
+inline void gpio_set_function(unsigned pin, unsigned function) { fake_gpio_function[pin] = function; }
+inline void gpio_pull_up(unsigned) {}
@@ -0,0 +1,373 @@
+#pragma once
+
+// Host stand-in for the lwIP raw API: pbufs, the TCP and UDP pcb calls the
+// http server and udp transport make, and DNS. Nothing goes on a wire; a
+// test plays the remote end with the fake_tcp_* and fake_udp_* calls,
+// which invoke the callbacks the code under test registered, the way lwIP
+// would from its input path. Pcbs are never really freed until
+// fake_lwip_reset(), so a test can still inspect one lwIP has let go of.
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+typedef uint8_t u8_t;
+typedef uint16_t u16_t;
+typedef uint32_t u32_t;
+typedef int8_t err_t;
+
+#define ERR_OK          0
+#define ERR_MEM        -1
+#define ERR_BUF        -2
+#define ERR_TIMEOUT    -3
+#define ERR_RTE        -4
+#define ERR_INPROGRESS -5
+#define ERR_VAL        -6
+#define ERR_WOULDBLOCK -7
+#define ERR_USE        -8
+#define ERR_ALREADY    -9
+#define ERR_ISCONN     -10
+#define ERR_CONN       -11
+#define ERR_IF         -12
+#define ERR_ABRT       -13
+#define ERR_RST        -14
+#define ERR_CLSD       -15
+#define ERR_ARG        -16
+
+// --- addresses and DNS ---
+
+#define IPADDR_TYPE_V4  0
+#define IPADDR_TYPE_ANY 46
+
+struct ip_addr_t {
+    uint32_t addr;
+    uint8_t type;
+};
+
+inline const ip_addr_t fake_ip_any = {0, IPADDR_TYPE_ANY};
+#define IP_ANY_TYPE (&fake_ip_any)
+
+inline const char *ipaddr_ntoa(const ip_addr_t *addr) {
+    static char text[16];
+    uint32_t a = addr->addr;
+    snprintf(text, sizeof(text), "%u.%u.%u.%u",
+        (unsigned)(a & 0xFF), (unsigned)(a >> 8 & 0xFF), (unsigned)(a >> 16 & 0xFF), (unsigned)(a >> 24));
+    return text;
+}
+
+typedef void (*dns_found_callback)(const char *name, const ip_addr_t *addr, void *arg);
+
+// What dns_gethostbyname answers: ERR_OK with fake_dns_addr straight
+// away, or ERR_INPROGRESS and the callback left to fake_dns_resolve()
+inline err_t fake_dns_result = ERR_OK;
+inline ip_addr_t fake_dns_addr = {0x0100007F, IPADDR_TYPE_V4};
+inline dns_found_callback fake_dns_pending = nullptr;
+inline void *fake_dns_pending_arg = nullptr;
+
+inline err_t dns_gethostbyname(const char *, ip_addr_t *addr, dns_found_callback found, void *arg) {
+    if(fake_dns_result == ERR_OK) {
+        *addr = fake_dns_addr;
+    } else if(fake_dns_result == ERR_INPROGRESS) {
+        fake_dns_pending = found;
+        fake_dns_pending_arg = arg;
+    }
+    return fake_dns_result;
+}
+
+// Completes a lookup left in progress, a null addr being a failure
+inline void fake_dns_resolve(const char *name, const ip_addr_t *addr) {
+    dns_found_callback found = fake_dns_pending;
+    fake_dns_pending = nullptr;
+    if(found != nullptr) {
+        found(name, addr, fake_dns_pending_arg);
+    }
+}
+
+// --- pbufs, always a single segment ---
+
+typedef enum { PBUF_TRANSPORT, PBUF_IP, PBUF_LINK, PBUF_RAW } pbuf_layer;
+typedef enum { PBUF_RAM, PBUF_ROM, PBUF_REF, PBUF_POOL } pbuf_type;
+
+struct pbuf {
+    pbuf *next;
+    void *payload;
+    u16_t tot_len;
+    u16_t len;
+};
+
+inline int fake_pbufs_live = 0;
+// Makes pbuf_alloc fail, as an exhausted pool would
+inline bool fake_pbuf_exhausted = false;
+
+inline pbuf *pbuf_alloc(pbuf_layer, u16_t length, pbuf_type) {
+    if(fake_pbuf_exhausted) {
+        return nullptr;
+    }
+    pbuf *p = (pbuf*)malloc(sizeof(pbuf) + length);
+    p->next = nullptr;
+    p->payload = p + 1;
+    p->tot_len = p->len = length;
+    fake_pbufs_live++;
+    return p;
+}
+
+inline u8_t pbuf_free(pbuf *p) {
+    if(p == nullptr) {
+        return 0;
+    }
+    fake_pbufs_live--;
+    free(p);
+    return 1;
+}
+
+inline u16_t pbuf_copy_partial(const pbuf *p, void *dst, u16_t len, u16_t offset) {
+    if(offset >= p->len) {
+        return 0;
+    }
+    u16_t copied = len < p->len - offset ? len : p->len - offset;
+    memcpy(dst, (const uint8_t*)p->payload + offset, copied);
+    return copied;
+}
+
+inline pbuf *fake_pbuf_of(const void *data, size_t length) {
+    pbuf *p = pbuf_alloc(PBUF_TRANSPORT, (u16_t)length, PBUF_RAM);
+    memcpy(p->payload, data, length);
+    return p;
+}
+
+// --- TCP ---
+
+#define TCP_WRITE_FLAG_COPY 0x01
+#define TCP_WRITE_FLAG_MORE 0x02
+#define TCP_SND_BUF         2920
+
+struct tcp_pcb;
+typedef err_t (*tcp_accept_fn)(void *arg, tcp_pcb *newpcb, err_t err);
+typedef err_t (*tcp_recv_fn)(void *arg, tcp_pcb *pcb, pbuf *p, err_t err);
+typedef err_t (*tcp_sent_fn)(void *arg, tcp_pcb *pcb, u16_t len);
+typedef void (*tcp_err_fn)(void *arg, err_t err);
+
+// A tcp_write, by reference unless the copy flag was given. Reading
+// through data after the fact shows whether the caller kept it intact.
+struct fake_tcp_segment {
+    const char *data;
+    size_t length;
+    std::string copy;
+};
+
+struct tcp_pcb {
+    void *callback_arg;
+    tcp_accept_fn accept;
+    tcp_recv_fn recv;
+    tcp_sent_fn sent;
+    tcp_err_fn errf;
+    u16_t snd_buf;
+    size_t recved, outputs;
+    bool listening, closed, aborted, freed;
+    std::vector<fake_tcp_segment> segments;
+};
+
+inline std::vector<tcp_pcb*> fake_tcp_pcbs;
+// Calls made on a pcb after lwIP freed it, each a crash on the device
+inline int fake_tcp_use_after_free = 0;
+// What tcp_close returns for a connection
+inline err_t fake_tcp_close_result = ERR_OK;
+
+inline tcp_pcb *tcp_new_ip_type(u8_t) {
+    tcp_pcb *pcb = new tcp_pcb{};
+    pcb->snd_buf = TCP_SND_BUF;
+    fake_tcp_pcbs.push_back(pcb);
+    return pcb;
+}
+
+inline err_t tcp_bind(tcp_pcb *, const ip_addr_t *, u16_t) { return ERR_OK; }
+
+inline tcp_pcb *tcp_listen_with_backlog(tcp_pcb *pcb, u8_t) {
+    pcb->listening = true;
+    return pcb;
+}
+
+inline tcp_pcb *fake_tcp_use(tcp_pcb *pcb) {
+    if(pcb->freed) {
+        fake_tcp_use_after_free++;
+    }
+    return pcb;
+}
+
+inline void tcp_arg(tcp_pcb *pcb, void *arg) { fake_tcp_use(pcb)->callback_arg = arg; }
+inline void tcp_accept(tcp_pcb *pcb, tcp_accept_fn accept) { fake_tcp_use(pcb)->accept = accept; }
+inline void tcp_recv(tcp_pcb *pcb, tcp_recv_fn recv) { fake_tcp_use(pcb)->recv = recv; }
+inline void tcp_sent(tcp_pcb *pcb, tcp_sent_fn sent) { fake_tcp_use(pcb)->sent = sent; }
+inline void tcp_err(tcp_pcb *pcb, tcp_err_fn errf) { fake_tcp_use(pcb)->errf = errf; }
+inline u16_t tcp_sndbuf(tcp_pcb *pcb) { return fake_tcp_use(pcb)->snd_buf; }
+inline void tcp_recved(tcp_pcb *pcb, u16_t len) { fake_tcp_use(pcb)->recved += len; }
+inline err_t tcp_output(tcp_pcb *pcb) {
+    fake_tcp_use(pcb)->outputs++;
+    return ERR_OK;
+}
+
+inline err_t tcp_write(tcp_pcb *pcb, const void *data, u16_t len, u8_t flags) {
+    if(fake_tcp_use(pcb)->closed || len > pcb->snd_buf) {
+        return pcb->closed ? ERR_CONN : ERR_MEM;
+    }
+    fake_tcp_segment segment{(const char*)data, len, {}};
+    if(flags & TCP_WRITE_FLAG_COPY) {
+        segment.copy.assign((const char*)data, len);
+    }
+    pcb->segments.push_back(std::move(segment));
+    pcb->snd_buf -= len;
+    return ERR_OK;
+}
+
+// A listener is freed straight away. A connection stays alive, callbacks
+// and all, until what was written has been acknowledged.
+inline err_t tcp_close(tcp_pcb *pcb) {
+    if(fake_tcp_use(pcb)->listening) {
+        pcb->closed = pcb->freed = true;
+        return ERR_OK;
+    }
+    if(fake_tcp_close_result != ERR_OK) {
+        return fake_tcp_close_result;
+    }
+    pcb->closed = true;
+    return ERR_OK;
+}
+
+// As in lwIP the error callback still hears about the abort
+inline void tcp_abort(tcp_pcb *pcb) {
+    fake_tcp_use(pcb);
+    pcb->aborted = pcb->freed = true;
+    if(pcb->errf != nullptr) {
+        pcb->errf(pcb->callback_arg, ERR_ABRT);
+    }
+}
+
+// What the remote end has been sent so far, read through the references
+inline std::string fake_tcp_written(const tcp_pcb *pcb) {
+    std::string text;
+    for(const fake_tcp_segment &segment : pcb->segments) {
+        text.append(segment.copy.empty() ? std::string(segment.data, segment.length) : segment.copy);
+    }
+    return text;
+}
+
+// A client connects to listener, which hands the new pcb its own arg
+inline tcp_pcb *fake_tcp_connect(tcp_pcb *listener) {
+    tcp_pcb *pcb = tcp_new_ip_type(IPADDR_TYPE_ANY);
+    pcb->callback_arg = listener->callback_arg;
+    err_t err = listener->accept(listener->callback_arg, pcb, ERR_OK);
+    if(err != ERR_OK && !pcb->aborted) {
+        pcb->freed = true;
+    }
+    return pcb;
+}
+
+inline err_t fake_tcp_receive(tcp_pcb *pcb, std::string_view data) {
+    pbuf *p = fake_pbuf_of(data.data(), data.size());
+    if(pcb->recv == nullptr) {
+        pbuf_free(p);
+        return ERR_OK;
+    }
+    return pcb->recv(pcb->callback_arg, pcb, p, ERR_OK);
+}
+
+// The remote end sends its FIN
+inline err_t fake_tcp_remote_close(tcp_pcb *pcb) {
+    if(pcb->recv == nullptr) {
+        return ERR_OK;
+    }
+    return pcb->recv(pcb->callback_arg, pcb, nullptr, ERR_OK);
+}
+
+// The remote end acknowledges len more bytes
+inline err_t fake_tcp_ack(tcp_pcb *pcb, u16_t len) {
+    pcb->snd_buf += len;
+    if(pcb->sent == nullptr) {
+        return ERR_OK;
+    }
+    return pcb->sent(pcb->callback_arg, pcb, len);
+}
+
+// The remote end resets the connection, lwIP frees the pcb and reports it
+inline void fake_tcp_reset(tcp_pcb *pcb) {
+    pcb->freed = true;
+    if(pcb->errf != nullptr) {
+        pcb->errf(pcb->callback_arg, ERR_RST);
+    }
+}
+
+// --- UDP ---
+
+struct udp_pcb;
+typedef void (*udp_recv_fn)(void *arg, udp_pcb *pcb, pbuf *p, const ip_addr_t *addr, u16_t port);
+
+struct udp_pcb {
+    udp_recv_fn recv;
+    void *recv_arg;
+    // Every datagram udp_sendto accepted, with where it went
+    std::vector<std::vector<uint8_t>> sent;
+    ip_addr_t addr;
+    u16_t port;
+    bool removed;
+};
+
+inline std::vector<udp_pcb*> fake_udp_pcbs;
+// What udp_sendto returns, anything but ERR_OK and the datagram is lost
+inline err_t fake_udp_send_result = ERR_OK;
+
+inline udp_pcb *udp_new_ip_type(u8_t) {
+    udp_pcb *pcb = new udp_pcb{};
+    fake_udp_pcbs.push_back(pcb);
+    return pcb;
+}
+
+inline void udp_remove(udp_pcb *pcb) { pcb->removed = true; }
+
+inline void udp_recv(udp_pcb *pcb, udp_recv_fn recv, void *arg) {
+    pcb->recv = recv;
+    pcb->recv_arg = arg;
+}
+
+inline err_t udp_sendto(udp_pcb *pcb, pbuf *p, const ip_addr_t *addr, u16_t port) {
+    if(fake_udp_send_result != ERR_OK) {
+        return fake_udp_send_result;
+    }
+    const uint8_t *payload = (const uint8_t*)p->payload;
+    pcb->sent.emplace_back(payload, payload + p->len);
+    pcb->addr = *addr;
+    pcb->port = port;
+    return ERR_OK;
+}
+
+// A datagram arrives for pcb, which takes ownership of the pbuf
+inline void fake_udp_receive(udp_pcb *pcb, const void *data, size_t length) {
+    pbuf *p = fake_pbuf_of(data, length);
+    if(pcb->recv == nullptr) {
+        pbuf_free(p);
+        return;
+    }
+    pcb->recv(pcb->recv_arg, pcb, p, &fake_dns_addr, 7000);
+}
+
+// Frees every pcb and puts the knobs back to their defaults
+inline void fake_lwip_reset() {
+    for(tcp_pcb *pcb : fake_tcp_pcbs) {
+        delete pcb;
+    }
+    fake_tcp_pcbs.clear();
+    fake_tcp_use_after_free = 0;
+    for(udp_pcb *pcb : fake_udp_pcbs) {
+        delete pcb;
+    }
+    fake_udp_pcbs.clear();
+    fake_tcp_close_result = ERR_OK;
+    fake_udp_send_result = ERR_OK;
+    fake_pbuf_exhausted = false;
+    fake_dns_result = ERR_OK;
+    fake_dns_pending = nullptr;
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+// Host stand-in for the pico SDK timer and alarm pool. Time is virtual: it
+// only moves when a test advances it or something busy waits, so a session
+// runs in a fraction of its simulated length and always the same way.
+#include <stdint.h>
+
+#include <algorithm>
+#include <vector>
+
+#define PICO_ERROR_NONE    0
+#define PICO_ERROR_GENERIC -1
+
+typedef uint64_t absolute_time_t;
+typedef int32_t alarm_id_t;
+typedef int64_t (*alarm_callback_t)(alarm_id_t, void*);
+
+struct fake_alarm {
+    alarm_id_t id;
+    uint64_t at;
+    alarm_callback_t callback;
+    void *user_data;
+};
+
+inline uint64_t fake_time_us = 0;
+inline alarm_id_t fake_next_alarm = 1;
+inline std::vector<fake_alarm> fake_alarms;
+
+static const absolute_time_t nil_time = 0;
+
+inline uint64_t time_us_64() { return fake_time_us; }
+inline uint32_t time_us_32() { return (uint32_t)fake_time_us; }
+inline absolute_time_t get_absolute_time() { return fake_time_us; }
+inline uint64_t to_us_since_boot(absolute_time_t t) { return t; }
+inline uint32_t to_ms_since_boot(absolute_time_t t) { return (uint32_t)(t / 1000); }
+inline void update_us_since_boot(absolute_time_t *t, uint64_t us) { *t = us; }
+inline absolute_time_t delayed_by_us(absolute_time_t t, uint64_t us) { return t + us; }
+inline absolute_time_t delayed_by_ms(absolute_time_t t, uint32_t ms) { return t + 1000ull * ms; }
+inline absolute_time_t make_timeout_time_us(uint64_t us) { return fake_time_us + us; }
+inline absolute_time_t make_timeout_time_ms(uint32_t ms) { return fake_time_us + 1000ull * ms; }
+inline int64_t absolute_time_diff_us(absolute_time_t from, absolute_time_t to) { return (int64_t)(to - from); }
+inline bool time_reached(absolute_time_t t) { return fake_time_us >= t; }
+inline bool is_nil_time(absolute_time_t t) { return t == nil_time; }
+
+inline void busy_wait_us_32(uint32_t us) { fake_time_us += us; }
+inline void busy_wait_us(uint64_t us) { fake_time_us += us; }
+inline void sleep_us(uint64_t us) { fake_time_us += us; }
+inline void sleep_ms(uint32_t ms) { fake_time_us += 1000ull * ms; }
+
+inline alarm_id_t add_alarm_at(absolute_time_t t, alarm_callback_t callback, void *user_data, bool fire_if_past) {
+    if(t <= fake_time_us && !fire_if_past) {
+        return 0;
+    }
+    alarm_id_t id = fake_next_alarm++;
+    fake_alarms.push_back({id, t, callback, user_data});
+    return id;
+}
+
+inline alarm_id_t add_alarm_in_us(uint64_t us, alarm_callback_t callback, void *user_data, bool fire_if_past) {
+    return add_alarm_at(fake_time_us + us, callback, user_data, fire_if_past);
+}
+
+inline alarm_id_t add_alarm_in_ms(uint32_t ms, alarm_callback_t callback, void *user_data, bool fire_if_past) {
+    return add_alarm_at(fake_time_us + 1000ull * ms, callback, user_data, fire_if_past);
+}
+
+inline bool cancel_alarm(alarm_id_t id) {
+    auto found = std::find_if(fake_alarms.begin(), fake_alarms.end(), [id](const fake_alarm &alarm) { return alarm.id == id; });
+    if(found == fake_alarms.end()) {
+        return false;
+    }
+    fake_alarms.erase(found);
+    return true;
+}
+
+// Moves the clock to t, firing the alarms that fall due on the way in time
+// order. Rescheduling follows the SDK: a negative return is relative to
+// when the alarm was due, a positive one to when the callback returned.
+inline void fake_advance_to(uint64_t t) {
+    while(true) {
+        auto due = std::min_element(fake_alarms.begin(), fake_alarms.end(),
+            [](const fake_alarm &a, const fake_alarm &b) { return a.at < b.at; });
+        if(due == fake_alarms.end() || due->at > t) {
+            break;
+        }
+        fake_alarm alarm = *due;
+        fake_alarms.erase(due);
+        fake_time_us = std::max(fake_time_us, alarm.at);
+        int64_t next = alarm.callback(alarm.id, alarm.user_data);
+        if(next < 0) {
+            alarm.at -= next;
+            fake_alarms.push_back(alarm);
+        } else if(next > 0) {
+            alarm.at = fake_time_us + next;
+            fake_alarms.push_back(alarm);
+        }
+    }
+    fake_time_us = std::max(fake_time_us, t);
+}
+
+// Back to boot, with no alarms pending
+inline void fake_time_reset() {
+    fake_time_us = 0;
+    fake_next_alarm = 1;
+    fake_alarms.clear();
+}
@@ -0,0 +1,3 @@
+#pragma once
+
+#include "fake_i2c.h"
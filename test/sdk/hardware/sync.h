@@ -0,0 +1,7 @@
+#pragma once
+
+// Host code runs without interrupts, so there is nothing to mask
+#include <stdint.h>
+
+inline uint32_t save_and_disable_interrupts() { return 0; }
+inline void restore_interrupts(uint32_t) {}
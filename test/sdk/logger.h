@@ -0,0 +1,18 @@
+#pragma once
+
+// Host stand-in for pico-web-client's logger: warnings and errors go to
+// stderr, everything below is compiled out.
+#include <stdio.h>
+
+#define trace(...)       ((void)0)
+#define trace1(...)      ((void)0)
+#define trace_cont(...)  ((void)0)
+#define trace_cont1(...) ((void)0)
+#define debug(...)       ((void)0)
+#define debug1(...)      ((void)0)
+#define info(...)        ((void)0)
+#define info1(...)       ((void)0)
+#define warn(...)        fprintf(stderr, __VA_ARGS__)
+#define warn1(...)       fprintf(stderr, __VA_ARGS__)
+#define error(...)       fprintf(stderr, __VA_ARGS__)
+#define error1(...)      fprintf(stderr, __VA_ARGS__)
@@ -0,0 +1,8 @@
+#pragma once
+
+// Host stand-in for the SDK's random numbers, a test picks the value
+#include <stdint.h>
+
+inline uint32_t fake_rand_32 = 0;
+
+inline uint32_t get_rand_32() { return fake_rand_32; }
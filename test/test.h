@@ -0,0 +1,26 @@
+#pragma once
+
+#include <stdio.h>
+
+// Minimal assertion helpers, each test is its own executable and returns
+// the number of failed checks.
+inline int test_failures = 0;
+
+#define CHECK(cond) do { \
+    if(!(cond)) { \
+        printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+        test_failures++; \
+    } \
+} while(0)
+
+#define CHECK_MSG(cond, fmt, ...) do { \
+    if(!(cond)) { \
+        printf("%s:%d: check failed: %s: " fmt "\n", __FILE__, __LINE__, #cond, __VA_ARGS__); \
+        test_failures++; \
+    } \
+} while(0)
+
+inline int test_result(const char *name) {
+    printf("%s: %s (%d failed checks)\n", name, test_failures ? "FAILED" : "passed", test_failures);
+    return test_failures ? 1 : 0;
+}
@@ -0,0 +1,51 @@
+#include <math.h>
+#include <stdint.h>
+
+#include "adc_filter.h"
+#include "test.h"
+
+static void test_mean() {
+    const uint16_t samples[] = {100, 200, 300, 400};
+    CHECK(adc_mean(samples) == 250.0f);
+    CHECK(adc_mean({samples, 0}) == 0.0f);
+    CHECK(adc_mean({samples, 1}) == 100.0f);
+}
+
+static void test_interleaved() {
+    // Three channels sampled round robin, as adc_sampler lays them out
+    uint16_t samples[3 * 128];
+    for(size_t i = 0; i < 128; i++) {
+        samples[3 * i] = 1000 + (i % 2);
+        samples[3 * i + 1] = 2000;
+        samples[3 * i + 2] = 4095;
+    }
+    CHECK(adc_mean(samples, 0, 3) == 1000.5f);
+    CHECK(adc_mean(samples, 1, 3) == 2000.0f);
+    CHECK(adc_mean(samples, 2, 3) == 4095.0f);
+    // Offset past the end of a short buffer
+    CHECK(adc_mean({samples, 2}, 2, 3) == 0.0f);
+}
+
+static void test_full_scale_sum() {
+    // 640 full scale samples must not overflow the accumulator
+    uint16_t samples[640];
+    for(uint16_t &sample : samples) {
+        sample = ADC_MAX_COUNTS;
+    }
+    CHECK(adc_mean(samples) == (float)ADC_MAX_COUNTS);
+}
+
+static void test_volts() {
+    CHECK(fabsf(adc_to_volts(ADC_MAX_COUNTS) - ADC_REFERENCE_VOLTS) < 1e-5f);
+    CHECK(adc_to_volts(0) == 0.0f);
+    // VSYS through the Pico's 3:1 divider
+    CHECK(fabsf(adc_to_volts(ADC_MAX_COUNTS / 2.0f, 3.0f) - 4.95f) < 1e-3f);
+}
+
+int main() {
+    test_mean();
+    test_interleaved();
+    test_full_scale_sum();
+    test_volts();
+    return test_result("adc_filter");
+}
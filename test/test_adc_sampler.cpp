@@ -0,0 +1,81 @@
+// Drives adc_sampler against the fake ADC/DMA in sdk/fake_dma.h to check
+// the ping-pong buffering and the overwrite detection in with_latest().
+#include <stdint.h>
+
+#include "adc_sampler.h"
+#include "fake_dma.h"
+#include "test.h"
+
+// Every sample encodes its channel and the pass it was taken in
+static uint16_t next_sample = 0;
+
+static void convert(size_t count) {
+    for(size_t i = 0; i < count; i++) {
+        fake_adc_convert(next_sample++);
+    }
+}
+
+static void test_no_buffer_yet() {
+    adc_sampler sampler(0b00111);
+    CHECK(sampler.valid());
+    CHECK(sampler.channels() == 3);
+    bool called = false;
+    CHECK(!sampler.with_latest([&](std::span<const uint16_t>) { called = true; }));
+    CHECK(!called);
+    convert(3 * ADC_SAMPLER_SAMPLES_PER_CHANNEL - 1);
+    CHECK(!sampler.with_latest([](std::span<const uint16_t>) {}));
+}
+
+static void test_latest_buffer() {
+    adc_sampler sampler(0b00111);
+    const size_t length = 3 * ADC_SAMPLER_SAMPLES_PER_CHANNEL;
+    for(int pass = 0; pass < 5; pass++) {
+        uint16_t first = next_sample;
+        convert(length);
+        std::span<const uint16_t> seen;
+        CHECK(sampler.with_latest([&](std::span<const uint16_t> samples) { seen = samples; }));
+        CHECK(seen.size() == length);
+        // Always the whole of the buffer just completed, in order
+        CHECK_MSG(seen.front() == first && seen.back() == (uint16_t)(first + length - 1), "pass %d", pass);
+    }
+}
+
+static void test_partial_fill_keeps_last() {
+    adc_sampler sampler(0b00011);
+    const size_t length = 2 * ADC_SAMPLER_SAMPLES_PER_CHANNEL;
+    convert(length);
+    uint16_t first = next_sample - length;
+    // The other buffer is being filled, the completed one is untouched
+    convert(length / 2);
+    CHECK(sampler.with_latest([&](std::span<const uint16_t> samples) {
+        CHECK(samples.front() == first);
+        CHECK(samples.back() == (uint16_t)(first + length - 1));
+    }));
+}
+
+static void test_overwrite_detected() {
+    adc_sampler sampler(0b00011);
+    const size_t length = 2 * ADC_SAMPLER_SAMPLES_PER_CHANNEL;
+    convert(length);
+    // A slow reader: the DMA completes another buffer while it runs
+    CHECK(!sampler.with_latest([&](std::span<const uint16_t>) { convert(length); }));
+    CHECK(sampler.with_latest([](std::span<const uint16_t>) {}));
+}
+
+static void test_single_instance() {
+    adc_sampler first(0b00001);
+    adc_sampler second(0b00001);
+    CHECK(first.valid());
+    CHECK(!second.valid());
+    adc_sampler none(0);
+    CHECK(!none.valid());
+}
+
+int main() {
+    test_no_buffer_yet();
+    test_latest_buffer();
+    test_partial_fill_keeps_last();
+    test_overwrite_detected();
+    test_single_instance();
+    return test_result("adc_sampler");
+}
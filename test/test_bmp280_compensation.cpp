@@ -0,0 +1,125 @@
+// Compares the 32 bit compensation in bmp280_compensation.cpp against the
+// bosch reference implementations from the bmp280 datasheet (section 8.2):
+// the 64 bit integer pressure path and the double precision variants.
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "bmp280_compensation.h"
+#include "test.h"
+
+#define RAW_MAX    (1 << 20)
+#define RAW_STEP   97
+// Operating range of the sensor from the datasheet
+#define T_MIN      -4000
+#define T_MAX      8500
+#define P_MIN      30000
+#define P_MAX      110000
+// The 32 bit path truncates its intermediates, the deviation must stay well
+// inside the sensor's relative accuracy of +-12 Pa
+#define P_TOLERANCE 8
+
+static int64_t reference_pressure_q24_8(const bmp280_calibration &c, int32_t adc_P, int32_t t_fine) {
+    int64_t var1, var2, p;
+    var1 = ((int64_t)t_fine) - 128000;
+    var2 = var1 * var1 * (int64_t)c.P6;
+    var2 = var2 + ((var1 * (int64_t)c.P5) << 17);
+    var2 = var2 + (((int64_t)c.P4) << 35);
+    var1 = ((var1 * var1 * (int64_t)c.P3) >> 8) + ((var1 * (int64_t)c.P2) << 12);
+    var1 = (((((int64_t)1) << 47) + var1)) * ((int64_t)c.P1) >> 33;
+    if(var1 == 0) {
+        return 0;
+    }
+    p = 1048576 - adc_P;
+    p = (((p << 31) - var2) * 3125) / var1;
+    var1 = (((int64_t)c.P9) * (p >> 13) * (p >> 13)) >> 25;
+    var2 = (((int64_t)c.P8) * p) >> 19;
+    p = ((p + var1 + var2) >> 8) + (((int64_t)c.P7) << 4);
+    return p;
+}
+
+static double reference_temperature_double(const bmp280_calibration &c, int32_t adc_T) {
+    double var1 = (((double)adc_T) / 16384.0 - ((double)c.T1) / 1024.0) * ((double)c.T2);
+    double var2 = ((((double)adc_T) / 131072.0 - ((double)c.T1) / 8192.0) *
+        (((double)adc_T) / 131072.0 - ((double)c.T1) / 8192.0)) * ((double)c.T3);
+    return (var1 + var2) / 5120.0;
+}
+
+static bmp280_calibration calibrations[] = {
+    // Worked example from the datasheet
+    {27504, 26435, -1000, 36477, -10685, 3024, 2855, 140, -7, 15500, -14600, 6000},
+    // Variations on the example exercising other T1, P1, P4 and P5 values
+    {28009, 25654, 50, 39145, -10750, 3024, 5667, -120, -7, 15500, -14600, 6000},
+    {27852, 26490, 50, 36736, -10565, 3024, 7329, -60, -7, 15500, -14600, 6000},
+    {27196, 26711, 50, 37865, -10519, 3024, 2973, 148, -7, 15500, -14600, 6000},
+};
+
+static void test_decode() {
+    const uint8_t data[BMP280_CALIB_LEN] = {
+        0x70, 0x6B, 0x43, 0x67, 0x18, 0xFC, 0x7D, 0x8E, 0x43, 0xD6, 0xD0, 0x0B,
+        0x27, 0x0B, 0x8C, 0x00, 0xF9, 0xFF, 0x8C, 0x3C, 0xF8, 0xC6, 0x70, 0x17,
+    };
+    bmp280_calibration c = bmp280_decode_calibration(data);
+    CHECK(c.T1 == 27504);
+    CHECK(c.T2 == 26435);
+    CHECK(c.T3 == -1000);
+    CHECK(c.P1 == 36477);
+    CHECK(c.P2 == -10685);
+    CHECK(c.P3 == 3024);
+    CHECK(c.P4 == 2855);
+    CHECK(c.P5 == 140);
+    CHECK(c.P6 == -7);
+    CHECK(c.P7 == 15500);
+    CHECK(c.P8 == -14600);
+    CHECK(c.P9 == 6000);
+}
+
+static void test_datasheet_example() {
+    int32_t t_fine;
+    int32_t temperature = bmp280_compensate_temperature(calibrations[0], 519888, t_fine);
+    CHECK(t_fine == 128422);
+    CHECK(temperature == 2508);
+    uint32_t pressure = bmp280_compensate_pressure(calibrations[0], 415148, t_fine);
+    CHECK(abs((int32_t)pressure - 100653) <= P_TOLERANCE);
+}
+
+static void test_full_range(const bmp280_calibration &c) {
+    int64_t compared = 0, worst = 0;
+    double worst_temperature = 0;
+    for(int32_t adc_T = 0; adc_T < RAW_MAX; adc_T += RAW_STEP) {
+        int32_t t_fine;
+        int32_t temperature = bmp280_compensate_temperature(c, adc_T, t_fine);
+        if(temperature < T_MIN || temperature > T_MAX) {
+            continue;
+        }
+        double error = fabs(temperature / 100.0 - reference_temperature_double(c, adc_T));
+        if(error > worst_temperature) {
+            worst_temperature = error;
+        }
+        for(int32_t adc_P = 0; adc_P < RAW_MAX; adc_P += RAW_STEP) {
+            int64_t reference = reference_pressure_q24_8(c, adc_P, t_fine) / 256;
+            if(reference < P_MIN || reference > P_MAX) {
+                continue;
+            }
+            int64_t error = llabs((int64_t)bmp280_compensate_pressure(c, adc_P, t_fine) - reference);
+            if(error > worst) {
+                worst = error;
+            }
+            compared++;
+        }
+    }
+    printf("T1=%u P1=%u: %lld points, worst pressure error %lld Pa, worst temperature error %.4f C\n",
+        c.T1, c.P1, (long long)compared, (long long)worst, worst_temperature);
+    CHECK(compared > 0);
+    CHECK(worst <= P_TOLERANCE);
+    CHECK(worst_temperature <= 0.01);
+}
+
+int main() {
+    test_decode();
+    test_datasheet_example();
+    for(const auto &c : calibrations) {
+        test_full_range(c);
+    }
+    return test_result("bmp280_compensation");
+}
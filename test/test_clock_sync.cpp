@@ -0,0 +1,113 @@
+// Runs clock_sync against a simulated oscillator: the virtual clock in
+// sdk/fake_time.h is the node's monotonic time, and UTC is derived from it
+// with a known drift, so the estimate and the extrapolation between syncs
+// can be checked against the truth.
+#include <stdint.h>
+
+#include "clock_sync.h"
+#include "fake_time.h"
+#include "test.h"
+
+#define EPOCH_US 1760875200000000ll
+
+// UTC when the local clock reads local_us, for a local oscillator running
+// fast by drift_ppb. The node should end up estimating -drift_ppb.
+static int64_t true_utc_us(uint64_t local_us, int64_t drift_ppb) {
+    return EPOCH_US + (int64_t)local_us - (int64_t)local_us * drift_ppb / (1000000000ll + drift_ppb);
+}
+
+static int64_t abs64(int64_t value) {
+    return value < 0 ? -value : value;
+}
+
+static void test_unsynced() {
+    clock_sync clock;
+    CHECK(!clock.synced());
+    CHECK(clock.drift_ppb() == 0);
+    clock.update(5000000, EPOCH_US);
+    CHECK(clock.synced());
+    CHECK(clock.to_utc_us(5000000) == EPOCH_US);
+    CHECK(clock.to_utc_us(6000000) == EPOCH_US + 1000000);
+    // Earlier local times map back before the sync
+    CHECK(clock.to_utc_us(4000000) == EPOCH_US - 1000000);
+    clock.reset();
+    CHECK(!clock.synced());
+}
+
+static void test_drift(int64_t drift_ppb) {
+    fake_time_reset();
+    clock_sync clock;
+    const uint64_t interval_us = 15ull * 60 * 1000000;
+    for(int sync = 0; sync < 12; sync++) {
+        fake_advance_to(fake_time_us + interval_us);
+        clock.update(time_us_64(), true_utc_us(time_us_64(), drift_ppb));
+    }
+    CHECK_MSG(abs64(clock.drift_ppb() + drift_ppb) < abs64(drift_ppb) / 100 + 50,
+        "%lld ppb estimated as %ld", (long long)drift_ppb, (long)clock.drift_ppb());
+
+    // An hour without a sync, the extrapolation keeps within a millisecond
+    // where the uncorrected drift would be 3.6 ms per ppm
+    fake_advance_to(fake_time_us + 3600ull * 1000000);
+    int64_t error_us = clock.to_utc_us(time_us_64()) - true_utc_us(time_us_64(), drift_ppb);
+    CHECK_MSG(abs64(error_us) < 1000, "%lld ppb: %lld us off after an hour", (long long)drift_ppb, (long long)error_us);
+}
+
+static void test_step() {
+    fake_time_reset();
+    clock_sync clock;
+    const int64_t drift_ppb = 30000;
+    for(int sync = 0; sync < 4; sync++) {
+        fake_advance_to(fake_time_us + 600000000);
+        clock.update(time_us_64(), true_utc_us(time_us_64(), drift_ppb));
+    }
+    int32_t drift = clock.drift_ppb();
+    // UTC jumps by 10 s, far beyond what any oscillator could drift in
+    // the span: the mapping steps to it but the drift estimate is kept
+    fake_advance_to(fake_time_us + 600000000);
+    int64_t stepped = true_utc_us(time_us_64(), drift_ppb) + 10000000;
+    clock.update(time_us_64(), stepped);
+    CHECK(clock.drift_ppb() == drift);
+    CHECK(clock.to_utc_us(time_us_64()) == stepped);
+    // And backwards
+    fake_advance_to(fake_time_us + 600000000);
+    clock.update(time_us_64(), true_utc_us(time_us_64(), drift_ppb) - 5000000);
+    CHECK(clock.drift_ppb() == drift);
+}
+
+static void test_short_span() {
+    fake_time_reset();
+    clock_sync clock;
+    clock.update(time_us_64(), EPOCH_US);
+    // Too close to the last sync to tell drift from network jitter, even
+    // though the error would read as an enormous rate
+    fake_advance_to(CLOCK_SYNC_MIN_SPAN_US - 1);
+    clock.update(time_us_64(), EPOCH_US + CLOCK_SYNC_MIN_SPAN_US - 1 + 20000);
+    CHECK(clock.drift_ppb() == 0);
+    CHECK(clock.to_utc_us(time_us_64()) == EPOCH_US + CLOCK_SYNC_MIN_SPAN_US - 1 + 20000);
+    // A local clock that went backwards is a re-anchor, not a rate
+    clock.update(time_us_64() - 1000000, EPOCH_US);
+    CHECK(clock.drift_ppb() == 0);
+}
+
+static void test_clamp() {
+    fake_time_reset();
+    clock_sync clock;
+    // 800 ppm is inside the step threshold but beyond the clamp
+    for(int sync = 0; sync < 3; sync++) {
+        fake_advance_to(fake_time_us + 600000000);
+        clock.update(time_us_64(), true_utc_us(time_us_64(), 800000));
+    }
+    CHECK(clock.drift_ppb() == -CLOCK_SYNC_MAX_DRIFT_PPB);
+}
+
+int main() {
+    test_unsynced();
+    test_drift(0);
+    test_drift(20000);
+    test_drift(-45000);
+    test_drift(150000);
+    test_step();
+    test_short_span();
+    test_clamp();
+    return test_result("test_clock_sync");
+}
@@ -0,0 +1,175 @@
+// Checks the derived quantities against the same formulas evaluated with
+// logf/expf/sqrtf over the ranges a weather station sees, that inputs
+// outside them give no value rather than a hang or garbage, and that
+// derived_weather only recomputes what its inputs changed.
+#include <math.h>
+#include <stdio.h>
+
+#include <limits>
+
+#include "derived_weather.h"
+#include "test.h"
+
+#define TOLERANCE 0.01f
+
+static float reference_dewpoint(float t, float rh) {
+    float gamma = 17.27f * t / (237.7f + t) + logf(rh / 100.0f);
+    return 237.7f * gamma / (17.27f - gamma);
+}
+
+static float reference_heat_index(float temperature, float r) {
+    float t = temperature * 1.8f + 32.0f;
+    if(t <= 40.0f) {
+        return temperature;
+    }
+    float hi = 0.5f * (t + 61.0f + (t - 68.0f) * 1.2f + r * 0.094f);
+    if((hi + t) * 0.5f >= 80.0f) {
+        hi = -42.379f + 2.04901523f * t + 10.14333127f * r - 0.22475541f * t * r
+            - 6.83783e-3f * t * t - 5.481717e-2f * r * r + 1.22874e-3f * t * t * r
+            + 8.5282e-4f * t * r * r - 1.99e-6f * t * t * r * r;
+        if(r < 13.0f && t > 80.0f && t < 112.0f) {
+            hi -= (13.0f - r) / 4.0f * sqrtf((17.0f - fabsf(t - 95.0f)) / 17.0f);
+        } else if(r > 85.0f && t >= 80.0f && t < 87.0f) {
+            hi += (r - 85.0f) / 10.0f * (87.0f - t) / 5.0f;
+        }
+    }
+    return (hi - 32.0f) / 1.8f;
+}
+
+static float reference_sea_level_pressure(float p, float t, float altitude) {
+    float column_k = t + 273.15f + 0.0065f * altitude / 2.0f;
+    return p * expf(0.0341632f * altitude / column_k);
+}
+
+static void test_dewpoint_accuracy() {
+    float worst = 0;
+    for(float t = -40.0f; t <= 50.0f; t += 0.25f) {
+        for(float rh = 1.0f; rh <= 100.0f; rh += 0.5f) {
+            std::optional<celsius_t> dp = dewpoint(t, rh);
+            CHECK_MSG(dp.has_value(), "%.2f C %.1f%%", t, rh);
+            float error = fabsf(dp.value_or(NAN) - reference_dewpoint(t, rh));
+            if(!(error <= worst)) {
+                worst = error;
+            }
+        }
+    }
+    printf("dewpoint: worst error %.6f C\n", worst);
+    CHECK_MSG(worst <= TOLERANCE, "%f", worst);
+}
+
+static void test_heat_index_accuracy() {
+    float worst = 0;
+    for(float t = -40.0f; t <= 50.0f; t += 0.25f) {
+        for(float rh = 0.0f; rh <= 100.0f; rh += 0.5f) {
+            float error = fabsf(heat_index(t, rh) - reference_heat_index(t, rh));
+            if(!(error <= worst)) {
+                worst = error;
+            }
+        }
+    }
+    printf("heat index: worst error %.6f C\n", worst);
+    CHECK_MSG(worst <= TOLERANCE, "%f", worst);
+}
+
+static void test_sea_level_pressure_accuracy() {
+    float worst = 0;
+    for(float p = 300.0f; p <= 1100.0f; p += 25.0f) {
+        for(float t = -40.0f; t <= 50.0f; t += 1.0f) {
+            for(float altitude = -400.0f; altitude <= 5000.0f; altitude += 50.0f) {
+                std::optional<mbar_t> slp = sea_level_pressure(p, t, altitude);
+                CHECK_MSG(slp.has_value(), "%.0f mbar %.0f C %.0f m", p, t, altitude);
+                float error = fabsf(slp.value_or(NAN) - reference_sea_level_pressure(p, t, altitude));
+                if(!(error <= worst)) {
+                    worst = error;
+                }
+            }
+        }
+    }
+    printf("sea level pressure: worst error %.6f mbar\n", worst);
+    CHECK_MSG(worst <= TOLERANCE, "%f", worst);
+}
+
+static void test_out_of_range() {
+    const float inf = std::numeric_limits<float>::infinity();
+    const float nan = std::numeric_limits<float>::quiet_NaN();
+
+    CHECK(!dewpoint(20.0f, 0.0f));
+    CHECK(!dewpoint(20.0f, nan));
+    CHECK(!dewpoint(nan, 50.0f));
+    CHECK(!dewpoint(inf, 50.0f));
+    CHECK(!dewpoint(-inf, 50.0f));
+    // The Magnus denominator is zero here
+    CHECK(!dewpoint(-237.7f, 50.0f));
+    CHECK(dewpoint(20.0f, inf).has_value());
+
+    // A column of air at absolute zero, and colder
+    CHECK(!sea_level_pressure(1000.0f, -273.15f, 0.0f));
+    CHECK(!sea_level_pressure(1000.0f, -273.15f - 0.0065f * 500.0f, 1000.0f));
+    CHECK(!sea_level_pressure(1000.0f, -300.0f, 100.0f));
+    // Non-finite inputs return rather than halving an infinite exponent forever
+    CHECK(!sea_level_pressure(1000.0f, nan, 100.0f));
+    CHECK(!sea_level_pressure(1000.0f, 15.0f, nan));
+    CHECK(!sea_level_pressure(1000.0f, 15.0f, inf));
+    CHECK(!sea_level_pressure(1000.0f, 15.0f, -inf));
+    CHECK(!sea_level_pressure(1000.0f, inf, 100.0f));
+    CHECK(!sea_level_pressure(inf, 15.0f, 100.0f));
+    CHECK(!sea_level_pressure(nan, 15.0f, 100.0f));
+    // Far below sea level the column is barely above absolute zero and the
+    // exponent is far beyond a float, the result underflows to zero
+    std::optional<mbar_t> deep = sea_level_pressure(1000.0f, 15.0f, -88000.0f);
+    CHECK(deep && *deep == 0.0f);
+}
+
+static void test_cache() {
+    derived_weather derived(250.0f);
+    packet_args args;
+    args.outTemp = 21.5f;
+    args.outHumidity = 40.0f;
+    args.pressure = 985.0f;
+    derived.fill(args);
+    CHECK(args.dewpoint && args.heatindex && args.barometer);
+    CHECK(derived.evaluations() == 3);
+
+    // Same readings, nothing recomputed
+    packet_args again;
+    again.outTemp = 21.5f;
+    again.outHumidity = 40.0f;
+    again.pressure = 985.0f;
+    derived.fill(again);
+    CHECK(derived.evaluations() == 3);
+    CHECK(again.dewpoint == args.dewpoint && again.barometer == args.barometer);
+
+    // Only pressure changed
+    packet_args pressure_only;
+    pressure_only.pressure = 986.0f;
+    derived.fill(pressure_only);
+    CHECK(derived.evaluations() == 4);
+    CHECK(!pressure_only.dewpoint && pressure_only.barometer);
+    CHECK(derived.dewpoint() == args.dewpoint);
+    CHECK(derived.evaluations() == 4);
+
+    // No altitude, no barometer
+    derived_weather no_altitude;
+    packet_args without;
+    without.outTemp = 10.0f;
+    without.pressure = 1000.0f;
+    no_altitude.fill(without);
+    CHECK(!without.barometer);
+
+    // A temperature that cannot be reduced leaves the barometer out
+    derived_weather frozen(1000.0f);
+    packet_args cold;
+    cold.outTemp = -280.0f;
+    cold.pressure = 1000.0f;
+    frozen.fill(cold);
+    CHECK(!cold.barometer);
+}
+
+int main() {
+    test_dewpoint_accuracy();
+    test_heat_index_accuracy();
+    test_sea_level_pressure_accuracy();
+    test_out_of_range();
+    test_cache();
+    return test_result("test_derived_weather");
+}
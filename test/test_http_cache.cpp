@@ -0,0 +1,81 @@
+#include <string>
+#include <string_view>
+
+#include "http_cache.h"
+#include "test.h"
+
+static const char request[] = "GET /latest HTTP/1.1\r\nHost: node\r\n\r\n";
+
+static std::string etag_of(http_cache &cache) {
+    http_cache::response response = cache.handle(request);
+    std::string_view text(response.data, response.length);
+    size_t start = text.find("ETag: ") + 6;
+    std::string etag(text.substr(start, text.find("\r\n", start) - start));
+    cache.release(response.buffer);
+    return etag;
+}
+
+static std::string conditional(std::string_view etag) {
+    return std::string("GET /latest HTTP/1.1\r\nIf-None-Match: ") + std::string(etag) + "\r\n\r\n";
+}
+
+static void test_render() {
+    http_cache cache(0x1234);
+    http_cache::response response = cache.handle(request);
+    CHECK(std::string_view(response.data, response.length).starts_with("HTTP/1.1 503"));
+    CHECK(cache.render("{\"outTemp\":21.5}"));
+    response = cache.handle(request);
+    std::string_view text(response.data, response.length);
+    CHECK(text.starts_with("HTTP/1.1 200 OK\r\n"));
+    CHECK(text.find("Content-Length: 16\r\n") != std::string_view::npos);
+    CHECK(text.ends_with("\r\n\r\n{\"outTemp\":21.5}"));
+    cache.release(response.buffer);
+}
+
+static void test_not_modified() {
+    http_cache cache(0x1234);
+    CHECK(cache.render("{}"));
+    std::string etag = etag_of(cache);
+    std::string again = conditional(etag);
+    http_cache::response response = cache.handle(again);
+    CHECK(std::string_view(response.data, response.length).starts_with("HTTP/1.1 304"));
+    cache.release(response.buffer);
+    CHECK(cache.render("{}"));
+    response = cache.handle(again);
+    CHECK(std::string_view(response.data, response.length).starts_with("HTTP/1.1 200"));
+    cache.release(response.buffer);
+}
+
+static void test_etag_survives_reboot() {
+    // Same sequence number after a reboot, but a different nonce
+    http_cache before(0x1234), after(0x5678);
+    CHECK(before.render("{\"outTemp\":1}"));
+    CHECK(after.render("{\"outTemp\":2}"));
+    std::string etag = etag_of(before);
+    CHECK(etag != etag_of(after));
+    std::string stale = conditional(etag);
+    http_cache::response response = after.handle(stale);
+    CHECK(std::string_view(response.data, response.length).starts_with("HTTP/1.1 200"));
+    after.release(response.buffer);
+}
+
+static void test_pinned_buffers() {
+    http_cache cache(0);
+    CHECK(cache.render("{}"));
+    http_cache::response first = cache.handle(request);
+    CHECK(cache.render("{}"));
+    http_cache::response second = cache.handle(request);
+    // Both buffers are referenced by in-flight responses
+    CHECK(!cache.render("{}"));
+    cache.release(first.buffer);
+    CHECK(cache.render("{}"));
+    cache.release(second.buffer);
+}
+
+int main() {
+    test_render();
+    test_not_modified();
+    test_etag_survives_reboot();
+    test_pinned_buffers();
+    return test_result("http_cache");
+}
@@ -0,0 +1,202 @@
+// Drives http_server through the lwIP stand-in in sdk/fake_lwip.h, playing
+// the client: plain and conditional GETs, responses pinned in the cache
+// until fully acknowledged, closes from either end and resets mid-response.
+#include <string>
+#include <string_view>
+
+#include "http_cache.h"
+#include "http_server.h"
+#include "test.h"
+
+static const char request[] = "GET /latest HTTP/1.1\r\nHost: node\r\n\r\n";
+static const char body[] = "{\"outTemp\":21.5}";
+
+// Rendering twice needs both buffers, so it fails while a response still
+// pins one. Leaves the cache with a new reading either way.
+static bool can_render_twice(http_cache &cache) {
+    return cache.render(body) && cache.render(body);
+}
+
+static tcp_pcb *listener() {
+    return fake_tcp_pcbs.front();
+}
+
+// The pcb is no longer the server's: it let go of all its callbacks
+static bool detached(const tcp_pcb *pcb) {
+    return pcb->callback_arg == nullptr && pcb->recv == nullptr && pcb->sent == nullptr && pcb->errf == nullptr;
+}
+
+static void test_get() {
+    fake_lwip_reset();
+    http_cache cache(0x1234);
+    CHECK(cache.render(body));
+    {
+        http_server server(cache, 8080);
+        CHECK(server.listen());
+        CHECK(server.listening());
+
+        tcp_pcb *pcb = fake_tcp_connect(listener());
+        CHECK(!pcb->freed);
+        // The request head arrives in two segments
+        CHECK(fake_tcp_receive(pcb, "GET /latest HTTP/1.1\r\n") == ERR_OK);
+        CHECK(pcb->segments.empty());
+        CHECK(fake_tcp_receive(pcb, "Host: node\r\n\r\n") == ERR_OK);
+        CHECK(pcb->recved == sizeof(request) - 1);
+        CHECK(pcb->segments.size() == 1);
+        CHECK(pcb->outputs == 1);
+
+        std::string response = fake_tcp_written(pcb);
+        CHECK(response.starts_with("HTTP/1.1 200 OK\r\n"));
+        CHECK(response.ends_with(body));
+        // Written by reference, straight out of the cache
+        CHECK(pcb->segments[0].copy.empty());
+
+        CHECK(fake_tcp_ack(pcb, (u16_t)response.size()) == ERR_OK);
+        CHECK(pcb->closed && !pcb->aborted);
+        CHECK(detached(pcb));
+        CHECK(can_render_twice(cache));
+    }
+    // The destructor closes the listener
+    CHECK(listener()->freed);
+    CHECK(fake_pbufs_live == 0);
+    CHECK(fake_tcp_use_after_free == 0);
+}
+
+static void test_not_modified() {
+    fake_lwip_reset();
+    http_cache cache(0x1234);
+    CHECK(cache.render(body));
+    http_server server(cache);
+    CHECK(server.listen());
+
+    tcp_pcb *first = fake_tcp_connect(listener());
+    fake_tcp_receive(first, request);
+    std::string response = fake_tcp_written(first);
+    size_t start = response.find("ETag: ") + 6;
+    std::string etag = response.substr(start, response.find("\r\n", start) - start);
+    fake_tcp_ack(first, (u16_t)response.size());
+
+    tcp_pcb *second = fake_tcp_connect(listener());
+    fake_tcp_receive(second, "GET /latest HTTP/1.1\r\nIf-None-Match: " + etag + "\r\n\r\n");
+    std::string not_modified = fake_tcp_written(second);
+    CHECK(not_modified.starts_with("HTTP/1.1 304 Not Modified\r\n"));
+    CHECK(not_modified.find(etag) != std::string::npos);
+    CHECK(not_modified.find(body) == std::string::npos);
+    // A 304 pins its buffer like any other response
+    CHECK(!can_render_twice(cache));
+    fake_tcp_ack(second, (u16_t)not_modified.size());
+    CHECK(second->closed && detached(second));
+    CHECK(fake_pbufs_live == 0);
+    CHECK(fake_tcp_use_after_free == 0);
+}
+
+static void test_partial_ack() {
+    fake_lwip_reset();
+    http_cache cache(0x1234);
+    CHECK(cache.render(body));
+    http_server server(cache);
+    CHECK(server.listen());
+
+    tcp_pcb *pcb = fake_tcp_connect(listener());
+    fake_tcp_receive(pcb, request);
+    std::string response = fake_tcp_written(pcb);
+
+    CHECK(fake_tcp_ack(pcb, 10) == ERR_OK);
+    CHECK(!pcb->closed);
+    // New readings keep coming, but never into the buffer still being sent
+    CHECK(!can_render_twice(cache));
+    CHECK(fake_tcp_written(pcb) == response);
+
+    // The client closes its side before acknowledging the rest. The server
+    // closes too, but the buffer stays pinned until the last byte is acked.
+    CHECK(fake_tcp_remote_close(pcb) == ERR_OK);
+    CHECK(pcb->closed && !pcb->aborted);
+    CHECK(!detached(pcb));
+    CHECK(!can_render_twice(cache));
+    CHECK(fake_tcp_written(pcb) == response);
+
+    CHECK(fake_tcp_ack(pcb, (u16_t)(response.size() - 10)) == ERR_OK);
+    CHECK(detached(pcb));
+    CHECK(can_render_twice(cache));
+    CHECK(fake_pbufs_live == 0);
+    CHECK(fake_tcp_use_after_free == 0);
+}
+
+static void test_reset_mid_response() {
+    fake_lwip_reset();
+    http_cache cache(0x1234);
+    CHECK(cache.render(body));
+    http_server server(cache);
+    CHECK(server.listen());
+
+    tcp_pcb *pcb = fake_tcp_connect(listener());
+    fake_tcp_receive(pcb, request);
+    fake_tcp_ack(pcb, 5);
+    CHECK(!can_render_twice(cache));
+
+    // lwIP frees the pcb and reports it, the server must not touch it again
+    fake_tcp_reset(pcb);
+    CHECK(can_render_twice(cache));
+
+    // All the connection slots are free again
+    tcp_pcb *pcbs[HTTP_SERVER_MAX_CONNECTIONS];
+    for(tcp_pcb *&next : pcbs) {
+        next = fake_tcp_connect(listener());
+        CHECK(!next->aborted);
+    }
+    tcp_pcb *extra = fake_tcp_connect(listener());
+    CHECK(extra->aborted);
+    for(tcp_pcb *next : pcbs) {
+        fake_tcp_reset(next);
+    }
+    CHECK(!fake_tcp_connect(listener())->aborted);
+    CHECK(fake_pbufs_live == 0);
+    CHECK(fake_tcp_use_after_free == 0);
+}
+
+static void test_send_buffer_overflow() {
+    fake_lwip_reset();
+    http_cache cache(0x1234);
+    CHECK(cache.render(body));
+    http_server server(cache);
+    CHECK(server.listen());
+
+    tcp_pcb *pcb = fake_tcp_connect(listener());
+    pcb->snd_buf = 16;
+    CHECK(fake_tcp_receive(pcb, request) == ERR_ABRT);
+    CHECK(pcb->aborted);
+    CHECK(pcb->segments.empty());
+    CHECK(detached(pcb));
+    CHECK(can_render_twice(cache));
+    CHECK(fake_pbufs_live == 0);
+    CHECK(fake_tcp_use_after_free == 0);
+}
+
+static void test_close_fails() {
+    fake_lwip_reset();
+    http_cache cache(0x1234);
+    CHECK(cache.render(body));
+    http_server server(cache);
+    CHECK(server.listen());
+
+    tcp_pcb *pcb = fake_tcp_connect(listener());
+    fake_tcp_receive(pcb, request);
+    std::string response = fake_tcp_written(pcb);
+    // With the close refused the server aborts instead of leaking the slot
+    fake_tcp_close_result = ERR_MEM;
+    CHECK(fake_tcp_ack(pcb, (u16_t)response.size()) == ERR_ABRT);
+    CHECK(pcb->aborted && detached(pcb));
+    CHECK(can_render_twice(cache));
+    CHECK(fake_tcp_use_after_free == 0);
+}
+
+int main() {
+    test_get();
+    test_not_modified();
+    test_partial_ack();
+    test_reset_mid_response();
+    test_send_buffer_overflow();
+    test_close_fails();
+    fake_lwip_reset();
+    return test_result("test_http_server");
+}
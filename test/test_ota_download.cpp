@@ -0,0 +1,163 @@
+// Feeds ota_download the responses of an update server stand-in, cut into
+// the segment sizes TCP might deliver, and follows a downloaded update
+// through staging and the loader's swap.
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+#include "delta_patch.h"
+#include "memory_flash.h"
+#include "ota_download.h"
+#include "ota_images.h"
+#include "ota_slots.h"
+#include "test.h"
+
+#define BLOCK 64
+
+static const std::vector<uint8_t> old_image = make_image(1, 5 * FLASH_DEVICE_SECTOR_SIZE + 123);
+static const std::vector<uint8_t> new_image = edit_image(old_image, 2, 6 * FLASH_DEVICE_SECTOR_SIZE + 77);
+
+static void put_u32(std::string &out, uint32_t value) {
+    for(int i = 0; i < 4; i++) {
+        out.push_back((char)(value >> (8 * i)));
+    }
+}
+
+static void put_varint(std::string &out, uint32_t value) {
+    do {
+        uint8_t byte = value & 0x7F;
+        value >>= 7;
+        out.push_back((char)(byte | (value ? 0x80 : 0)));
+    } while(value);
+}
+
+// A plain encoder for the format in delta_patch.h: blocks unchanged at the
+// same offset are copied, everything else is sent as data
+static std::string make_patch(const std::vector<uint8_t> &from, const std::vector<uint8_t> &to) {
+    std::string patch("WNDP");
+    patch.push_back(DELTA_PATCH_VERSION);
+    patch.append(3, '\0');
+    put_u32(patch, from.size());
+    put_u32(patch, image_crc(from));
+    put_u32(patch, to.size());
+    put_u32(patch, image_crc(to));
+    for(size_t offset = 0; offset < to.size(); offset += BLOCK) {
+        size_t length = std::min<size_t>(BLOCK, to.size() - offset);
+        if(offset + length <= from.size() && memcmp(from.data() + offset, to.data() + offset, length) == 0) {
+            patch.push_back(DELTA_OP_COPY);
+            put_varint(patch, offset);
+            put_varint(patch, length);
+        } else {
+            patch.push_back(DELTA_OP_DATA);
+            put_varint(patch, length);
+            patch.append((const char*)to.data() + offset, length);
+        }
+    }
+    patch.push_back(DELTA_OP_END);
+    return patch;
+}
+
+// Stand-in for scripts/ota_server.py serving latest to nodes running base
+static std::string respond(uint32_t running_crc, const std::vector<uint8_t> &base, const std::vector<uint8_t> &latest) {
+    if(running_crc == image_crc(latest)) {
+        return "HTTP/1.0 204 No Content\r\nServer: stand-in\r\n\r\n";
+    }
+    if(running_crc != image_crc(base)) {
+        return "HTTP/1.0 404 Not Found\r\nContent-Type: text/plain\r\n\r\nunknown image";
+    }
+    std::string patch = make_patch(base, latest);
+    return "HTTP/1.0 200 OK\r\nContent-Type: application/octet-stream\r\nContent-Length: "
+        + std::to_string(patch.size()) + "\r\n\r\n" + patch;
+}
+
+static memory_flash running_flash(const std::vector<uint8_t> &image) {
+    memory_flash flash(OTA_TEST_FLASH_SIZE);
+    install(flash, ota_layout_for(flash.size()).active, image);
+    return flash;
+}
+
+static ota_download::status deliver(ota_download &download, const std::string &response, size_t segment) {
+    ota_download::status status = download.state();
+    for(size_t offset = 0; offset < response.size() && status == ota_download::status::more; offset += segment) {
+        size_t length = std::min(segment, response.size() - offset);
+        status = download.feed({(const uint8_t*)response.data() + offset, length});
+    }
+    return status;
+}
+
+static ota_download::status fetch(memory_flash &flash, const std::string &response, size_t segment = 1460, uint32_t rejected = 0) {
+    ota_download download(flash, ota_layout_for(flash.size()), old_image.size(), rejected);
+    return deliver(download, response, segment);
+}
+
+static void test_segment_sizes() {
+    std::string response = respond(image_crc(old_image), old_image, new_image);
+    for(size_t segment : {(size_t)1, (size_t)13, (size_t)536, (size_t)1460, response.size()}) {
+        memory_flash flash = running_flash(old_image);
+        ota_layout layout = ota_layout_for(flash.size());
+        ota_download download(flash, layout, old_image.size(), 0);
+        CHECK_MSG(deliver(download, response, segment) == ota_download::status::done, "segment %zu", segment);
+        CHECK(download.image_size() == new_image.size());
+        CHECK(download.image_crc() == image_crc(new_image));
+        CHECK_MSG(holds(flash, layout.staging, new_image), "segment %zu", segment);
+        CHECK(holds(flash, layout.active, old_image));
+    }
+}
+
+static void test_no_update() {
+    memory_flash flash = running_flash(old_image);
+    CHECK(fetch(flash, respond(image_crc(new_image), old_image, new_image)) == ota_download::status::no_update);
+    CHECK(fetch(flash, respond(12345, old_image, new_image)) == ota_download::status::no_update);
+    // A rolled back image is abandoned as soon as the patch header names it
+    std::string response = respond(image_crc(old_image), old_image, new_image);
+    CHECK(fetch(flash, response, 1460, image_crc(new_image)) == ota_download::status::no_update);
+}
+
+static void test_bad_responses() {
+    memory_flash flash = running_flash(old_image);
+    CHECK(fetch(flash, "HTTP/1.1 500 Internal Server Error\r\n\r\n") == ota_download::status::failed);
+    CHECK(fetch(flash, "SSH-2.0-OpenSSH\r\n\r\n") == ota_download::status::failed);
+    CHECK(fetch(flash, "HTTP/1.0\r\n\r\n") == ota_download::status::failed);
+    CHECK(fetch(flash, "HTTP/1.0 200 OK\r\n" + std::string(OTA_HEADER_SIZE, 'x')) == ota_download::status::failed);
+    // Built for an image the node is not running
+    std::vector<uint8_t> other = make_image(9, old_image.size());
+    std::string response = respond(image_crc(other), other, new_image);
+    CHECK(fetch(flash, response) == ota_download::status::failed);
+    // Damaged in transit
+    response = respond(image_crc(old_image), old_image, new_image);
+    response[response.size() - 20] ^= 0x01;
+    CHECK(fetch(flash, response) == ota_download::status::failed);
+    // Cut short
+    response = respond(image_crc(old_image), old_image, new_image);
+    CHECK(fetch(flash, response.substr(0, response.size() / 2)) == ota_download::status::more);
+}
+
+static void test_end_to_end() {
+    memory_flash flash = running_flash(old_image);
+    ota_layout layout = ota_layout_for(flash.size());
+    CHECK(loader_boot(flash) == ota_state::confirmed);
+    ota_slots app(flash, layout, old_image.size());
+    ota_download download(flash, layout, app.running_size(), app.record().rejected_crc);
+    CHECK(deliver(download, respond(image_crc(old_image), old_image, new_image), 1460) == ota_download::status::done);
+    CHECK(app.stage(download.image_size(), download.image_crc()));
+
+    CHECK(loader_boot(flash) == ota_state::trial);
+    CHECK(holds(flash, layout.active, new_image));
+    ota_slots updated(flash, layout, new_image.size());
+    updated.confirm();
+    // The updated node asks again and is told it is current
+    ota_download again(flash, layout, updated.running_size(), updated.record().rejected_crc);
+    CHECK(deliver(again, respond(image_crc(new_image), old_image, new_image), 1460) == ota_download::status::no_update);
+    CHECK(loader_boot(flash) == ota_state::confirmed);
+}
+
+int main() {
+    test_segment_sizes();
+    test_no_update();
+    test_bad_responses();
+    test_end_to_end();
+    return test_result("test_ota_download");
+}
@@ -0,0 +1,195 @@
+// Runs the A/B slot logic against a memory backed flash: staging, the swap
+// the loader does, trial boots, confirmation and rollback, and power loss
+// at every flash operation of each of them.
+#include <stdint.h>
+
+#include <vector>
+
+#include "flash_layout.h"
+#include "memory_flash.h"
+#include "ota_images.h"
+#include "ota_slots.h"
+#include "test.h"
+
+static const std::vector<uint8_t> old_image = make_image(1, 5 * FLASH_DEVICE_SECTOR_SIZE + 123);
+static const std::vector<uint8_t> new_image = edit_image(old_image, 2, 6 * FLASH_DEVICE_SECTOR_SIZE + 77);
+
+// Flash running old_image with new_image staged by the application
+static memory_flash staged_flash() {
+    memory_flash flash(OTA_TEST_FLASH_SIZE);
+    ota_layout layout = ota_layout_for(flash.size());
+    install(flash, layout.active, old_image);
+    ota_slots app(flash, layout, old_image.size());
+    install(flash, layout.staging, new_image);
+    CHECK(app.stage(new_image.size(), image_crc(new_image)));
+    return flash;
+}
+
+// Flash running new_image on trial with every attempt used up
+static memory_flash exhausted_flash() {
+    memory_flash flash = staged_flash();
+    for(int boot = 0; boot < OTA_MAX_ATTEMPTS; boot++) {
+        CHECK(loader_boot(flash) == ota_state::trial);
+    }
+    return flash;
+}
+
+static void test_fresh_flash() {
+    memory_flash flash(OTA_TEST_FLASH_SIZE);
+    ota_layout layout = ota_layout_for(flash.size());
+    CHECK(layout.active == FLASH_LOADER_SIZE);
+    CHECK(layout.staging == layout.active + layout.slot_size);
+    CHECK(layout.staging + layout.slot_size <= layout.scratch);
+    CHECK(layout.state + 2 * FLASH_DEVICE_SECTOR_SIZE == flash.size());
+    install(flash, layout.active, old_image);
+    CHECK(loader_boot(flash) == ota_state::confirmed);
+    CHECK(holds(flash, layout.active, old_image));
+    ota_slots app(flash, layout, old_image.size());
+    CHECK(app.state() == ota_state::confirmed);
+    CHECK(app.attempts() == 0);
+}
+
+// CMakeLists.txt links the image with a flash region of the slot size it
+// works out for the Pico W the same way, so the two must agree
+static void test_pico_w_layout() {
+    ota_layout layout = ota_layout_for(2 * 1024 * 1024);
+    CHECK(FLASH_LOADER_SIZE != 0x8000 || layout.slot_size == 0xFA000);
+    CHECK(layout.slot_size % FLASH_DEVICE_SECTOR_SIZE == 0);
+    CHECK(layout.staging + layout.slot_size <= layout.scratch);
+}
+
+static void test_update_and_confirm() {
+    memory_flash flash = staged_flash();
+    ota_layout layout = ota_layout_for(flash.size());
+    CHECK(loader_boot(flash) == ota_state::trial);
+    CHECK(holds(flash, layout.active, new_image));
+    CHECK(holds(flash, layout.staging, old_image));
+
+    ota_slots app(flash, layout, new_image.size());
+    CHECK(app.state() == ota_state::trial);
+    CHECK(app.attempts() == 1);
+    CHECK(app.record().image_crc == image_crc(new_image));
+    CHECK(app.record().previous_crc == image_crc(old_image));
+    app.confirm();
+    CHECK(app.state() == ota_state::confirmed);
+
+    CHECK(loader_boot(flash) == ota_state::confirmed);
+    CHECK(holds(flash, layout.active, new_image));
+    // Nothing can be staged over an image still on trial
+    memory_flash trial = staged_flash();
+    loader_boot(trial);
+    ota_slots trial_app(trial, layout, new_image.size());
+    CHECK(!trial_app.stage(old_image.size(), image_crc(old_image)));
+}
+
+static void test_rollback() {
+    memory_flash flash = exhausted_flash();
+    ota_layout layout = ota_layout_for(flash.size());
+    CHECK(ota_slots(flash, layout, new_image.size()).attempts() == OTA_MAX_ATTEMPTS);
+    CHECK(loader_boot(flash) == ota_state::rolled_back);
+    CHECK(holds(flash, layout.active, old_image));
+    CHECK(holds(flash, layout.staging, new_image));
+
+    ota_slots app(flash, layout, old_image.size());
+    CHECK(app.record().image_crc == image_crc(old_image));
+    CHECK(app.record().rejected_crc == image_crc(new_image));
+    // The image that failed is not taken again, another one is
+    CHECK(!app.stage(new_image.size(), image_crc(new_image)));
+    std::vector<uint8_t> fixed = edit_image(new_image, 3, new_image.size());
+    install(flash, layout.staging, fixed);
+    CHECK(app.stage(fixed.size(), image_crc(fixed)));
+    CHECK(loader_boot(flash) == ota_state::trial);
+    CHECK(holds(flash, layout.active, fixed));
+}
+
+static void test_corrupt_staged_image() {
+    memory_flash flash = staged_flash();
+    ota_layout layout = ota_layout_for(flash.size());
+    flash.data()[layout.staging + 10] ^= 0xFF;
+    CHECK(loader_boot(flash) == ota_state::confirmed);
+    CHECK(holds(flash, layout.active, old_image));
+}
+
+// Cuts power during each flash operation of the loader's next run in turn,
+// then boots again and hands the result to check
+template<typename setup_t, typename check_t>
+static void with_power_loss(const char *name, setup_t setup, check_t check) {
+    memory_flash reference = setup();
+    uint32_t before = reference.operations();
+    loader_boot(reference);
+    uint32_t total = reference.operations() - before;
+    CHECK(total > 0);
+    for(uint32_t n = 0; n < total; n++) {
+        memory_flash flash = setup();
+        flash.fail_after(n);
+        bool lost = false;
+        try {
+            loader_boot(flash);
+        } catch(const power_loss&) {
+            lost = true;
+        }
+        flash.keep_power();
+        CHECK_MSG(lost, "%s: operation %u", name, n);
+        ota_state state = loader_boot(flash);
+        if(!check(flash, state)) {
+            printf("%s: wrong result after power loss at operation %u of %u\n", name, n, total);
+            test_failures++;
+            return;
+        }
+    }
+    printf("%s: recovered from power loss at each of %u operations\n", name, total);
+}
+
+static void test_power_loss_during_swap() {
+    ota_layout layout = ota_layout_for(OTA_TEST_FLASH_SIZE);
+    with_power_loss("swap", staged_flash, [&](memory_flash &flash, ota_state state) {
+        uint32_t attempts = ota_slots(flash, layout, new_image.size()).attempts();
+        return state == ota_state::trial && (attempts == 1 || attempts == 2)
+            && holds(flash, layout.active, new_image) && holds(flash, layout.staging, old_image);
+    });
+}
+
+static void test_power_loss_during_rollback() {
+    ota_layout layout = ota_layout_for(OTA_TEST_FLASH_SIZE);
+    with_power_loss("rollback", exhausted_flash, [&](memory_flash &flash, ota_state state) {
+        return state == ota_state::rolled_back && holds(flash, layout.active, old_image) && holds(flash, layout.staging, new_image);
+    });
+}
+
+static void test_power_loss_during_store() {
+    ota_layout layout = ota_layout_for(OTA_TEST_FLASH_SIZE);
+    memory_flash reference = staged_flash();
+    loader_boot(reference);
+    uint32_t before = reference.operations();
+    ota_slots(reference, layout, new_image.size()).confirm();
+    uint32_t total = reference.operations() - before;
+    CHECK(total == 2);
+    for(uint32_t n = 0; n < total; n++) {
+        memory_flash flash = staged_flash();
+        loader_boot(flash);
+        flash.fail_after(n);
+        try {
+            ota_slots(flash, layout, new_image.size()).confirm();
+        } catch(const power_loss&) {
+        }
+        flash.keep_power();
+        // Either record may be current, but never neither
+        ota_state state = loader_boot(flash);
+        ota_slots app(flash, layout, new_image.size());
+        CHECK_MSG(state == ota_state::trial || state == ota_state::confirmed, "operation %u", n);
+        CHECK_MSG(app.record().image_crc == image_crc(new_image), "operation %u", n);
+        CHECK(holds(flash, layout.active, new_image));
+    }
+}
+
+int main() {
+    test_fresh_flash();
+    test_pico_w_layout();
+    test_update_and_confirm();
+    test_rollback();
+    test_corrupt_staged_image();
+    test_power_loss_during_swap();
+    test_power_loss_during_rollback();
+    test_power_loss_during_store();
+    return test_result("test_ota_slots");
+}
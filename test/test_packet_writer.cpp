@@ -0,0 +1,80 @@
+// Checks write_packet() against the nlohmann::json packet it replaces and
+// that no value can overrun or be truncated in its number buffer.
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <limits>
+#include <string>
+
+#include "loop_packet.h"
+#include "packet_args_sample.h"
+#include "packet_writer.h"
+#include "test.h"
+
+static std::string written(const packet_args &args) {
+    std::string text;
+    CHECK(write_packet(args, [&text](std::string_view piece) {
+        text.append(piece);
+        return true;
+    }));
+    return text;
+}
+
+static void test_matches_json() {
+    packet_args args = sample_packet();
+    nlohmann::json expected = create_packet(args);
+    nlohmann::json actual = nlohmann::json::parse(written(args));
+    CHECK(expected.size() == actual.size());
+    for(auto &[key, value] : expected.items()) {
+        CHECK_MSG(actual.contains(key), "%s", key.c_str());
+        double a = value.get<double>(), b = actual[key].get<double>();
+        CHECK_MSG(fabs(a - b) <= 1e-6 * fabs(a), "%s: %f vs %f", key.c_str(), a, b);
+    }
+    CHECK(written(packet_args{}) == "{}");
+}
+
+static void test_stops_when_full() {
+    size_t room = 40, used = 0;
+    bool ok = write_packet(sample_packet(), [&](std::string_view piece) {
+        if(used + piece.size() > room) {
+            return false;
+        }
+        used += piece.size();
+        return true;
+    });
+    CHECK(!ok);
+    CHECK(used <= room);
+}
+
+static void test_number_bounds() {
+    char out[PACKET_NUMBER_SIZE];
+    const double doubles[] = {
+        0.0, -1760875200.125, std::numeric_limits<double>::max(), -std::numeric_limits<double>::max(),
+        std::numeric_limits<double>::denorm_min(), -1e21, 1e22
+    };
+    for(double value : doubles) {
+        memset(out, 0, sizeof(out));
+        size_t length = format_packet_number(out, value);
+        CHECK_MSG(length < PACKET_NUMBER_SIZE && strlen(out) == length, "%g", value);
+        // Whatever is written reads back as the value, to the millisecond at least
+        CHECK_MSG(fabs(strtod(out, nullptr) - value) <= 5e-4, "%g -> %s", value, out);
+    }
+    const float floats[] = {-std::numeric_limits<float>::max(), std::numeric_limits<float>::min(), -0.0f};
+    for(float value : floats) {
+        size_t length = format_packet_number(out, value);
+        CHECK(length < PACKET_NUMBER_SIZE && std::string(out, length) != "null");
+    }
+    CHECK(format_packet_number(out, std::numeric_limits<int>::min()) == 11);
+    size_t length = format_packet_number(out, NAN);
+    CHECK(std::string(out, length) == "null");
+    length = format_packet_number(out, -INFINITY);
+    CHECK(std::string(out, length) == "null");
+}
+
+int main() {
+    test_matches_json();
+    test_stops_when_full();
+    test_number_bounds();
+    return test_result("test_packet_writer");
+}
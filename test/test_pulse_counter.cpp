@@ -0,0 +1,218 @@
+// Runs src/pulse_counter.pio on a small interpreter for the handful of PIO
+// instructions it uses, against synthetic reed switch waveforms. Each
+// instruction takes one cycle plus its delay, as on the real state machine.
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "test.h"
+
+#ifndef PULSE_COUNTER_PIO
+#define PULSE_COUNTER_PIO "src/pulse_counter.pio"
+#endif
+// Matches PULSE_COUNTER_DEBOUNCE_CYCLES in the program's c-sdk block
+#define DEBOUNCE_CYCLES 320
+
+struct instruction {
+    std::string op, a, b, label;
+    int delay;
+};
+
+struct program {
+    std::vector<instruction> code;
+    std::map<std::string, int> labels;
+    int wrap_target = 0, wrap = -1;
+};
+
+static std::string trim(const std::string &text) {
+    size_t start = text.find_first_not_of(" \t\r\n,");
+    size_t end = text.find_last_not_of(" \t\r\n,");
+    return start == std::string::npos ? "" : text.substr(start, end - start + 1);
+}
+
+static bool assemble(const char *path, program &out) {
+    FILE *file = fopen(path, "r");
+    if(file == nullptr) {
+        printf("cannot open %s\n", path);
+        return false;
+    }
+    char buffer[256];
+    bool in_program = false;
+    while(fgets(buffer, sizeof(buffer), file)) {
+        std::string line(buffer);
+        line = trim(line.substr(0, line.find(';')));
+        if(line.empty()) {
+            continue;
+        }
+        if(line.starts_with("%")) {
+            break;
+        }
+        if(line.starts_with(".program")) {
+            in_program = true;
+            continue;
+        }
+        if(!in_program) {
+            continue;
+        }
+        if(line == ".wrap_target") {
+            out.wrap_target = out.code.size();
+            continue;
+        }
+        if(line == ".wrap") {
+            out.wrap = out.code.size() - 1;
+            continue;
+        }
+        if(line.back() == ':') {
+            out.labels[line.substr(0, line.size() - 1)] = out.code.size();
+            continue;
+        }
+        instruction in{};
+        size_t delay = line.find('[');
+        if(delay != std::string::npos) {
+            in.delay = atoi(line.c_str() + delay + 1);
+            line = trim(line.substr(0, delay));
+        }
+        for(char &ch : line) {
+            ch = ch == ',' ? ' ' : ch;
+        }
+        char op[16] = {}, a[16] = {}, b[16] = {};
+        int fields = sscanf(line.c_str(), "%15s %15s %15s", op, a, b);
+        in.op = op;
+        if(in.op == "jmp") {
+            // jmp [condition] label
+            if(fields == 2) {
+                in.label = a;
+            } else {
+                in.a = a;
+                in.label = b;
+            }
+        } else {
+            in.a = a;
+            in.b = b;
+        }
+        out.code.push_back(in);
+    }
+    fclose(file);
+    if(out.wrap < 0) {
+        out.wrap = out.code.size() - 1;
+    }
+    return !out.code.empty();
+}
+
+// Runs the state machine for the given number of cycles. level(cycle) is
+// the pin, the last pushed word is what DMA leaves in pulse_counter::m_count.
+static uint32_t run(const program &p, uint64_t cycles, const std::function<bool(uint64_t)> &level) {
+    uint32_t x = 0, y = 0, isr = 0, pushed = 0;
+    int pc = 0;
+    uint64_t cycle = 0;
+    auto advance = [&](int next) {
+        pc = next > p.wrap ? p.wrap_target : next;
+    };
+    while(cycle < cycles) {
+        const instruction &in = p.code[pc];
+        bool pin = level(cycle);
+        int next = pc + 1;
+        if(in.op == "wait") {
+            // wait <polarity> pin 0
+            if(pin != (in.a == "1")) {
+                cycle++;
+                continue;
+            }
+        } else if(in.op == "mov") {
+            uint32_t source = in.b == "~null" ? 0xFFFFFFFF : in.b == "~x" ? ~x : in.b == "x" ? x : 0;
+            (in.a == "x" ? x : in.a == "y" ? y : isr) = source;
+        } else if(in.op == "set") {
+            (in.a == "x" ? x : y) = atoi(in.b.c_str());
+        } else if(in.op == "push") {
+            pushed = isr;
+            isr = 0;
+        } else if(in.op == "jmp") {
+            bool taken = true;
+            if(in.a == "pin") {
+                taken = pin;
+            } else if(in.a == "x--") {
+                taken = x-- != 0;
+            } else if(in.a == "y--") {
+                taken = y-- != 0;
+            }
+            if(taken) {
+                next = p.labels.at(in.label);
+            }
+        }
+        cycle += 1 + in.delay;
+        advance(next);
+    }
+    return pushed;
+}
+
+// Pin is pulled up, the reed switch pulls it low. Each closure starts and
+// ends with contact bounce.
+struct closure {
+    uint64_t start, length;
+};
+
+static std::function<bool(uint64_t)> waveform(std::vector<closure> closures, uint64_t bounce = 0) {
+    return [closures, bounce](uint64_t cycle) {
+        for(const closure &c : closures) {
+            if(cycle < c.start || cycle >= c.start + c.length) {
+                continue;
+            }
+            uint64_t offset = cycle - c.start, remaining = c.start + c.length - cycle;
+            if(offset < bounce || remaining < bounce) {
+                // Chatter with a period of 37 cycles
+                return (cycle / 37) % 2 == 0;
+            }
+            return false;
+        }
+        return true;
+    };
+}
+
+static void test_clean_pulses(const program &p) {
+    std::vector<closure> closures;
+    for(int i = 0; i < 10; i++) {
+        closures.push_back({1000 + i * 5000ull, 2000});
+    }
+    CHECK(run(p, 60000, waveform(closures)) == 10);
+}
+
+static void test_short_closures_ignored(const program &p) {
+    // Glitches shorter than the debounce time never count
+    std::vector<closure> closures;
+    for(int i = 0; i < 10; i++) {
+        closures.push_back({1000 + i * 1000ull, DEBOUNCE_CYCLES / 2});
+    }
+    CHECK(run(p, 20000, waveform(closures)) == 0);
+}
+
+static void test_bounce(const program &p) {
+    // Each closure chatters for 200 cycles on both edges and still counts once
+    std::vector<closure> closures;
+    for(int i = 0; i < 5; i++) {
+        closures.push_back({1000 + i * 10000ull, 3000});
+    }
+    CHECK(run(p, 60000, waveform(closures, 200)) == 5);
+}
+
+static void test_held_closed(const program &p) {
+    // A magnet parked on the reed switch is a single pulse
+    CHECK(run(p, 100000, waveform({{1000, 90000}})) == 1);
+}
+
+int main() {
+    program p;
+    if(!assemble(PULSE_COUNTER_PIO, p)) {
+        printf("could not assemble %s\n", PULSE_COUNTER_PIO);
+        return 1;
+    }
+    test_clean_pulses(p);
+    test_short_closures_ignored(p);
+    test_bounce(p);
+    test_held_closed(p);
+    return test_result("pulse_counter");
+}
@@ -0,0 +1,60 @@
+#include <math.h>
+
+#include "rain_tracker.h"
+#include "test.h"
+
+#define CM_PER_TIP 0.02794f
+
+static void test_first_count_is_baseline() {
+    rain_tracker rain;
+    rain.update(1234);
+    CHECK(rain.pending_tips() == 0);
+    rain.update(1237);
+    CHECK(rain.pending_tips() == 3);
+}
+
+static void test_take_and_peek() {
+    rain_tracker rain;
+    uint32_t count = 0;
+    rain.update(count);
+    // A shower of tips seen across several loop iterations
+    for(int i = 0; i < 20; i++) {
+        count += i % 3;
+        rain.update(count);
+    }
+    CHECK(rain.pending_tips() == count);
+    CHECK(fabsf(rain.peek() - count * CM_PER_TIP) < 1e-5f);
+    // peek() leaves the total for a send that might fail
+    CHECK(rain.pending_tips() == count);
+    CHECK(fabsf(rain.take() - count * CM_PER_TIP) < 1e-5f);
+    CHECK(rain.pending_tips() == 0);
+    CHECK(rain.take() == 0.0f);
+}
+
+static void test_accumulates_until_taken() {
+    // Tips keep adding up while nothing is sent
+    rain_tracker rain;
+    rain.update(0);
+    rain.update(5);
+    rain.update(5);
+    rain.update(9);
+    CHECK(rain.pending_tips() == 9);
+    rain.take();
+    rain.update(10);
+    CHECK(rain.pending_tips() == 1);
+}
+
+static void test_wraparound() {
+    rain_tracker rain;
+    rain.update(0xFFFFFFFE);
+    rain.update(3);
+    CHECK(rain.pending_tips() == 5);
+}
+
+int main() {
+    test_first_count_is_baseline();
+    test_take_and_peek();
+    test_accumulates_until_taken();
+    test_wraparound();
+    return test_result("rain_tracker");
+}
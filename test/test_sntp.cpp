@@ -0,0 +1,157 @@
+// Builds SNTP exchanges by hand, timed on the virtual clock in
+// sdk/fake_time.h, and checks the request format, the round trip
+// correction and that bad or kiss-o'-death responses are refused.
+#include <stdint.h>
+#include <string.h>
+
+#include <array>
+
+#include "fake_time.h"
+#include "sntp.h"
+#include "test.h"
+
+#define NTP_UNIX_OFFSET 2208988800ull
+#define EPOCH_US        1760875200000000ll
+#define NONCE           0x0123456789ABCDEFull
+
+typedef std::array<uint8_t, SNTP_PACKET_SIZE> sntp_packet;
+
+static void put_u64(uint8_t *out, uint64_t value) {
+    for(int i = 7; i >= 0; i--) {
+        out[i] = value;
+        value >>= 8;
+    }
+}
+
+static uint64_t get_u64(const uint8_t *data) {
+    uint64_t value = 0;
+    for(int i = 0; i < 8; i++) {
+        value = value << 8 | data[i];
+    }
+    return value;
+}
+
+static uint64_t to_ntp(int64_t unix_us) {
+    uint64_t seconds = unix_us / 1000000 + NTP_UNIX_OFFSET;
+    uint64_t fraction = (((uint64_t)(unix_us % 1000000) << 32) + 999999) / 1000000;
+    return seconds << 32 | fraction;
+}
+
+// A version 4 server reply, stratum 2, no leap second pending
+static sntp_packet response(uint64_t originate, int64_t received_utc_us, int64_t transmit_utc_us) {
+    sntp_packet packet{};
+    packet[0] = (4 << 3) | 4;
+    packet[1] = 2;
+    put_u64(packet.data() + 24, originate);
+    put_u64(packet.data() + 32, to_ntp(received_utc_us));
+    put_u64(packet.data() + 40, to_ntp(transmit_utc_us));
+    return packet;
+}
+
+static bool parse(const sntp_packet &packet, uint64_t sent_us, uint64_t received_us, int64_t &utc_us) {
+    return sntp_parse_response(packet, NONCE, sent_us, received_us, utc_us);
+}
+
+static void test_request() {
+    sntp_packet request;
+    request.fill(0xFF);
+    sntp_build_request(request, NONCE);
+    // Version 4, client mode, the nonce as the transmit timestamp
+    CHECK(request[0] == 0x23);
+    CHECK(get_u64(request.data() + 40) == NONCE);
+    for(size_t i = 1; i < 40; i++) {
+        CHECK_MSG(request[i] == 0, "byte %zu", i);
+    }
+}
+
+static void test_round_trip() {
+    fake_time_reset();
+    fake_advance_to(123456789);
+    // The server's clock is the truth, the node's monotonic clock is offset from it
+    const int64_t offset_us = EPOCH_US - 123456789;
+    uint64_t sent_us = time_us_64();
+    // 12 ms to the server, 3 ms there, 8 ms back: the reply left the server
+    // 8 ms ago but half the 20 ms network round trip, 10 ms, is assumed
+    busy_wait_us(12000);
+    int64_t server_received = time_us_64() + offset_us;
+    busy_wait_us(3000);
+    int64_t server_sent = time_us_64() + offset_us;
+    busy_wait_us(8000);
+    int64_t utc_us = 0;
+    CHECK(parse(response(NONCE, server_received, server_sent), sent_us, time_us_64(), utc_us));
+    int64_t expected = server_sent + 10000;
+    CHECK_MSG(utc_us >= expected - 1 && utc_us <= expected + 1, "%lld vs %lld", (long long)utc_us, (long long)expected);
+
+    // Symmetric paths give the exact time
+    sent_us = time_us_64();
+    busy_wait_us(5000);
+    server_received = time_us_64() + offset_us;
+    server_sent = server_received;
+    busy_wait_us(5000);
+    CHECK(parse(response(NONCE, server_received, server_sent), sent_us, time_us_64(), utc_us));
+    expected = time_us_64() + offset_us;
+    CHECK_MSG(utc_us >= expected - 1 && utc_us <= expected + 1, "%lld vs %lld", (long long)utc_us, (long long)expected);
+
+    // A server that claims to have held the request longer than the whole
+    // round trip gets no delay added, rather than a negative one
+    sent_us = time_us_64();
+    busy_wait_us(2000);
+    CHECK(parse(response(NONCE, EPOCH_US, EPOCH_US + 50000), sent_us, time_us_64(), utc_us));
+    CHECK(utc_us >= EPOCH_US + 50000 - 1 && utc_us <= EPOCH_US + 50000 + 1);
+}
+
+static void test_rejected() {
+    const int64_t at = EPOCH_US;
+    int64_t utc_us = 42;
+    sntp_packet good = response(NONCE, at, at);
+    CHECK(parse(good, 0, 1000, utc_us));
+    utc_us = 42;
+
+    CHECK(!sntp_parse_response({good.data(), SNTP_PACKET_SIZE - 1}, NONCE, 0, 1000, utc_us));
+    CHECK(!sntp_parse_response({good.data(), 0}, NONCE, 0, 1000, utc_us));
+
+    // Someone else's reply, or an old one
+    CHECK(!parse(response(NONCE + 1, at, at), 0, 1000, utc_us));
+
+    sntp_packet packet = good;
+    // Client and broadcast modes are not replies
+    packet[0] = (4 << 3) | 3;
+    CHECK(!parse(packet, 0, 1000, utc_us));
+    packet[0] = (4 << 3) | 5;
+    CHECK(!parse(packet, 0, 1000, utc_us));
+    // Leap indicator 3, the server is not synchronized
+    packet[0] = 0xC0 | (4 << 3) | 4;
+    CHECK(!parse(packet, 0, 1000, utc_us));
+    // A pending leap second is still a good time
+    packet[0] = 0x40 | (4 << 3) | 4;
+    CHECK(parse(packet, 0, 1000, utc_us));
+    utc_us = 42;
+
+    // Kiss-o'-death: stratum 0 with a code in the reference id
+    packet = good;
+    packet[1] = 0;
+    memcpy(packet.data() + 12, "RATE", 4);
+    CHECK(!parse(packet, 0, 1000, utc_us));
+    memcpy(packet.data() + 12, "DENY", 4);
+    CHECK(!parse(packet, 0, 1000, utc_us));
+    // Stratum 16 is unsynchronized
+    packet = good;
+    packet[1] = 16;
+    CHECK(!parse(packet, 0, 1000, utc_us));
+    packet[1] = 15;
+    CHECK(parse(packet, 0, 1000, utc_us));
+    utc_us = 42;
+
+    packet = good;
+    packet.fill(0);
+    CHECK(!parse(packet, 0, 1000, utc_us));
+    // Nothing refused touched the result
+    CHECK(utc_us == 42);
+}
+
+int main() {
+    test_request();
+    test_round_trip();
+    test_rejected();
+    return test_result("test_sntp");
+}
@@ -0,0 +1,329 @@
+// Checks the datagram encoding against the field id tables of the python
+// test server and the weewx driver, the acknowledgement decoding, and
+// udp_transport's retransmit pool against the fake lwIP and clock in sdk/.
+#include <stdio.h>
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+#include <pico/rand.h>
+
+#include "test.h"
+#include "udp_packet.h"
+#include "udp_transport.h"
+
+#ifndef UDP_TEST_SERVER
+#define UDP_TEST_SERVER "scripts/test_udp_server.py"
+#endif
+#ifndef UDP_WEEWX_DRIVER
+#define UDP_WEEWX_DRIVER "scripts/weewx/bin/user/weathernode_driver.py"
+#endif
+
+struct field_setter {
+    const char *name;
+    udp_field id;
+    void (*set)(packet_args &args, float value);
+};
+
+#define FIELD(name) {#name, udp_field::name, [](packet_args &args, float value) { args.name = value; }}
+
+// Battery statuses are ints in packet_args, the values below are whole numbers
+static const field_setter fields[] = {
+    FIELD(outTemp), FIELD(inTemp), FIELD(barometer), FIELD(pressure),
+    FIELD(windSpeed), FIELD(windDir), FIELD(windGust), FIELD(windGustDir),
+    FIELD(outHumidity), FIELD(inHumidity), FIELD(radiation), FIELD(UV),
+    FIELD(rain), FIELD(txBatteryStatus), FIELD(windBatteryStatus), FIELD(rainBatteryStatus),
+    FIELD(outTempBatteryStatus), FIELD(inTempBatteryStatus), FIELD(consBatteryVoltage), FIELD(heatingVoltage),
+    FIELD(supplyVoltage), FIELD(referenceVoltage), FIELD(rxCheckPercent), FIELD(dewpoint),
+    FIELD(heatindex),
+};
+
+// The quoted names in the python list assigned to name, in order
+static std::vector<std::string> python_list(const char *path, const char *name) {
+    std::vector<std::string> names;
+    FILE *file = fopen(path, "r");
+    if(file == nullptr) {
+        printf("cannot open %s\n", path);
+        return names;
+    }
+    std::string text;
+    char chunk[512];
+    size_t read;
+    while((read = fread(chunk, 1, sizeof(chunk), file)) > 0) {
+        text.append(chunk, read);
+    }
+    fclose(file);
+    size_t start = text.find(std::string(name) + " = [");
+    size_t end = text.find(']', start);
+    if(start == std::string::npos || end == std::string::npos) {
+        return names;
+    }
+    for(size_t quote = text.find('"', start); quote < end; quote = text.find('"', quote)) {
+        size_t close = text.find('"', quote + 1);
+        names.push_back(text.substr(quote + 1, close - quote - 1));
+        quote = close + 1;
+    }
+    return names;
+}
+
+static uint32_t get_u32(const uint8_t *data) {
+    return data[0] | data[1] << 8 | data[2] << 16 | (uint32_t)data[3] << 24;
+}
+
+static float get_f32(const uint8_t *data) {
+    uint32_t bits = get_u32(data);
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+static void test_field_ids(const char *path, const char *list) {
+    std::vector<std::string> names = python_list(path, list);
+    CHECK_MSG(names.size() == (size_t)udp_field::count, "%s has %zu fields", path, names.size());
+    CHECK(sizeof(fields) / sizeof(fields[0]) == (size_t)udp_field::count);
+    for(const field_setter &field : fields) {
+        // Each field on its own decodes under its name in the python table
+        packet_args args;
+        float value = (float)field.id + 1.0f;
+        field.set(args, value);
+        uint8_t data[UDP_PACKET_MAX_SIZE];
+        size_t length = encode_udp_packet(args, 1, 0, data);
+        CHECK_MSG(length == UDP_PACKET_HEADER + 5, "%s", field.name);
+        uint8_t id = data[UDP_PACKET_HEADER];
+        CHECK_MSG(id < names.size() && names[id] == field.name, "%s is id %d in %s", field.name, id, path);
+        CHECK_MSG(get_f32(data + UDP_PACKET_HEADER + 1) == value, "%s", field.name);
+    }
+}
+
+static void test_encode() {
+    packet_args args;
+    for(const field_setter &field : fields) {
+        field.set(args, 3.0f);
+    }
+    args.dateTime = 1760875200.25;
+    uint8_t data[UDP_PACKET_MAX_SIZE];
+    size_t length = encode_udp_packet(args, 0x01020304, UDP_PACKET_FLAG_ACK, data);
+    // Every field present fills the datagram exactly
+    CHECK(length == UDP_PACKET_MAX_SIZE);
+    CHECK(data[0] == 'W' && data[1] == 'N' && data[2] == UDP_PACKET_VERSION && data[3] == UDP_PACKET_FLAG_ACK);
+    CHECK(get_u32(data + 4) == 0x01020304);
+    uint64_t time_us = get_u32(data + 8) | (uint64_t)get_u32(data + 12) << 32;
+    CHECK(time_us == 1760875200250000ull);
+    for(size_t offset = UDP_PACKET_HEADER, n = 0; offset < length; offset += 5, n++) {
+        CHECK(data[offset] == n);
+        CHECK(get_f32(data + offset + 1) == 3.0f);
+    }
+
+    // Nothing but the header, with no time
+    CHECK(encode_udp_packet(packet_args{}, 7, 0, data) == UDP_PACKET_HEADER);
+    CHECK(get_u32(data + 8) == 0 && get_u32(data + 12) == 0);
+    // Too small for the worst case is refused up front
+    uint8_t small[UDP_PACKET_MAX_SIZE - 1];
+    CHECK(encode_udp_packet(packet_args{}, 7, 0, small) == 0);
+}
+
+static void test_decode_ack() {
+    const uint8_t ack[] = {'W', 'A', UDP_PACKET_VERSION, 0, 0x04, 0x03, 0x02, 0x01};
+    uint32_t sequence = 0;
+    CHECK(decode_udp_ack(ack, sequence));
+    CHECK(sequence == 0x01020304);
+
+    uint8_t bad[sizeof(ack)];
+    sequence = 0;
+    CHECK(!decode_udp_ack({ack, sizeof(ack) - 1}, sequence));
+    CHECK(!decode_udp_ack({ack, 0}, sequence));
+    memcpy(bad, ack, sizeof(bad));
+    bad[1] = 'N';
+    CHECK(!decode_udp_ack(bad, sequence));
+    memcpy(bad, ack, sizeof(bad));
+    bad[0] = 'X';
+    CHECK(!decode_udp_ack(bad, sequence));
+    memcpy(bad, ack, sizeof(bad));
+    bad[2] = UDP_PACKET_VERSION + 1;
+    CHECK(!decode_udp_ack(bad, sequence));
+    CHECK(sequence == 0);
+}
+
+static udp_pcb *pcb() {
+    return fake_udp_pcbs.front();
+}
+
+static uint32_t sequence_of(const std::vector<uint8_t> &datagram) {
+    return get_u32(datagram.data() + 4);
+}
+
+static void acknowledge(uint32_t sequence) {
+    uint8_t ack[UDP_PACKET_ACK_SIZE] = {'W', 'A', UDP_PACKET_VERSION, 0};
+    ack[4] = sequence;
+    ack[5] = sequence >> 8;
+    ack[6] = sequence >> 16;
+    ack[7] = sequence >> 24;
+    fake_udp_receive(pcb(), ack, sizeof(ack));
+}
+
+static void reset() {
+    fake_lwip_reset();
+    fake_time_reset();
+    fake_rand_32 = 1000;
+}
+
+static packet_args reading() {
+    packet_args args;
+    args.outTemp = 21.5f;
+    return args;
+}
+
+static void test_unacknowledged() {
+    reset();
+    udp_transport transport("weewx", 9836, false);
+    CHECK(transport.open() && transport.ready());
+    CHECK(transport.send(reading()));
+    CHECK(pcb()->sent.size() == 1);
+    CHECK(pcb()->port == 9836);
+    CHECK(sequence_of(pcb()->sent[0]) == 1001);
+    CHECK(pcb()->sent[0][3] == 0);
+    // Nothing is kept to resend
+    fake_advance_to(60000000);
+    transport.poll();
+    CHECK(pcb()->sent.size() == 1);
+    // A lost datagram is reported to the caller
+    fake_udp_send_result = ERR_RTE;
+    CHECK(!transport.send(reading()));
+    CHECK(transport.sent() == 1);
+    CHECK(fake_pbufs_live == 0);
+}
+
+static void test_not_ready() {
+    reset();
+    fake_dns_result = ERR_INPROGRESS;
+    udp_transport transport("weewx", 9836);
+    CHECK(transport.open());
+    CHECK(!transport.ready());
+    CHECK(!transport.send(reading()));
+    fake_dns_resolve("weewx", &fake_dns_addr);
+    CHECK(transport.ready());
+    CHECK(transport.send(reading()));
+    CHECK(pcb()->sent.size() == 1);
+}
+
+static void test_retries_and_backoff() {
+    reset();
+    udp_transport transport("weewx", 9836);
+    CHECK(transport.open());
+    CHECK(transport.send(reading()));
+    CHECK(pcb()->sent.size() == 1);
+    CHECK(pcb()->sent[0][3] == UDP_PACKET_FLAG_ACK);
+
+    // Resent after the timeout, then after twice and four times as long
+    uint64_t expected[] = {1000000, 1000000 + 2000000, 1000000 + 2000000 + 4000000};
+    uint64_t now = 0;
+    for(size_t attempt = 0; attempt < UDP_TRANSPORT_RETRIES; attempt++) {
+        fake_advance_to(expected[attempt] - 1);
+        transport.poll();
+        CHECK_MSG(pcb()->sent.size() == attempt + 1, "attempt %zu early", attempt);
+        fake_advance_to(expected[attempt]);
+        transport.poll();
+        CHECK_MSG(pcb()->sent.size() == attempt + 2, "attempt %zu", attempt);
+        CHECK(pcb()->sent.back() == pcb()->sent.front());
+        now = expected[attempt];
+    }
+    // Out of retries, the sample is dropped
+    CHECK(transport.dropped() == 0);
+    fake_advance_to(now + 8000000);
+    transport.poll();
+    CHECK(transport.dropped() == 1);
+    CHECK(pcb()->sent.size() == UDP_TRANSPORT_RETRIES + 1);
+    fake_advance_to(now + 60000000);
+    transport.poll();
+    CHECK(pcb()->sent.size() == UDP_TRANSPORT_RETRIES + 1);
+    CHECK(transport.sent() == UDP_TRANSPORT_RETRIES + 1);
+}
+
+static void test_acknowledged() {
+    reset();
+    udp_transport transport("weewx", 9836);
+    CHECK(transport.open());
+    CHECK(transport.send(reading()));
+    CHECK(transport.send(reading()));
+    // Malformed or unknown acknowledgements change nothing
+    const uint8_t junk[] = {'W', 'A', UDP_PACKET_VERSION};
+    fake_udp_receive(pcb(), junk, sizeof(junk));
+    acknowledge(999);
+    CHECK(transport.acknowledged() == 0);
+    acknowledge(sequence_of(pcb()->sent[0]));
+    CHECK(transport.acknowledged() == 1);
+    // A duplicate is not counted twice
+    acknowledge(sequence_of(pcb()->sent[0]));
+    CHECK(transport.acknowledged() == 1);
+    fake_advance_to(1000000);
+    transport.poll();
+    // Only the second is resent
+    CHECK(pcb()->sent.size() == 3);
+    CHECK(sequence_of(pcb()->sent[2]) == sequence_of(pcb()->sent[1]));
+    acknowledge(sequence_of(pcb()->sent[1]));
+    fake_advance_to(60000000);
+    transport.poll();
+    CHECK(pcb()->sent.size() == 3);
+    CHECK(transport.acknowledged() == 2);
+    CHECK(transport.dropped() == 0);
+    CHECK(fake_pbufs_live == 0);
+}
+
+static void test_failed_transmit() {
+    reset();
+    udp_transport transport("weewx", 9836);
+    CHECK(transport.open());
+    // Queued even though neither the pbuf nor the send worked, poll delivers it
+    fake_pbuf_exhausted = true;
+    CHECK(transport.send(reading()));
+    fake_pbuf_exhausted = false;
+    fake_udp_send_result = ERR_RTE;
+    CHECK(transport.send(reading()));
+    CHECK(pcb()->sent.empty());
+    CHECK(transport.sent() == 0);
+    fake_udp_send_result = ERR_OK;
+    fake_advance_to(1000000);
+    transport.poll();
+    CHECK(pcb()->sent.size() == 2);
+    CHECK(sequence_of(pcb()->sent[0]) == 1001 && sequence_of(pcb()->sent[1]) == 1002);
+    CHECK(fake_pbufs_live == 0);
+}
+
+static void test_eviction() {
+    reset();
+    // Start just short of the wrap, the oldest is still the first sent
+    fake_rand_32 = 0xFFFFFFFD;
+    udp_transport transport("weewx", 9836);
+    CHECK(transport.open());
+    for(int i = 0; i < UDP_TRANSPORT_PENDING + 1; i++) {
+        CHECK(transport.send(reading()));
+    }
+    CHECK(transport.dropped() == 1);
+    uint32_t first = sequence_of(pcb()->sent[0]);
+    CHECK(first == 0xFFFFFFFE);
+    // Acknowledging the rest leaves nothing to resend, the first is gone
+    for(size_t i = 1; i < pcb()->sent.size(); i++) {
+        acknowledge(sequence_of(pcb()->sent[i]));
+    }
+    fake_advance_to(1000000);
+    transport.poll();
+    CHECK(pcb()->sent.size() == UDP_TRANSPORT_PENDING + 1);
+    acknowledge(first);
+    CHECK(transport.dropped() == 1);
+}
+
+int main() {
+    test_field_ids(UDP_TEST_SERVER, "FIELDS");
+    test_field_ids(UDP_WEEWX_DRIVER, "UDP_FIELDS");
+    test_encode();
+    test_decode_ack();
+    test_unacknowledged();
+    test_not_ready();
+    test_retries_and_backoff();
+    test_acknowledged();
+    test_failed_transmit();
+    test_eviction();
+    fake_lwip_reset();
+    return test_result("test_udp_packet");
+}
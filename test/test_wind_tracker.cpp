@@ -0,0 +1,116 @@
+#include <math.h>
+#include <stdint.h>
+
+#include "test.h"
+#include "wind_tracker.h"
+
+#define KMPH_PER_HZ 2.4f
+
+static bool near(float a, float b, float tolerance = 0.01f) {
+    return fabsf(a - b) <= tolerance;
+}
+
+// Feeds a steady pulse train at hz, calling update() every step_ms, and
+// returns the time reached
+static uint32_t steady(wind_tracker &wind, uint32_t &count, uint32_t start_ms, uint32_t duration_ms,
+        uint32_t step_ms, float hz, std::optional<degree_compass_t> direction = {}) {
+    uint32_t base = count;
+    for(uint32_t t = step_ms; t <= duration_ms; t += step_ms) {
+        count = base + (uint32_t)(hz * t / 1000.0f);
+        wind.update(count, start_ms + t, direction);
+    }
+    return start_ms + duration_ms;
+}
+
+static void test_first_period() {
+    wind_tracker wind;
+    wind.update(0, 0);
+    CHECK(!wind.speed());
+    wind.update(5, WIND_PERIOD_MS - 1);
+    CHECK(!wind.speed());
+    wind.update(5, WIND_PERIOD_MS);
+    CHECK(wind.speed());
+}
+
+static void test_short_intervals() {
+    // A single pulse in a 100 ms loop iteration must not read as 24 km/h
+    wind_tracker wind;
+    uint32_t count = 0;
+    wind.update(count, 0);
+    uint32_t now = steady(wind, count, 0, 60000, 100, 1.0f);
+    CHECK_MSG(near(*wind.speed(), KMPH_PER_HZ, 0.9f), "%.2f", *wind.speed());
+    CHECK_MSG(*wind.gust() <= KMPH_PER_HZ * 4 / 3 + 0.01f, "%.2f", *wind.gust());
+    // An isolated pulse seen by a 100 ms update is averaged over a whole period
+    wind.update(count + 1, now + 100);
+    wind.update(count + 1, now + 2 * WIND_PERIOD_MS);
+    CHECK(*wind.gust() < 24.0f);
+}
+
+static void test_independent_of_update_rate() {
+    const uint32_t steps[] = {100, 500, 2500, 10000};
+    for(uint32_t step : steps) {
+        wind_tracker wind;
+        uint32_t count = 0;
+        wind.update(count, 0);
+        steady(wind, count, 0, 120000, step, 5.0f);
+        CHECK_MSG(near(*wind.speed(), 5.0f * KMPH_PER_HZ, 0.9f), "step %u: %.2f", step, *wind.speed());
+        CHECK_MSG(near(*wind.gust(), 5.0f * KMPH_PER_HZ, 0.9f), "step %u: %.2f", step, *wind.gust());
+    }
+}
+
+static void test_gust_and_direction() {
+    wind_tracker wind;
+    uint32_t count = 0;
+    wind.update(count, 0, 90.0f);
+    uint32_t now = steady(wind, count, 0, 60000, 500, 2.0f, 90.0f);
+    // 6 s at 10 Hz from the west
+    now = steady(wind, count, now, 6000, 500, 10.0f, 270.0f);
+    now = steady(wind, count, now, 60000, 500, 2.0f, 90.0f);
+    CHECK(near(*wind.speed(), 2.0f * KMPH_PER_HZ, 0.9f));
+    CHECK_MSG(near(*wind.gust(), 10.0f * KMPH_PER_HZ, 0.9f), "%.2f", *wind.gust());
+    CHECK(wind.gust_direction() && *wind.gust_direction() == 270.0f);
+    // The gust ages out of the window
+    steady(wind, count, now, WIND_GUST_WINDOW_MS, 2500, 2.0f, 90.0f);
+    CHECK(near(*wind.gust(), 2.0f * KMPH_PER_HZ, 0.9f));
+    CHECK(*wind.gust_direction() == 90.0f);
+}
+
+static void test_wraparound() {
+    // Counter and millisecond clock both wrap during the run
+    wind_tracker wind;
+    uint32_t count = 0xFFFFFF00, start = 0xFFFF0000;
+    wind.update(count, start);
+    steady(wind, count, start, 120000, 2500, 4.0f);
+    CHECK_MSG(near(*wind.speed(), 4.0f * KMPH_PER_HZ, 0.9f), "%.2f", *wind.speed());
+    CHECK_MSG(near(*wind.gust(), 4.0f * KMPH_PER_HZ, 0.9f), "%.2f", *wind.gust());
+}
+
+static void test_long_gap() {
+    // No update for an hour, the pulses are spread over the whole gap
+    wind_tracker wind;
+    wind.update(0, 0);
+    wind.update(3600 * 3, 3600 * 1000);
+    CHECK(near(*wind.speed(), 3.0f * KMPH_PER_HZ));
+    CHECK(near(*wind.gust(), 3.0f * KMPH_PER_HZ));
+}
+
+static void test_reset() {
+    wind_tracker wind;
+    uint32_t count = 0;
+    wind.update(count, 0);
+    steady(wind, count, 0, 10000, 1000, 3.0f);
+    wind.reset();
+    CHECK(!wind.speed());
+    CHECK(!wind.gust());
+}
+
+int main() {
+    test_first_period();
+    test_short_intervals();
+    test_independent_of_update_rate();
+    test_gust_and_direction();
+    test_wraparound();
+    test_long_gap();
+    test_reset();
+    return test_result("wind_tracker");
+}
@@ -0,0 +1,109 @@
+#include <math.h>
+#include <stdint.h>
+
+#include <vector>
+
+#include "adc_filter.h"
+#include "test.h"
+#include "wind_vane.h"
+
+#define PULLUP_OHMS 10000.0f
+
+// Ladder resistance for each position, from the vane's datasheet
+static const float ladder[WIND_VANE_POSITIONS] = {
+    33000, 6570, 8200, 891, 1000, 688, 2200, 1410,
+    3900, 3140, 16000, 14120, 120000, 42120, 64900, 21880
+};
+
+static uint16_t counts_for(int position) {
+    return (uint16_t)(ADC_MAX_COUNTS * ladder[position] / (ladder[position] + PULLUP_OHMS) + 0.5f);
+}
+
+static float angle_difference(float a, float b) {
+    float d = fmodf(fabsf(a - b), 360.0f);
+    return d > 180.0f ? 360.0f - d : d;
+}
+
+static void test_every_position() {
+    wind_vane vane(PULLUP_OHMS);
+    for(int i = 0; i < WIND_VANE_POSITIONS; i++) {
+        std::optional<degree_compass_t> direction = vane.lookup(counts_for(i));
+        CHECK_MSG(direction && *direction == i * 22.5f, "position %d", i);
+    }
+}
+
+static void test_tolerance() {
+    wind_vane vane(PULLUP_OHMS, 40);
+    // North (33k) sits at 3150 counts, well clear of its neighbours
+    uint16_t north = counts_for(0);
+    CHECK(vane.lookup(north + 40) == 0.0f);
+    CHECK(vane.lookup(north - 40) == 0.0f);
+    CHECK(!vane.lookup(north + 41));
+    // Open circuit and short circuit match nothing
+    CHECK(!vane.lookup(ADC_MAX_COUNTS));
+    CHECK(!vane.lookup(0));
+}
+
+static void test_closest_entry() {
+    // 891 and 1000 ohm positions are only ~40 counts apart, every value
+    // between them must pick the closer one
+    wind_vane vane(PULLUP_OHMS, 40);
+    uint16_t low = counts_for(3), high = counts_for(4);
+    for(uint16_t counts = low; counts <= high; counts++) {
+        std::optional<degree_compass_t> direction = vane.lookup(counts);
+        float expected = counts - low <= high - counts ? 67.5f : 90.0f;
+        CHECK_MSG(direction && *direction == expected, "%u counts", counts);
+    }
+}
+
+static void test_average_across_north() {
+    wind_vane vane(PULLUP_OHMS);
+    std::vector<uint16_t> samples;
+    for(int i = 0; i < 64; i++) {
+        samples.push_back(counts_for(i % 2 ? 15 : 1));
+    }
+    std::optional<degree_compass_t> direction = vane.average(samples);
+    CHECK(direction && angle_difference(*direction, 0.0f) < 0.01f);
+}
+
+static void test_average_interleaved() {
+    // Vane on the first of three round robin channels
+    wind_vane vane(PULLUP_OHMS);
+    std::vector<uint16_t> samples;
+    for(int i = 0; i < 128; i++) {
+        samples.push_back(counts_for(i % 4 == 0 ? 5 : 4));
+        samples.push_back(2000);
+        samples.push_back(ADC_MAX_COUNTS);
+    }
+    std::optional<degree_compass_t> direction = vane.average(samples, 0, 3);
+    CHECK_MSG(direction && *direction > 90.0f && *direction < 112.5f, "%.2f", direction ? *direction : -1.0f);
+}
+
+static void test_average_rejects() {
+    wind_vane vane(PULLUP_OHMS);
+    // Disconnected vane reads full scale
+    std::vector<uint16_t> open(128, ADC_MAX_COUNTS);
+    CHECK(!vane.average(open));
+    // Mostly undecodable samples
+    std::vector<uint16_t> mostly_open(128, ADC_MAX_COUNTS);
+    for(int i = 0; i < 40; i++) {
+        mostly_open[i] = counts_for(0);
+    }
+    CHECK(!vane.average(mostly_open));
+    // Opposite directions cancel out
+    std::vector<uint16_t> opposite;
+    for(int i = 0; i < 64; i++) {
+        opposite.push_back(counts_for(i % 2 ? 8 : 0));
+    }
+    CHECK(!vane.average(opposite));
+}
+
+int main() {
+    test_every_position();
+    test_tolerance();
+    test_closest_entry();
+    test_average_across_north();
+    test_average_interleaved();
+    test_average_rejects();
+    return test_result("wind_vane");
+}